@@ -0,0 +1,316 @@
+// Google Benchmark suite for the hot paths: encode/decode of every frame
+// kind (t/T/r/R/d/D/b/B) at every length, PreparedFrame patching, TX ring and
+// RX queue throughput, and line framing over a captured-style byte stream.
+// Inputs are generated from fixed seeds, so runs are repeatable; no device
+// needed.
+//
+//   ./slcanx_bench --benchmark_filter=Decode
+//   SLCANX_BENCH_CAPTURE=rx.bin ./slcanx_bench --benchmark_filter=Framing
+//
+// SLCANX_BENCH_CAPTURE names a file of raw bytes read from a device; the
+// framing benchmarks use it instead of the generated stream.
+
+#include "slcanx_codec.hpp"
+#include "slcanx_queue.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace slcanx;
+
+static const char KINDS[] = "tTrRdDbB";
+static const size_t FD_LENGTHS[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+// Deterministic generator for ids, payloads and the stream mix.
+struct XorShift {
+    uint32_t s;
+    explicit XorShift(uint32_t seed) : s(seed) {}
+    uint32_t next() {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        return s;
+    }
+};
+
+static bool is_fd_kind(char k) { return k == 'd' || k == 'D' || k == 'b' || k == 'B'; }
+
+static CanFrame make_frame(char kind, size_t len, XorShift& rng) {
+    CanFrame f;
+    f.ext = kind >= 'A' && kind <= 'Z';
+    f.rtr = kind == 'r' || kind == 'R';
+    f.fd = is_fd_kind(kind);
+    f.brs = kind == 'b' || kind == 'B';
+    f.id = rng.next() & (f.ext ? 0x1FFFFFFF : 0x7FF);
+    f.len = (uint8_t)len; // DLC for remote frames
+    if (!f.rtr) {
+        for (size_t i = 0; i < len; ++i) f.data[i] = (uint8_t)rng.next();
+    }
+    return f;
+}
+
+// (kind, length) pairs: 0..8 for classic and remote frames, every DLC length for FD.
+static void kind_lengths(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"kind", "len"});
+    for (int k = 0; k < 8; ++k) {
+        for (size_t len : FD_LENGTHS) {
+            if (!is_fd_kind(KINDS[k]) && len > 8) break;
+            b->Args({k, (int64_t)len});
+        }
+    }
+}
+
+static void set_kind_label(benchmark::State& state) {
+    char label[2] = {KINDS[state.range(0)], 0};
+    state.SetLabel(label);
+}
+
+// ================= Codec =================
+
+static void BM_Encode(benchmark::State& state) {
+    XorShift rng(1);
+    std::vector<CanFrame> frames;
+    for (int i = 0; i < 64; ++i) frames.push_back(make_frame(KINDS[state.range(0)], (size_t)state.range(1), rng));
+    uint8_t out[MAX_LINE_LEN];
+    size_t i = 0, bytes = 0;
+    for (auto _ : state) {
+        bytes += encode_frame((uint8_t)(i & 3), frames[i & 63], out);
+        benchmark::DoNotOptimize(out);
+        ++i;
+    }
+    set_kind_label(state);
+    state.SetItemsProcessed((int64_t)state.iterations());
+    state.SetBytesProcessed((int64_t)bytes);
+}
+BENCHMARK(BM_Encode)->Apply(kind_lengths);
+
+static void BM_Decode(benchmark::State& state) {
+    XorShift rng(2);
+    std::vector<std::vector<uint8_t>> lines;
+    for (int i = 0; i < 64; ++i) {
+        CanFrame f = make_frame(KINDS[state.range(0)], (size_t)state.range(1), rng);
+        std::vector<uint8_t> line(MAX_LINE_LEN);
+        line.resize(encode_frame((uint8_t)(i & 3), f, line.data()) - 1); // Without '\r'
+        lines.push_back(line);
+    }
+    size_t i = 0, bytes = 0;
+    for (auto _ : state) {
+        const std::vector<uint8_t>& line = lines[i & 63];
+        uint8_t ch;
+        CanFrame f;
+        bool ok = decode_frame(line.data(), line.size(), ch, f);
+        benchmark::DoNotOptimize(ok);
+        benchmark::DoNotOptimize(f);
+        bytes += line.size() + 1;
+        ++i;
+    }
+    set_kind_label(state);
+    state.SetItemsProcessed((int64_t)state.iterations());
+    state.SetBytesProcessed((int64_t)bytes);
+}
+BENCHMARK(BM_Decode)->Apply(kind_lengths);
+
+// Rest-bus pattern: rewrite two payload bytes and copy the line out.
+static void BM_PreparedPatch(benchmark::State& state) {
+    XorShift rng(3);
+    size_t len = (size_t)state.range(0);
+    PreparedFrame prepared(0, make_frame('b', len, rng));
+    uint8_t out[MAX_LINE_LEN];
+    uint8_t i = 0;
+    for (auto _ : state) {
+        if (len >= 2) {
+            prepared.set_byte(0, i);
+            prepared.set_byte(len - 1, (uint8_t)~i);
+        }
+        prepared.copy_to(out);
+        benchmark::DoNotOptimize(out);
+        ++i;
+    }
+    state.SetItemsProcessed((int64_t)state.iterations());
+    state.SetBytesProcessed((int64_t)(state.iterations() * prepared.size()));
+}
+BENCHMARK(BM_PreparedPatch)->ArgName("len")->Arg(0)->Arg(8)->Arg(12)->Arg(16)->Arg(32)->Arg(48)->Arg(64);
+
+// ================= Queues =================
+
+// One thread: claim, fill and commit 64 records, then drain them.
+static void BM_TxRingClaimDrain(benchmark::State& state) {
+    TxRing ring(256 * 1024);
+    size_t len = (size_t)state.range(0);
+    uint8_t src[MAX_LINE_LEN] = {};
+    size_t bytes = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < 64; ++i) {
+            TxRing::Claim c = ring.claim(len);
+            std::memcpy(c.data, src, len);
+            ring.commit(c);
+        }
+        bytes += ring.drain([](const uint8_t* data, size_t n) { benchmark::DoNotOptimize(data + n); });
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * 64);
+    state.SetBytesProcessed((int64_t)bytes);
+}
+BENCHMARK(BM_TxRingClaimDrain)->ArgName("len")->Arg(22)->Arg(150);
+
+// N producer threads against one draining consumer, as in Slcanx::send().
+static void BM_TxRingMpsc(benchmark::State& state) {
+    constexpr size_t PER_PRODUCER = 1 << 15;
+    constexpr size_t LEN = 22; // "0t1238" + 16 hex digits
+    const int producers = (int)state.range(0);
+    TxRing ring(256 * 1024);
+    uint8_t src[LEN];
+    std::memset(src, 'A', sizeof(src));
+
+    for (auto _ : state) {
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&] {
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                for (size_t i = 0; i < PER_PRODUCER; ++i) {
+                    TxRing::Claim c;
+                    while (!(c = ring.claim(LEN))) std::this_thread::yield();
+                    std::memcpy(c.data, src, LEN);
+                    ring.commit(c);
+                }
+            });
+        }
+        const size_t total = PER_PRODUCER * LEN * (size_t)producers;
+        size_t drained = 0;
+        go.store(true, std::memory_order_release);
+        while (drained < total) {
+            size_t n = ring.drain([](const uint8_t* data, size_t len) { benchmark::DoNotOptimize(data + len); });
+            if (n == 0) std::this_thread::yield();
+            drained += n;
+        }
+        for (auto& t : threads) t.join();
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * PER_PRODUCER * (size_t)producers));
+}
+BENCHMARK(BM_TxRingMpsc)->ArgName("producers")->Arg(1)->Arg(2)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// One thread: push 64 frames, pop them in one batch.
+static void BM_RxQueuePushPop(benchmark::State& state) {
+    RxQueue q(4096, RxOverflowPolicy::DropNewest);
+    CanFrame frame = CanFrame::new_std(0x123, std::vector<uint8_t>(8, 0x55));
+    CanFrame out[64];
+    for (auto _ : state) {
+        for (int i = 0; i < 64; ++i) q.push(frame);
+        benchmark::DoNotOptimize(q.pop(out, 64));
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * 64);
+}
+BENCHMARK(BM_RxQueuePushPop);
+
+// Read thread pushing, application thread popping batches of `batch`.
+static void BM_RxQueueSpsc(benchmark::State& state) {
+    constexpr size_t FRAMES = 1 << 16;
+    const size_t batch = (size_t)state.range(0);
+    RxQueue q(4096, RxOverflowPolicy::DropNewest);
+    CanFrame frame = CanFrame::new_std(0x123, std::vector<uint8_t>(8, 0x55));
+    std::vector<CanFrame> out(batch);
+
+    for (auto _ : state) {
+        std::thread producer([&] {
+            for (size_t i = 0; i < FRAMES; ++i) {
+                // Wait for room rather than measure drops
+                while (q.size() >= q.capacity()) std::this_thread::yield();
+                q.push(frame);
+            }
+        });
+        size_t got = 0;
+        while (got < FRAMES) {
+            size_t n = q.pop(out.data(), batch);
+            if (n == 0) std::this_thread::yield();
+            got += n;
+        }
+        producer.join();
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * FRAMES));
+}
+BENCHMARK(BM_RxQueueSpsc)->ArgName("batch")->Arg(1)->Arg(64)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// ================= Line framing =================
+
+// Captured-style RX stream: 4 channels, mostly 8-byte classic frames with
+// extended IDs, remote frames and FD frames of every length mixed in.
+static const std::vector<uint8_t>& capture_stream() {
+    static const std::vector<uint8_t> stream = [] {
+        std::vector<uint8_t> out;
+        if (const char* path = std::getenv("SLCANX_BENCH_CAPTURE")) {
+            if (FILE* f = std::fopen(path, "rb")) {
+                uint8_t buf[65536];
+                size_t n;
+                while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+                std::fclose(f);
+                if (!out.empty()) return out;
+            }
+            std::fprintf(stderr, "SLCANX_BENCH_CAPTURE: cannot read %s, using the generated stream\n", path);
+        }
+        XorShift rng(4);
+        uint8_t line[MAX_LINE_LEN];
+        while (out.size() < (2u << 20)) {
+            uint32_t r = rng.next() % 100;
+            CanFrame f;
+            if (r < 55) f = make_frame('t', 8, rng);
+            else if (r < 75) f = make_frame('T', 8, rng);
+            else if (r < 80) f = make_frame(r & 1 ? 'r' : 'R', rng.next() % 9, rng);
+            else {
+                char kind = KINDS[4 + rng.next() % 4];
+                f = make_frame(kind, FD_LENGTHS[rng.next() % 16], rng);
+            }
+            size_t n = encode_frame((uint8_t)(rng.next() & 3), f, line);
+            out.insert(out.end(), line, line + n);
+        }
+        return out;
+    }();
+    return stream;
+}
+
+// LineParser alone, fed in reads of `chunk` bytes.
+static void BM_Framing(benchmark::State& state) {
+    const std::vector<uint8_t>& s = capture_stream();
+    const size_t chunk = (size_t)state.range(0);
+    size_t lines_seen = 0;
+    for (auto _ : state) {
+        LineParser lines;
+        for (size_t off = 0; off < s.size(); off += chunk) {
+            size_t n = s.size() - off < chunk ? s.size() - off : chunk;
+            lines.feed(s.data() + off, n, [&](const uint8_t* line, size_t len) {
+                benchmark::DoNotOptimize(line + len);
+                ++lines_seen;
+            });
+        }
+    }
+    state.SetItemsProcessed((int64_t)lines_seen);
+    state.SetBytesProcessed((int64_t)(state.iterations() * s.size()));
+}
+BENCHMARK(BM_Framing)->ArgName("chunk")->Arg(64)->Arg(512)->Arg(4096)->Unit(benchmark::kMicrosecond);
+
+// Framing plus decode, the read thread's work per byte before delivery.
+static void BM_FramingDecode(benchmark::State& state) {
+    const std::vector<uint8_t>& s = capture_stream();
+    const size_t chunk = (size_t)state.range(0);
+    size_t frames = 0;
+    for (auto _ : state) {
+        LineParser lines;
+        for (size_t off = 0; off < s.size(); off += chunk) {
+            size_t n = s.size() - off < chunk ? s.size() - off : chunk;
+            lines.feed(s.data() + off, n, [&](const uint8_t* line, size_t len) {
+                uint8_t ch;
+                CanFrame f;
+                frames += decode_frame(line, len, ch, f);
+                benchmark::DoNotOptimize(f);
+            });
+        }
+    }
+    state.SetItemsProcessed((int64_t)frames);
+    state.SetBytesProcessed((int64_t)(state.iterations() * s.size()));
+}
+BENCHMARK(BM_FramingDecode)->ArgName("chunk")->Arg(64)->Arg(512)->Arg(4096)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -6,7 +6,11 @@
 using namespace slcanx;
 
 int main(int argc, char** argv) {
+#ifdef _WIN32
     std::string port = "COM3";
+#else
+    std::string port = "/dev/ttyACM0";
+#endif
     if (argc > 1) port = argv[1];
 
     std::cout << "Opening " << port << " Channel 0 @ 500000bps" << std::endl;
@@ -15,7 +19,7 @@ int main(int argc, char** argv) {
     
     slcan.set_rx_callback([](uint8_t ch, const CanFrame& frame) {
         if (ch == 0) {
-            std::cout << "Rx: ID=" << std::hex << frame.id << " DLC=" << frame.data.size() << std::dec << std::endl;
+            std::cout << "Rx: ID=" << std::hex << frame.id << " DLC=" << (int)frame.len << std::dec << std::endl;
         }
     });
 
@@ -1,4 +1,5 @@
 #include "slcanx.hpp"
+#include "slcanx_cyclic.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -6,7 +7,11 @@
 using namespace slcanx;
 
 int main(int argc, char** argv) {
+#ifdef _WIN32
     std::string port = "COM3";
+#else
+    std::string port = "/dev/ttyACM0";
+#endif
     if (argc > 1) port = argv[1];
 
     Slcanx slcan(port);
@@ -18,16 +23,43 @@ int main(int argc, char** argv) {
         std::cout << "Rx Ch" << (int)ch << ": ID=" << std::hex << frame.id << std::dec << std::endl;
     });
 
+    // 0x100 every 10 ms with a counter in byte 6 and an XOR checksum in
+    // byte 7; 0x101 and 0x102 every 100 ms, 0x102 shifted by 50 ms.
+    CyclicScheduler cyclic(slcan);
+    uint8_t data[8] = {0, 1, 2, 3, 0, 0, 0, 0};
+
+    CyclicMessage m;
+    m.channel = 0;
+    m.frame = CanFrame::new_std(0x100, data);
+    m.period = std::chrono::milliseconds(10);
+    m.counter_byte = 6;
+    m.checksum_byte = 7;
+    CyclicScheduler::Id fast = cyclic.add(m);
+
+    m = CyclicMessage();
+    m.frame = CanFrame::new_std(0x101, data);
+    m.period = std::chrono::milliseconds(100);
+    cyclic.add(m);
+
+    m.frame = CanFrame::new_std(0x102, data);
+    m.offset = std::chrono::milliseconds(50);
+    cyclic.add(m);
+
     std::cout << "Starting periodic send..." << std::endl;
-    
-    int cnt = 0;
+
+    uint8_t speed = 0;
     while(true) {
-        std::vector<uint8_t> data = {0, 1, 2, (uint8_t)cnt};
-        CanFrame frame = CanFrame::new_std(0x100, data);
-        slcan.send(0, frame);
-        
-        cnt++;
         std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        // Signal update: takes effect from the next period
+        uint8_t value[1] = {speed++};
+        cyclic.update(fast, 4, value);
+
+        CyclicStats st = cyclic.stats(fast);
+        std::cout << "0x100 sent=" << st.sent << " jitter min/max/mean(us)="
+                  << st.jitter_min_ns / 1000 << "/" << st.jitter_max_ns / 1000 << "/"
+                  << st.jitter_mean_ns / 1000 << " late max(us)=" << st.late_max_ns / 1000
+                  << " skipped=" << st.skipped << std::endl;
     }
 
     return 0;
@@ -18,7 +18,11 @@ void tx_worker(Slcanx* slcan, int ch) {
 }
 
 int main(int argc, char** argv) {
+#ifdef _WIN32
     std::string port = "COM3";
+#else
+    std::string port = "/dev/ttyACM0";
+#endif
     if (argc > 1) port = argv[1];
 
     Slcanx slcan(port);
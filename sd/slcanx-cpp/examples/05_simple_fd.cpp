@@ -6,7 +6,11 @@
 using namespace slcanx;
 
 int main(int argc, char** argv) {
+#ifdef _WIN32
     std::string port = "COM3";
+#else
+    std::string port = "/dev/ttyACM0";
+#endif
     if (argc > 1) port = argv[1];
 
     Slcanx slcan(port);
@@ -22,7 +26,7 @@ int main(int argc, char** argv) {
 
     slcan.set_rx_callback([](uint8_t ch, const CanFrame& frame) {
         if (frame.fd) {
-            std::cout << "Rx FD: ID=" << std::hex << frame.id << " Len=" << frame.data.size() << std::dec << std::endl;
+            std::cout << "Rx FD: ID=" << std::hex << frame.id << " Len=" << (int)frame.len << std::dec << std::endl;
         }
     });
 
@@ -0,0 +1,48 @@
+#include "slcanx.hpp"
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+using namespace slcanx;
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    std::string port = "COM3";
+#else
+    std::string port = "/dev/ttyACM0";
+#endif
+    if (argc > 1) port = argv[1];
+
+    SlcanxOptions opts;
+    opts.rx_queue_depth = 8192;
+    opts.rx_overflow = RxOverflowPolicy::DropOldest;
+    Slcanx slcan(port, opts);
+
+    // No rx callback: frames are queued per channel and pulled in batches
+    slcan.close_channel(0);
+    slcan.set_bitrate(0, 500000);
+    slcan.open_channel(0);
+
+    std::cout << "Receiving on channel 0... (Ctrl+C to exit)" << std::endl;
+
+    CanFrame frames[256];
+    auto last_report = std::chrono::steady_clock::now();
+    uint64_t total = 0;
+    while (true) {
+        size_t n = slcan.recv(0, frames, std::chrono::milliseconds(100));
+        for (size_t i = 0; i < n; ++i) {
+            // process frames[i] ...
+        }
+        total += n;
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= std::chrono::seconds(1)) {
+            RxQueueStats st = slcan.rx_stats(0);
+            std::cout << "Rx total=" << total << " queued=" << st.depth
+                      << " dropped=" << st.dropped << std::endl;
+            last_report = now;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "slcanx_coro.hpp"
+#include <iostream>
+
+using namespace slcanx;
+
+// Echo every frame from channel 0 to channel 1, all on one thread.
+static coro::Task<> echo(coro::Device& dev) {
+    for (;;) {
+        CanFrame frame = co_await dev.recv(0);
+        std::cout << "Rx ch0 ID=" << std::hex << frame.id << std::dec
+                  << " len=" << (int)frame.len << std::endl;
+        frame.id += 1;
+        co_await dev.send(1, frame);
+    }
+}
+
+static coro::Task<> setup(coro::Device& dev) {
+    std::string uuid = co_await dev.query(0, 'N');
+    std::cout << "UUID: " << uuid << std::endl;
+    for (uint8_t ch = 0; ch < 2; ++ch) {
+        dev.send_cmd(ch, "C");
+        dev.send_cmd(ch, "S6");
+        dev.send_cmd(ch, "O");
+    }
+    std::string nominal = co_await dev.query(0, 'q');
+    std::cout << "Channel 0 nominal: " << nominal << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::string port = "/dev/ttyACM0";
+    if (argc > 1) port = argv[1];
+
+    try {
+        coro::EventLoop loop;
+        coro::Device dev(loop, port);
+        coro::spawn(setup(dev));
+        coro::spawn(echo(dev));
+        loop.run();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
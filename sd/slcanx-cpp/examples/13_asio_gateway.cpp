@@ -0,0 +1,119 @@
+// SLCANX -> SocketCAN gateway on one asio::io_context thread: channel N of
+// the adapter is forwarded to canN (or vcanN). Linux only, standalone Asio.
+//
+//   ./13_asio_gateway /dev/ttyACM0 vcan
+
+#include "slcanx_asio.hpp"
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+using namespace slcanx;
+
+using Protocol = asio::generic::raw_protocol;
+using Socket = Protocol::socket;
+using Endpoint = Protocol::endpoint;
+
+static unsigned int get_ifindex(const std::string& ifname) {
+    struct ifreq ifr = {};
+    std::strncpy(ifr.ifr_name, ifname.c_str(), IFNAMSIZ - 1);
+    int s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (s < 0) throw std::system_error(errno, std::generic_category(), "socket");
+    if (ioctl(s, SIOCGIFINDEX, &ifr) < 0) {
+        close(s);
+        throw std::system_error(errno, std::generic_category(), "ioctl " + ifname);
+    }
+    close(s);
+    return ifr.ifr_ifindex;
+}
+
+static std::unique_ptr<Socket> create_socket(asio::io_context& io, const std::string& ifname) {
+    auto sock = std::make_unique<Socket>(io, Protocol(PF_CAN, CAN_RAW));
+    int enable_canfd = 1;
+    setsockopt(sock->native_handle(), SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable_canfd, sizeof(enable_canfd));
+    struct sockaddr_can addr = {};
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = get_ifindex(ifname);
+    sock->bind(Endpoint(&addr, sizeof(addr)));
+    return sock;
+}
+
+// CanFrame -> SocketCAN wire struct; returns the number of bytes to send.
+static size_t to_socketcan(const CanFrame& f, canfd_frame& out) {
+    std::memset(&out, 0, sizeof(out));
+    out.can_id = f.id | (f.ext ? CAN_EFF_FLAG : 0) | (f.rtr ? CAN_RTR_FLAG : 0);
+    out.len = f.len;
+    std::memcpy(out.data, f.data.data(), f.len);
+    if (f.fd) {
+        out.flags = f.brs ? CANFD_BRS : 0;
+        return CANFD_MTU;
+    }
+    return CAN_MTU;
+}
+
+struct Gateway {
+    asio_device& dev;
+    std::array<std::unique_ptr<Socket>, NUM_CHANNELS>& socks;
+    std::array<ChannelFrame, 256> frames;
+    canfd_frame out;
+
+    void start() {
+        dev.async_read_frames(frames, [this](asio::error_code ec, std::size_t n) {
+            if (ec) {
+                std::cerr << "Serial read failed: " << ec.message() << std::endl;
+                return;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                Socket* sock = socks[frames[i].channel].get();
+                if (!sock) continue;
+                size_t len = to_socketcan(frames[i].frame, out);
+                // Raw CAN sockets accept or drop a frame immediately
+                asio::error_code send_ec;
+                sock->send(asio::buffer(&out, len), 0, send_ec);
+            }
+            start();
+        });
+    }
+};
+
+int main(int argc, char** argv) {
+    std::string port = "/dev/ttyACM0";
+    std::string prefix = "can";
+    if (argc > 1) port = argv[1];
+    if (argc > 2) prefix = argv[2];
+
+    try {
+        asio::io_context io;
+        asio_device dev(io.get_executor(), port);
+
+        std::array<std::unique_ptr<Socket>, NUM_CHANNELS> socks;
+        for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) {
+            std::string ifname = prefix + std::to_string(ch);
+            try {
+                socks[ch] = create_socket(io, ifname);
+            } catch (const std::exception& e) {
+                std::cerr << "Skipping " << ifname << ": " << e.what() << std::endl;
+                continue;
+            }
+            dev.write_command(ch, "C");
+            dev.write_command(ch, "S6");
+            dev.write_command(ch, "O");
+        }
+
+        Gateway gw{dev, socks, {}, {}};
+        gw.start();
+        std::cout << "Forwarding " << port << " -> " << prefix << "0.." << (int)(NUM_CHANNELS - 1) << std::endl;
+        io.run();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
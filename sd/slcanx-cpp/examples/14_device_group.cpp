@@ -0,0 +1,53 @@
+#include "slcanx_group.hpp"
+#include <iostream>
+#include <chrono>
+
+using namespace slcanx;
+
+// Usage: 14_device_group /dev/ttyACM0 /dev/ttyACM1 ...
+// Bridges channel 0 of every adapter to channel 1 of the next one, all on
+// one event loop thread.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " PORT..." << std::endl;
+        return 1;
+    }
+
+    DeviceGroupOptions opts;
+    opts.threads = 1;
+    DeviceGroup group(opts);
+    for (int i = 1; i < argc; ++i) {
+        uint16_t dev = group.add(argv[i]);
+        ChannelConfig cfg[2];
+        cfg[0].channel = 0;
+        cfg[0].bitrate = 500000;
+        cfg[1].channel = 1;
+        cfg[1].bitrate = 500000;
+        group.device(dev).configure(cfg);
+    }
+    std::cout << group.size() << " devices, " << group.stats().threads
+              << " loop thread(s). Bridging... (Ctrl+C to exit)" << std::endl;
+
+    GroupFrame frames[256];
+    auto last_report = std::chrono::steady_clock::now();
+    uint64_t total = 0;
+    while (true) {
+        size_t n = group.recv(frames, std::chrono::milliseconds(100));
+        for (size_t i = 0; i < n; ++i) {
+            if (frames[i].channel != 0) continue;
+            uint16_t next = (uint16_t)((frames[i].device + 1) % group.size());
+            group.try_send(next, 1, frames[i].frame);
+        }
+        total += n;
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= std::chrono::seconds(1)) {
+            DeviceGroupStats st = group.stats();
+            std::cout << "Rx total=" << total << " online=" << st.online << "/" << st.devices
+                      << " dropped=" << st.rx_dropped << std::endl;
+            last_report = now;
+        }
+    }
+
+    return 0;
+}
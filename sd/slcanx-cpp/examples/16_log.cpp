@@ -0,0 +1,45 @@
+#include "slcanx.hpp"
+#include "slcanx_log.hpp"
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+using namespace slcanx;
+
+// Usage: 16_log PORT FILE [SECONDS]
+// Logs all four channels to FILE (.blf, .asc or .log), then reads it back.
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " PORT FILE [SECONDS]" << std::endl;
+        return 1;
+    }
+    int seconds = argc > 3 ? std::stoi(argv[3]) : 10;
+
+    {
+        std::unique_ptr<LogWriter> log = open_log_writer(argv[2]);
+        Slcanx slcan(argv[1]);
+        slcan.set_capture(log.get());
+        for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) slcan.open_channel(ch);
+
+        std::cout << "Logging for " << seconds << " s..." << std::endl;
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        slcan.set_capture(nullptr);
+        LogStats st = log->stats();
+        std::cout << "Logged " << st.records << " frames, " << st.bytes << " bytes so far, dropped "
+                  << st.dropped << std::endl;
+    }
+
+    std::unique_ptr<LogReader> reader = open_log(argv[2]);
+    uint64_t per_channel[256] = {};
+    uint64_t total = 0;
+    CaptureRecord r;
+    while (reader->next(r)) {
+        per_channel[r.channel]++;
+        total++;
+    }
+    std::cout << "Read back " << total << " frames" << std::endl;
+    for (int ch = 0; ch < NUM_CHANNELS; ++ch) {
+        std::cout << "  ch" << ch << ": " << per_channel[ch] << std::endl;
+    }
+    return 0;
+}
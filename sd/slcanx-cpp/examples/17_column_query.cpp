@@ -0,0 +1,66 @@
+#include "slcanx_column.hpp"
+#include "slcanx_log.hpp"
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+using namespace slcanx;
+
+// Usage: 17_column_query INPUT STORE [ID]
+// Exports INPUT (capture, BLF, ASC or candump log) to the column store STORE,
+// lists every series with its mean cycle time, then reads the middle half of
+// one series (the first one, or ID in hex) and reports how many blocks that
+// touched.
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " INPUT STORE [ID]" << std::endl;
+        return 1;
+    }
+
+    {
+        std::unique_ptr<LogReader> in = open_log(argv[1]);
+        ColumnOptions opt;
+        opt.path = argv[2];
+        ColumnWriter out(opt);
+        CaptureRecord r;
+        while (in->next(r)) out.write_wait(r);
+    }
+
+    ColumnReader store(argv[2]);
+    const ColumnFileHeader& h = store.header();
+    std::cout << h.records << " frames, " << h.series << " series, " << h.blocks << " blocks" << std::endl;
+
+    std::vector<ColumnSeries> all = store.series();
+    for (const ColumnSeries& s : all) {
+        double cycle_ms = s.records > 1 ? (double)(s.last_ns - s.first_ns) / (double)(s.records - 1) / 1e6 : 0;
+        std::cout << "  ch" << (int)s.channel << " " << std::hex << s.id << std::dec << (s.ext ? "x" : "")
+                  << ": " << s.records << " frames, " << s.blocks << " blocks, cycle " << std::fixed
+                  << std::setprecision(3) << cycle_ms << " ms" << std::endl;
+    }
+    if (all.empty()) return 0;
+
+    ColumnSeries pick = all.front();
+    if (argc > 3) {
+        uint32_t id = (uint32_t)std::stoul(argv[3], nullptr, 16);
+        for (const ColumnSeries& s : all) {
+            if (s.id == id) {
+                pick = s;
+                break;
+            }
+        }
+    }
+    uint64_t span_ns = pick.last_ns - pick.first_ns;
+    uint64_t from = pick.first_ns + span_ns / 4, to = pick.last_ns - span_ns / 4;
+    uint64_t prev = 0, max_gap = 0;
+    ColumnQueryStats st = store.query(pick.channel, pick.id, pick.ext, from, to,
+                                      [&](const ColumnBlockView& b, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (prev && b.timestamps[i] - prev > max_gap) max_gap = b.timestamps[i] - prev;
+            prev = b.timestamps[i];
+        }
+    });
+    std::cout << "Middle half of " << std::hex << pick.id << std::dec << ": " << st.rows << " frames from "
+              << st.blocks << " of " << pick.blocks << " blocks, largest gap " << max_gap / 1e6 << " ms"
+              << std::endl;
+    return 0;
+}
@@ -2,7 +2,10 @@
 
 #include <string>
 #include <vector>
+#include <array>
 #include <cstdint>
+#include <cstddef>
+#include <type_traits>
 #include <functional>
 #include <memory>
 #include <thread>
@@ -10,20 +13,150 @@
 #include <condition_variable>
 #include <queue>
 #include <atomic>
+#include <chrono>
+#include <future>
 
 namespace slcanx {
 
+// Non-owning view over contiguous elements (C++17 stand-in for std::span).
+template <typename T>
+class span {
+public:
+    constexpr span() noexcept = default;
+    constexpr span(T* ptr, size_t size) noexcept : ptr_(ptr), size_(size) {}
+
+    template <size_t N>
+    constexpr span(T (&arr)[N]) noexcept : ptr_(arr), size_(N) {}
+
+    // std::vector, std::array, std::string, span<U>, ...
+    template <typename C,
+              typename = std::enable_if_t<std::is_convertible<
+                  decltype(std::declval<C&>().data()), T*>::value>>
+    constexpr span(C&& c) noexcept : ptr_(c.data()), size_(c.size()) {}
+
+    constexpr T* data() const noexcept { return ptr_; }
+    constexpr size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr T& operator[](size_t i) const noexcept { return ptr_[i]; }
+    constexpr T* begin() const noexcept { return ptr_; }
+    constexpr T* end() const noexcept { return ptr_ + size_; }
+
+    constexpr span subspan(size_t offset, size_t count) const noexcept {
+        return span(ptr_ + offset, count);
+    }
+
+private:
+    T* ptr_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Fixed-size, trivially copyable CAN/CAN FD frame. The payload lives inline,
+// so creating, copying and delivering frames never allocates and frames can
+// be memcpy'd into rings or files as-is.
 struct CanFrame {
-    uint32_t id;
-    std::vector<uint8_t> data;
+    static constexpr size_t MAX_LEN = 64;
+
+    uint32_t id = 0;
+    uint8_t len = 0; // Payload length in bytes (0..64)
     bool ext = false;
     bool rtr = false;
     bool fd = false;
     bool brs = false;
+    // Host receive time in ns (SlcanxOptions::rx_clock), 0 on frames built for TX
+    uint64_t timestamp_ns = 0;
+    std::array<uint8_t, MAX_LEN> data{};
+
+    span<uint8_t> payload() { return span<uint8_t>(data.data(), len); }
+    span<const uint8_t> payload() const { return span<const uint8_t>(data.data(), len); }
+    void set_payload(span<const uint8_t> bytes);
+
+    static CanFrame new_std(uint32_t id, span<const uint8_t> data);
+    static CanFrame new_ext(uint32_t id, span<const uint8_t> data);
+    static CanFrame new_fd(uint32_t id, span<const uint8_t> data, bool brs = false);
+};
+
+static_assert(std::is_trivially_copyable<CanFrame>::value, "CanFrame must stay trivially copyable");
+
+// A frame tagged with its channel, for multi-channel batch sends.
+struct ChannelFrame {
+    uint8_t channel = 0;
+    CanFrame frame;
+};
+
+class TxRing;
+template <typename T>
+class BasicRxQueue;
+using RxQueue = BasicRxQueue<CanFrame>;
+class PreparedFrame;
+class FilterBank;
+class CaptureSink;
+struct MetricsSnapshot;
+
+constexpr uint8_t NUM_CHANNELS = 4;
+
+// What a full per-channel RX queue does with the next frame.
+enum class RxOverflowPolicy {
+    DropNewest, // Keep what is queued, discard the incoming frame
+    DropOldest  // Discard the oldest queued frame to make room
+};
+
+// How the writer trades latency for fewer, fuller USB transfers.
+enum class TxCoalesce {
+    LatencyFirst,   // Flush at once when the link is idle; fill one USB packet under load
+    ThroughputFirst // Always wait up to the window and aim for several packets per write
+};
+
+// Clock used for CanFrame::timestamp_ns on received frames.
+enum class TimestampClock {
+    Monotonic, // CLOCK_MONOTONIC (steady_clock on Windows)
+    Tai        // CLOCK_TAI where available, else Monotonic
+};
+
+struct SlcanxOptions {
+    uint32_t baudrate = 115200;
+    uint32_t group_window_us = 125;     // Longest TX coalescing wait (0 = never wait)
+    TxCoalesce tx_coalesce = TxCoalesce::LatencyFirst;
+    size_t usb_packet_bytes = 512;      // USB bulk packet size the writer tries to fill
+    size_t tx_ring_bytes = 256 * 1024;  // Lock-free TX ring shared by all senders
+    size_t rx_queue_depth = 4096;       // Frames per channel RX queue
+    RxOverflowPolicy rx_overflow = RxOverflowPolicy::DropNewest;
+    TimestampClock rx_clock = TimestampClock::Monotonic;
+    bool external_drive = false;        // No I/O threads: the owner calls drive_read()/drive_write()
+};
 
-    static CanFrame new_std(uint32_t id, const std::vector<uint8_t>& data);
-    static CanFrame new_ext(uint32_t id, const std::vector<uint8_t>& data);
-    static CanFrame new_fd(uint32_t id, const std::vector<uint8_t>& data, bool brs = false);
+struct TxStats {
+    uint64_t writes = 0;         // Serial writes issued
+    uint64_t bytes = 0;          // Bytes written
+    uint64_t flush_idle = 0;     // Written at once: arrivals too slow to fill a packet
+    uint64_t flush_full = 0;     // Coalesced up to the packet target
+    uint64_t flush_window = 0;   // Window expired before the target was reached
+    uint64_t flush_explicit = 0; // Requested by flush()
+};
+
+// Bring-up settings for one channel, see Slcanx::configure().
+struct ChannelConfig {
+    uint8_t channel = 0;
+    uint32_t bitrate = 0;          // Nominal bitrate (0 = leave unchanged)
+    uint32_t data_bitrate = 0;     // CAN FD data bitrate, whole Mbit/s (0 = leave unchanged)
+    double sample_point = 0;       // Nominal sample point in percent (0 = leave unchanged)
+    double data_sample_point = 0;  // Data sample point in percent (0 = leave unchanged)
+    bool listen_only = false;
+    bool open = true;
+};
+
+// Timing read back by configure(): q / Q replies without the leading letter.
+struct ChannelStatus {
+    uint8_t channel = 0;
+    std::string nominal;
+    std::string data; // Empty unless data_bitrate was set
+};
+
+struct RxQueueStats {
+    uint64_t received = 0; // Frames queued
+    uint64_t dropped = 0;  // Frames lost to overflow
+    uint64_t filtered = 0; // Frames rejected by the acceptance filter
+    size_t depth = 0;      // Frames currently queued
+    size_t capacity = 0;
 };
 
 class Slcanx {
@@ -31,6 +164,7 @@ public:
     using RxCallback = std::function<void(uint8_t channel, const CanFrame&)>;
 
     Slcanx(const std::string& port, uint32_t baudrate = 115200, uint32_t group_window_us = 125);
+    Slcanx(const std::string& port, const SlcanxOptions& options);
     ~Slcanx();
 
     // Open/Close specific channel
@@ -43,35 +177,186 @@ public:
     bool set_sample_point(uint8_t channel, double nominal_percent, double data_percent);
     bool send_cmd(uint8_t channel, const std::string& cmd);
 
+    // Request/response commands
+    // Send a query (q: nominal timing, Q: data timing, N: firmware version and
+    // UUID, F: status flags) and get the reply line without its leading
+    // letter. Replies carry no channel, so they are matched to queries in
+    // the order sent, per command letter. The future throws
+    // std::runtime_error on timeout or shutdown; query() itself throws for a
+    // channel >= NUM_CHANNELS.
+    std::future<std::string> query(uint8_t channel, char cmd,
+                                   std::chrono::milliseconds timeout = std::chrono::milliseconds(500));
+
+    // Bring up several channels with a single write: close, timing, sample
+    // points, mode and open for every channel, then a q (and Q when
+    // data_bitrate is set) read-back per channel. Blocks for the replies, so
+    // bring-up costs one USB round trip. Throws std::runtime_error on timeout.
+    std::vector<ChannelStatus> configure(span<const ChannelConfig> channels,
+                                         std::chrono::milliseconds timeout = std::chrono::milliseconds(500));
+
     // Sending
+    // Lock-free from any number of threads. send() waits for ring space if the
+    // TX ring is full; try_send() returns false instead. Both return false
+    // for a channel >= NUM_CHANNELS, as does send_cmd().
     bool send(uint8_t channel, const CanFrame& frame);
+    bool try_send(uint8_t channel, const CanFrame& frame);
+
+    // Queue a pre-encoded frame (slcanx_codec.hpp): one claim and one copy.
+    bool send(const PreparedFrame& frame);
+    bool try_send(const PreparedFrame& frame);
+
+    // Encode many frames back-to-back under one TX ring claim (split only if
+    // the batch exceeds half the ring) and wake the writer once. Returns the
+    // number of frames queued, in order. send_batch() waits for ring space;
+    // try_send_batch() queues the prefix that fits right now. A frame for a
+    // channel >= NUM_CHANNELS ends the batch before it.
+    size_t send_batch(uint8_t channel, span<const CanFrame> frames);
+    size_t send_batch(span<const ChannelFrame> frames);
+    size_t try_send_batch(uint8_t channel, span<const CanFrame> frames);
+    size_t try_send_batch(span<const ChannelFrame> frames);
+
+    // Queue already encoded SLCAN lines (each ending in '\r') under one TX
+    // ring claim, waiting for space. Input larger than half the ring is split
+    // at line ends. The bytes are not checked.
+    bool send_encoded(span<const uint8_t> lines);
+
+    // Write everything queued so far without waiting for the coalescing
+    // window, and block until it has been handed to the serial port.
+    void flush();
+
+    TxStats tx_stats() const;
 
     // Receiving
+    // Every received frame carries timestamp_ns. The clock is read once per
+    // serial read; earlier frames of the same read are placed back in time by
+    // their bus duration at the bitrates set with set_bitrate() and
+    // set_data_bitrate() (500 kbit/s until set; data phase = nominal if unset).
     // Register a callback for received frames. 
     // Note: Callback is called from the internal read thread.
+    // While no callback is set, frames go to the per-channel RX queues instead.
     void set_rx_callback(RxCallback cb);
 
+    // Pull up to frames.size() queued frames from one channel. Waits up to
+    // `timeout` for the first frame (0 = don't wait). Returns the count.
+    // One consumer thread per channel.
+    size_t recv(uint8_t channel, span<CanFrame> frames,
+                std::chrono::nanoseconds timeout = std::chrono::nanoseconds::zero());
+
+    RxQueueStats rx_stats(uint8_t channel) const;
+
+    // Acceptance filtering (slcanx_filter.hpp)
+    // Rejected frames are dropped right after their ID is decoded and counted
+    // in rx_stats().filtered. The bank is copied and compiled here; the read
+    // thread picks it up through an atomic pointer swap without pausing.
+    void set_filter(uint8_t channel, const FilterBank& bank);
+    void clear_filter(uint8_t channel); // Accept everything again
+
+    // Capture (slcanx_capture.hpp, or an ASC/BLF writer from slcanx_log.hpp)
+    // Copy every delivered frame into `writer` (nullptr = stop), tagged with
+    // channel_base + channel. The writer must outlive the capture.
+    void set_capture(CaptureSink* writer, uint8_t channel_base = 0);
+
+    // Metrics (slcanx_metrics.hpp)
+    // Copy every counter and histogram without stopping the I/O threads.
+    // Counters are read one by one, so they are not a single atomic cut.
+    MetricsSnapshot snapshot() const;
+
+    // External drive (SlcanxOptions::external_drive, see slcanx_group.hpp)
+    // The device starts no threads; one event loop thread owns its I/O. It
+    // polls io_handle() for input and calls drive_read(true) when readable,
+    // and calls drive_write() and drive_read(false) when the wakeup fires or
+    // a returned deadline passes. flush(), query() and configure() must not
+    // be called from that thread, since it is the one that completes them.
+    int io_handle() const; // Serial fd, -1 where the backend has none
+
+    // Called from any thread when new TX data, a flush or a query needs the
+    // loop. Coalesced: it fires once until drive_write() has run again.
+    void set_wakeup(std::function<void()> fn);
+
+    // Reads what is pending (readable = true), expires queries. Returns ms
+    // until the next query deadline, -1 if none.
+    int drive_read(bool readable);
+
+    // Runs the coalescing writer. Returns ns until it wants to run again
+    // (0 = right away, more is queued), -1 when idle until the next wakeup.
+    int64_t drive_write();
+
 private:
     class SerialPort; // Forward declaration of internal helper
 
     void read_loop();
     void write_loop();
-    void parse_line(const std::string& line);
+    struct Reader;
+    struct Writer;
+    int read_step(int timeout_ms);
+    std::chrono::nanoseconds tx_window(std::atomic<uint64_t>*& reason);
+    std::atomic<uint64_t>* tx_window_reason();
+    void tx_write(std::atomic<uint64_t>* reason);
+    void wake_loop();
+    struct RxChannel;
+
+    struct QueryTable;
+    struct FilterTable;
+    struct Metrics;
+
+    void parse_line(const uint8_t* line, size_t len, std::vector<ChannelFrame>& batch);
+    void other_line(const uint8_t* line, size_t len);
+    bool handle_reply(const uint8_t* line, size_t len);
+    int expire_queries(); // Returns ms until the next deadline, -1 if none
+    bool submit(const uint8_t* lines, size_t len);
+    bool submit(const std::string& lines);
+    std::future<std::string> add_query(uint8_t channel, char cmd, std::chrono::milliseconds timeout);
+    void install_filter(uint8_t channel, const FilterBank* bank);
+    void reclaim_filters();
+    void stamp_batch(std::vector<ChannelFrame>& batch, uint64_t now_ns);
+    void deliver(uint8_t channel, const CanFrame& frame);
+    bool enqueue_frame(uint8_t channel, const CanFrame& frame, bool wait);
+    bool enqueue_line(const uint8_t* line, size_t len, bool wait);
+    bool enqueue_prepared(const PreparedFrame& frame, bool wait);
+    template <typename At>
+    size_t enqueue_batch(size_t count, At at, bool wait);
+    void wake_writer();
 
     std::unique_ptr<SerialPort> serial_;
     std::atomic<bool> running_{true};
     uint32_t group_window_us_;
+    TxCoalesce tx_coalesce_;
+    size_t usb_packet_bytes_;
+    TimestampClock rx_clock_;
+    std::atomic<uint32_t> bitrate_[NUM_CHANNELS];      // For RX timestamp interpolation
+    std::atomic<uint32_t> data_bitrate_[NUM_CHANNELS]; // 0 = same as bitrate_
+    uint64_t last_rx_ts_[NUM_CHANNELS] = {};          // Read thread only
+
+    // External drive
+    bool external_drive_;
+    std::function<void()> wakeup_;       // Guarded by write_mutex_
 
     // Read Thread
     std::thread read_thread_;
+    std::unique_ptr<Reader> reader_;
     RxCallback rx_callback_;
+    std::atomic<bool> has_rx_callback_{false};
     std::mutex rx_mutex_;
+    std::unique_ptr<RxChannel> rx_channels_[NUM_CHANNELS];
+    std::unique_ptr<QueryTable> queries_;
+    std::unique_ptr<FilterTable> filters_;
+    std::unique_ptr<Metrics> metrics_;
+    std::atomic<CaptureSink*> capture_{nullptr};
+    std::atomic<uint8_t> capture_base_{0};
 
     // Write Thread
     std::thread write_thread_;
-    std::mutex write_mutex_;
+    std::unique_ptr<TxRing> tx_ring_;     // Pending data to be written
+    std::unique_ptr<Writer> writer_;
+    std::atomic<bool> writer_waiting_{false};
+    std::mutex write_mutex_;              // Only used to park/wake the writer
     std::condition_variable write_cv_;
-    std::vector<uint8_t> write_buffer_; // Pending data to be written
+    std::atomic<bool> flush_requested_{false};
+    std::atomic<uint64_t> tx_written_{0};  // Ring position handed to the port
+    std::atomic<int> flush_waiters_{0};
+    std::condition_variable flush_cv_;
+    struct TxCounters;
+    std::unique_ptr<TxCounters> tx_counters_;
 };
 
 } // namespace slcanx
@@ -0,0 +1,229 @@
+#pragma once
+
+// Standalone-Asio I/O object for SLCANX adapters (header-only; link slcanx
+// for the codec). Lets a device live on an asio::io_context next to other
+// Asio objects, e.g. SocketCAN sockets, without the SDK's threads:
+//
+//   asio::io_context io;
+//   slcanx::asio_device dev(io.get_executor(), "/dev/ttyACM0");
+//   dev.write_command(0, "S6");
+//   dev.write_command(0, "O");
+//   std::array<slcanx::ChannelFrame, 64> frames;
+//   dev.async_read_frames(frames, [&](asio::error_code ec, std::size_t n) { ... });
+//   io.run();
+//
+// Completion tokens work as usual (callbacks, asio::use_awaitable,
+// asio::use_future, ...). Like an Asio socket, at most one read and one
+// write may be outstanding at a time.
+
+#ifndef ASIO_STANDALONE
+#define ASIO_STANDALONE
+#endif
+#include <asio.hpp>
+
+#include "slcanx.hpp"
+#include "slcanx_codec.hpp"
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/ioctl.h>
+#endif
+
+namespace slcanx {
+
+template <typename Executor = asio::any_io_executor>
+class basic_asio_device {
+public:
+    using executor_type = Executor;
+    using port_type = asio::basic_serial_port<Executor>;
+
+    // Open `port` ("/dev/ttyACM0", "COM3") as a raw 8N1 line without flow
+    // control and raise DTR. Throws std::system_error on failure.
+    basic_asio_device(const executor_type& ex, const std::string& port, uint32_t baudrate = 115200)
+        : port_(ex) {
+        port_.open(port);
+        port_.set_option(asio::serial_port_base::baud_rate(baudrate));
+        port_.set_option(asio::serial_port_base::character_size(8));
+        port_.set_option(asio::serial_port_base::parity(asio::serial_port_base::parity::none));
+        port_.set_option(asio::serial_port_base::stop_bits(asio::serial_port_base::stop_bits::one));
+        port_.set_option(asio::serial_port_base::flow_control(asio::serial_port_base::flow_control::none));
+        // CDC devices only start sending once DTR is asserted
+#ifdef _WIN32
+        EscapeCommFunction(port_.native_handle(), SETDTR);
+#else
+        int dtr = TIOCM_DTR;
+        ::ioctl(port_.native_handle(), TIOCMBIS, &dtr);
+#endif
+        init();
+    }
+
+    // Adopt a port the caller already opened and configured.
+    explicit basic_asio_device(port_type&& port) : port_(std::move(port)) {
+        init();
+    }
+
+    basic_asio_device(const basic_asio_device&) = delete;
+    basic_asio_device& operator=(const basic_asio_device&) = delete;
+
+    executor_type get_executor() noexcept { return port_.get_executor(); }
+    port_type& port() noexcept { return port_; }
+
+    void close() {
+        asio::error_code ec;
+        port_.close(ec);
+    }
+
+    // Blocking write of one command line (O, C, S6, y500000, ...). Meant for
+    // setup before async writes start. Throws std::system_error.
+    void write_command(uint8_t channel, std::string_view cmd) {
+        std::string line;
+        line.reserve(cmd.size() + 2);
+        line.push_back((char)('0' + channel));
+        line.append(cmd.data(), cmd.size());
+        line.push_back('\r');
+        asio::write(port_, asio::buffer(line));
+    }
+
+    // Fill `frames` with received frames and complete with how many. Reads
+    // from the port only when no decoded frames are left over from the
+    // previous read; never completes with 0 unless there is an error.
+    // Frames are stamped with steady_clock once per read.
+    // Signature: void(std::error_code, std::size_t)
+    template <typename CompletionToken>
+    auto async_read_frames(span<ChannelFrame> frames, CompletionToken&& token) {
+        return asio::async_compose<CompletionToken, void(asio::error_code, std::size_t)>(
+            read_op{this, frames}, token, port_);
+    }
+
+    // Encode all frames into one buffer and write it with a single
+    // async_write. Completes with the number of frames written.
+    // Signature: void(std::error_code, std::size_t)
+    template <typename CompletionToken>
+    auto async_write_frames(uint8_t channel, span<const CanFrame> frames, CompletionToken&& token) {
+        size_t n = frames.size();
+        wbuf_.clear();
+        for (const CanFrame& f : frames) append(channel, f);
+        return asio::async_compose<CompletionToken, void(asio::error_code, std::size_t)>(
+            write_op{this, n}, token, port_);
+    }
+
+    template <typename CompletionToken>
+    auto async_write_frames(span<const ChannelFrame> frames, CompletionToken&& token) {
+        size_t n = frames.size();
+        wbuf_.clear();
+        for (const ChannelFrame& f : frames) append(f.channel, f.frame);
+        return asio::async_compose<CompletionToken, void(asio::error_code, std::size_t)>(
+            write_op{this, n}, token, port_);
+    }
+
+private:
+    void init() {
+        pending_.reserve(sizeof(rbuf_) / 7 + 2);
+        wbuf_.reserve(64 * MAX_LINE_LEN);
+    }
+
+    void append(uint8_t channel, const CanFrame& frame) {
+        size_t old = wbuf_.size();
+        wbuf_.resize(old + encoded_size(frame));
+        encode_frame(channel, frame, wbuf_.data() + old);
+    }
+
+    // Decode one read into pending_ (only called once pending_ is drained).
+    void parse(size_t n) {
+        pending_.clear();
+        pending_pos_ = 0;
+        uint64_t ts = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        lines_.feed(rbuf_, n, [&](const uint8_t* line, size_t len) {
+            pending_.emplace_back();
+            ChannelFrame& item = pending_.back();
+            if (decode_frame(line, len, item.channel, item.frame)) {
+                item.frame.timestamp_ns = ts;
+            } else {
+                pending_.pop_back(); // Status lines and replies
+            }
+        });
+    }
+
+    size_t take(span<ChannelFrame> out) {
+        size_t n = pending_.size() - pending_pos_;
+        if (n > out.size()) n = out.size();
+        for (size_t i = 0; i < n; ++i) out[i] = pending_[pending_pos_ + i];
+        pending_pos_ += n;
+        return n;
+    }
+
+    struct read_op {
+        basic_asio_device* dev;
+        span<ChannelFrame> frames;
+        enum { starting, reading, posted } state = starting;
+        size_t count = 0;
+
+        template <typename Self>
+        void operator()(Self& self, asio::error_code ec = {}, std::size_t n = 0) {
+            switch (state) {
+                case starting:
+                    if (frames.empty()) {
+                        state = posted;
+                        asio::post(dev->port_.get_executor(), std::move(self));
+                        return;
+                    }
+                    if ((count = dev->take(frames)) > 0) {
+                        // Never complete inside the initiating call
+                        state = posted;
+                        asio::post(dev->port_.get_executor(), std::move(self));
+                        return;
+                    }
+                    state = reading;
+                    dev->port_.async_read_some(asio::buffer(dev->rbuf_), std::move(self));
+                    return;
+                case reading:
+                    if (ec) {
+                        self.complete(ec, 0);
+                        return;
+                    }
+                    dev->parse(n);
+                    if ((count = dev->take(frames)) == 0) {
+                        dev->port_.async_read_some(asio::buffer(dev->rbuf_), std::move(self));
+                        return;
+                    }
+                    self.complete(ec, count);
+                    return;
+                case posted:
+                    self.complete(ec, count);
+                    return;
+            }
+        }
+    };
+
+    struct write_op {
+        basic_asio_device* dev;
+        size_t count;
+        bool started = false;
+
+        template <typename Self>
+        void operator()(Self& self, asio::error_code ec = {}, std::size_t = 0) {
+            if (!started) {
+                started = true;
+                asio::async_write(dev->port_, asio::buffer(dev->wbuf_), std::move(self));
+                return;
+            }
+            self.complete(ec, ec ? 0 : count);
+        }
+    };
+
+    port_type port_;
+    LineParser lines_;
+    uint8_t rbuf_[4096];
+    std::vector<ChannelFrame> pending_; // Decoded but not yet handed out
+    size_t pending_pos_ = 0;
+    std::vector<uint8_t> wbuf_;
+};
+
+using asio_device = basic_asio_device<>;
+
+} // namespace slcanx
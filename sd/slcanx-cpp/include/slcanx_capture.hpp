@@ -0,0 +1,241 @@
+#pragma once
+
+// Binary capture log in memory-mapped segment files (POSIX).
+//
+// Frames are stored as fixed 80-byte little-endian records behind a 64-byte
+// segment header. Segments are preallocated to segment_bytes and mapped;
+// producers copy records into a lock-free ring and a dedicated thread moves
+// them into the mapping, so capturing a frame costs no system call. A full
+// segment is trimmed to its records and the next one, prepared ahead of
+// time, takes over.
+//
+//   slcanx::CaptureOptions opt;
+//   opt.directory = "/data/run42";
+//   slcanx::CaptureWriter cap(opt);
+//   bus.set_capture(&cap);           // every received frame the filters let through
+//   ...
+//   slcanx::CaptureReader log("/data/run42");
+//   while (const slcanx::CaptureRecord* r = log.next()) { ... }
+
+#include "slcanx.hpp"
+#include "slcanx_queue.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace slcanx {
+
+// CaptureRecord::flags
+constexpr uint8_t CAPTURE_EXT = 1 << 0;
+constexpr uint8_t CAPTURE_RTR = 1 << 1;
+constexpr uint8_t CAPTURE_FD = 1 << 2;
+constexpr uint8_t CAPTURE_BRS = 1 << 3;
+constexpr uint8_t CAPTURE_TX = 1 << 4; // Sent by the host rather than received
+
+struct CaptureRecord {
+    uint64_t timestamp_ns;  // CanFrame::timestamp_ns
+    uint32_t id;
+    uint8_t len;            // Payload bytes (DLC for remote frames)
+    uint8_t flags;          // CAPTURE_*
+    uint8_t channel;        // Channel, or device * NUM_CHANNELS + channel for groups
+    uint8_t reserved;
+    uint8_t data[CanFrame::MAX_LEN];
+
+    CanFrame frame() const;
+    static CaptureRecord from(uint8_t channel, const CanFrame& frame, bool tx = false);
+};
+
+static_assert(sizeof(CaptureRecord) == 80, "CaptureRecord layout is part of the file format");
+
+struct CaptureSegmentHeader {
+    char magic[8];          // "SLCXCAP\0"
+    uint32_t version;       // 1
+    uint32_t record_size;   // sizeof(CaptureRecord)
+    uint64_t sequence;      // Segment number, from 1
+    uint64_t records;       // Valid records; updated after every batch, so a
+                            // segment cut short by a crash still reads back
+    uint64_t first_ns;      // Timestamp of the first / last record
+    uint64_t last_ns;
+    uint8_t reserved[16];
+};
+
+static_assert(sizeof(CaptureSegmentHeader) == 64, "CaptureSegmentHeader layout is part of the file format");
+
+struct CaptureOptions {
+    std::string directory = ".";
+    std::string prefix = "capture";        // Files are <prefix>_<sequence>.slcap
+    size_t segment_bytes = 64 << 20;       // Preallocated size of each segment
+    size_t max_segments = 0;               // Delete the oldest beyond this, earlier runs' first (0 = keep all)
+    size_t ring_bytes = 4 << 20;           // Producer ring (~40k records)
+    uint32_t flush_interval_ms = 5;        // Longest a record waits in the ring
+};
+
+struct CaptureStats {
+    uint64_t records = 0;   // Written to segments
+    uint64_t dropped = 0;   // Lost because the ring was full
+    uint64_t segments = 0;  // Segments started
+    uint64_t bytes = 0;     // Header and records written
+};
+
+// Base of the capture writers. Producers copy records into a lock-free ring
+// from any number of threads; one background thread hands them to
+// consume() and calls idle() after each batch. Subclasses call start() at
+// the end of their constructor and stop() first thing in their destructor.
+class CaptureSink {
+public:
+    virtual ~CaptureSink();
+    CaptureSink(const CaptureSink&) = delete;
+    CaptureSink& operator=(const CaptureSink&) = delete;
+
+    // Returns false (and counts a drop) if the ring is full.
+    bool write(uint8_t channel, const CanFrame& frame, bool tx = false);
+    bool write(const CaptureRecord& record);
+    // Waits for room instead of dropping. For offline conversion, where the
+    // producer is faster than the file.
+    void write_wait(const CaptureRecord& record);
+
+    uint64_t records() const { return records_.load(std::memory_order_relaxed); } // Stored
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+protected:
+    CaptureSink(size_t ring_bytes, uint32_t flush_interval_ms);
+
+    void start();
+    // Hands over what is still queued and joins the thread.
+    void stop();
+    bool running() const { return running_.load(std::memory_order_relaxed); }
+
+    // Background thread. consume() returns false if the record was lost.
+    virtual bool consume(const CaptureRecord& record) = 0;
+    virtual void idle() {}
+
+private:
+    void wake();
+    void run();
+
+    std::unique_ptr<TxRing> ring_;
+    uint32_t flush_interval_ms_;
+    std::atomic<bool> running_{true};
+    std::atomic<bool> waiting_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+
+    std::atomic<uint64_t> records_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+// Throws std::runtime_error if the directory or the first segment cannot be
+// created.
+class CaptureWriter : public CaptureSink {
+public:
+    explicit CaptureWriter(const CaptureOptions& options = CaptureOptions());
+    ~CaptureWriter() override; // Writes out what is queued and trims the last segment
+
+    CaptureStats stats() const;
+
+protected:
+    bool consume(const CaptureRecord& record) override;
+    void idle() override;
+
+private:
+    struct Segment;
+
+    void roll();
+    std::unique_ptr<Segment> prepare();
+    void finish(Segment& seg);
+    void prune(size_t keep);  // Oldest finished segments beyond keep
+
+    CaptureOptions opt_;
+    std::unique_ptr<Segment> current_;
+    std::unique_ptr<Segment> next_;   // Preallocated while current_ fills
+    uint64_t sequence_ = 0;
+    std::deque<std::string> finished_;
+
+    std::atomic<uint64_t> segments_{0};
+    std::atomic<uint64_t> bytes_{0};
+    uint64_t unpublished_ = 0;        // Records since the last idle()
+};
+
+// Inline so the SDK's RX path can feed a writer without a call out.
+inline CaptureRecord CaptureRecord::from(uint8_t channel, const CanFrame& frame, bool tx) {
+    CaptureRecord r;
+    r.timestamp_ns = frame.timestamp_ns;
+    r.id = frame.id;
+    r.len = frame.len;
+    r.flags = (uint8_t)((frame.ext ? CAPTURE_EXT : 0) | (frame.rtr ? CAPTURE_RTR : 0) |
+                        (frame.fd ? CAPTURE_FD : 0) | (frame.brs ? CAPTURE_BRS : 0) | (tx ? CAPTURE_TX : 0));
+    r.channel = channel;
+    r.reserved = 0;
+    std::memcpy(r.data, frame.data.data(), sizeof(r.data));
+    return r;
+}
+
+inline bool CaptureSink::write(uint8_t channel, const CanFrame& frame, bool tx) {
+    return write(CaptureRecord::from(channel, frame, tx));
+}
+
+inline bool CaptureSink::write(const CaptureRecord& record) {
+    TxRing::Claim c = ring_->claim(sizeof(CaptureRecord));
+    if (!c) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    std::memcpy(c.data, &record, sizeof(CaptureRecord));
+    ring_->commit(c);
+    // The writer drains on its interval; only a filling ring wakes it early
+    if (ring_->used() > ring_->capacity() / 2) wake();
+    return true;
+}
+
+inline void CaptureSink::wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_one();
+    }
+}
+
+// Reads a segment file, or every <prefix>_*.slcap segment of a directory in
+// sequence order. Records are returned as pointers into the read-only
+// mapping; they stay valid until next() moves to another segment.
+class CaptureReader {
+public:
+    // Throws std::runtime_error if nothing can be opened.
+    explicit CaptureReader(const std::string& path, const std::string& prefix = "capture");
+    ~CaptureReader();
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    // Next record, nullptr at the end.
+    const CaptureRecord* next();
+
+    // All records of the current segment from the read position on, and
+    // moves past them; empty at the end. For batch processing.
+    span<const CaptureRecord> next_block();
+
+    const std::vector<std::string>& files() const { return files_; }
+    const CaptureSegmentHeader* header() const { return header_; } // Current segment
+
+private:
+    bool open_next();
+    void unmap();
+
+    std::vector<std::string> files_;
+    size_t file_ = 0;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    const CaptureSegmentHeader* header_ = nullptr;
+    const CaptureRecord* pos_ = nullptr;
+    const CaptureRecord* end_ = nullptr;
+};
+
+} // namespace slcanx
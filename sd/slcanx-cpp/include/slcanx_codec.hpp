@@ -0,0 +1,184 @@
+#pragma once
+
+#include "slcanx.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace slcanx {
+
+// SLCANX wire format: [channel]CMD ID DLC DATA \r
+//   CMD: t/T (std/ext), r/R (rtr), d/D (fd), b/B (fd + brs)
+// Longest line: prefix + cmd + 8 ID digits + DLC + 64 data bytes + CR.
+constexpr size_t MAX_LINE_LEN = 1 + 1 + 8 + 1 + 2 * CanFrame::MAX_LEN + 1;
+
+uint8_t len_to_dlc(size_t len);
+size_t dlc_to_len(uint8_t dlc);
+
+// Command character for a frame (t/T/r/R/d/D/b/B).
+char frame_command(const CanFrame& frame);
+
+// Exact number of bytes encode_frame() writes for this frame.
+size_t encoded_size(const CanFrame& frame);
+
+// Write the SLCAN line for `frame` (including the trailing '\r') to `out`,
+// which must have room for encoded_size(frame) bytes. Returns bytes written.
+// `channel` must be below NUM_CHANNELS; it is written as one digit.
+size_t encode_frame(uint8_t channel, const CanFrame& frame, uint8_t* out);
+
+// Approximate time the frame occupies the bus, in ns: nominal bits at
+// `bitrate`, the FD data phase at `data_bitrate` when BRS is set. Stuff bits
+// are ignored; the 3-bit interframe space is included.
+uint64_t frame_duration_ns(const CanFrame& frame, uint32_t bitrate, uint32_t data_bitrate);
+
+// A frame encoded once into its SLCAN line, for traffic that repeats the
+// same ID and layout. set_byte()/set_bytes() rewrite only the affected hex
+// digits, and Slcanx::send(const PreparedFrame&) queues the line with a
+// single copy. Payload positions run over the bytes on the wire, i.e. up
+// to the padded DLC length for FD frames; writes past the end are ignored.
+class PreparedFrame {
+public:
+    PreparedFrame() = default;
+    // Throws std::runtime_error for a channel >= NUM_CHANNELS.
+    PreparedFrame(uint8_t channel, const CanFrame& frame);
+
+    void set_byte(size_t i, uint8_t v) {
+        if (i >= payload_len_) return;
+        payload_[i] = v;
+        uint8_t* p = line_.data() + data_pos_ + 2 * i;
+        p[0] = (uint8_t)kDigits[v >> 4];
+        p[1] = (uint8_t)kDigits[v & 0xF];
+    }
+
+    void set_bytes(size_t offset, span<const uint8_t> bytes) {
+        for (size_t i = 0; i < bytes.size(); ++i) set_byte(offset + i, bytes[i]);
+    }
+
+    uint8_t byte(size_t i) const { return i < payload_len_ ? payload_[i] : 0; }
+    const uint8_t* payload() const { return payload_.data(); }
+    size_t payload_size() const { return payload_len_; }
+
+    // The encoded line, including the trailing '\r'.
+    const uint8_t* data() const { return line_.data(); }
+    size_t size() const { return line_len_; }
+
+    // Copy the line to `out` (size() bytes) as fixed-size moves, the last
+    // one overlapping. A memcpy sized at run time is expanded to
+    // `rep movs` here, whose startup costs more than the whole copy.
+    void copy_to(uint8_t* out) const {
+        const uint8_t* s = line_.data();
+        const size_t n = line_len_;
+        if (n >= 128) {
+            std::memcpy(out, s, 64);
+            std::memcpy(out + 64, s + 64, 64);
+            std::memcpy(out + n - 16, s + n - 16, 16);
+        } else if (n >= 64) {
+            std::memcpy(out, s, 64);
+            std::memcpy(out + n - 64, s + n - 64, 64);
+        } else if (n >= 32) {
+            std::memcpy(out, s, 32);
+            std::memcpy(out + n - 32, s + n - 32, 32);
+        } else if (n >= 16) {
+            std::memcpy(out, s, 16);
+            std::memcpy(out + n - 16, s + n - 16, 16);
+        } else if (n >= 8) {
+            std::memcpy(out, s, 8);
+            std::memcpy(out + n - 8, s + n - 8, 8);
+        } else {
+            for (size_t i = 0; i < n; ++i) out[i] = s[i];
+        }
+    }
+
+private:
+    static constexpr char kDigits[] = "0123456789ABCDEF";
+
+    std::array<uint8_t, MAX_LINE_LEN> line_{};
+    std::array<uint8_t, CanFrame::MAX_LEN> payload_{};
+    uint8_t line_len_ = 0;
+    uint8_t data_pos_ = 0;
+    uint8_t payload_len_ = 0;
+};
+
+// Decode one frame line (t/T/r/R/d/D/b/B, without the trailing '\r').
+// The channel prefix is optional and defaults to 0. Returns false for
+// malformed lines and for lines that are not frames (status, replies).
+bool decode_frame(const uint8_t* line, size_t len, uint8_t& channel, CanFrame& frame);
+
+// decode_frame() in two steps, so a frame can be filtered on its ID before
+// any payload digit is decoded.
+struct FrameHeader {
+    uint8_t channel = 0;
+    uint32_t id = 0;
+    bool ext = false;
+    bool rtr = false;
+    bool fd = false;
+    bool brs = false;
+    uint8_t dlc = 0;
+    uint8_t payload_len = 0; // Bytes on the wire
+    uint8_t payload_pos = 0; // Offset of the first payload digit in the line
+};
+
+// Prefix, command, ID and DLC; also checks the line is long enough for the
+// payload. Returns false where decode_frame() would.
+bool decode_header(const uint8_t* line, size_t len, FrameHeader& h);
+
+// Payload of a line accepted by decode_header(). False on a bad hex digit.
+bool decode_payload(const uint8_t* line, const FrameHeader& h, CanFrame& frame);
+
+// Splits a byte stream into '\r'-terminated lines without copying.
+// Complete lines are handed out as pointers into the caller's buffer; only a
+// line that straddles two reads is carried over in a small fixed buffer.
+class LineParser {
+public:
+    // Longest line kept; anything longer is dropped up to the next '\r'.
+    static constexpr size_t MAX_PENDING = 256;
+
+    // Calls on_line(const uint8_t* line, size_t len) for each complete line.
+    template <typename OnLine>
+    void feed(const uint8_t* data, size_t n, OnLine&& on_line) {
+        const uint8_t* p = data;
+        const uint8_t* end = data + n;
+        while (p < end) {
+            const uint8_t* cr = static_cast<const uint8_t*>(std::memchr(p, '\r', (size_t)(end - p)));
+            if (!cr) {
+                append(p, (size_t)(end - p));
+                return;
+            }
+            if (pending_len_ == 0 && !discarding_) {
+                on_line(p, (size_t)(cr - p));
+            } else {
+                append(p, (size_t)(cr - p));
+                if (!discarding_) on_line(pending_.data(), pending_len_);
+                pending_len_ = 0;
+                discarding_ = false;
+            }
+            p = cr + 1;
+        }
+    }
+
+    void reset() { pending_len_ = 0; discarding_ = false; }
+
+    // Number of lines dropped for exceeding MAX_PENDING.
+    uint64_t overflows() const { return overflows_; }
+
+private:
+    void append(const uint8_t* p, size_t n) {
+        if (discarding_) return;
+        if (pending_len_ + n > MAX_PENDING) {
+            discarding_ = true;
+            pending_len_ = 0;
+            ++overflows_;
+            return;
+        }
+        std::memcpy(pending_.data() + pending_len_, p, n);
+        pending_len_ += n;
+    }
+
+    std::array<uint8_t, MAX_PENDING> pending_;
+    size_t pending_len_ = 0;
+    bool discarding_ = false;
+    uint64_t overflows_ = 0;
+};
+
+} // namespace slcanx
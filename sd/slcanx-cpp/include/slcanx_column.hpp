@@ -0,0 +1,226 @@
+#pragma once
+
+// Columnar per-ID capture store for offline analysis (POSIX).
+//
+// Frames are grouped by series, (channel, ID, standard/extended), into
+// blocks of up to block_records frames. A block stores its timestamps, then
+// lengths, flags and fixed-stride payload rows, each as one column. Each
+// block starts with a header carrying its series and min/max timestamp, and
+// a copy of all headers, sorted by series and time, is the index at the end
+// of the file. A query for one ID over a time range reads the index and maps
+// in only the blocks that overlap the range.
+//
+// The writer is a capture sink, so it can be fed live through
+// Slcanx::set_capture() or from any log with open_log() in one pass (see
+// slcanx_convert). It buffers at most one open block per series, within
+// memory_bytes; past that only the index grows, by 40 bytes per block.
+//
+//   slcanx::ColumnReader store("run42.slcol");
+//   store.query(0, 0x123, false, t0, t1, [](const slcanx::ColumnBlockView& b, size_t begin, size_t end) {
+//       for (size_t i = begin; i < end; ++i) use(b.timestamps[i], b.row(i), b.lens[i]);
+//   });
+
+#include "slcanx_capture.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace slcanx {
+
+struct ColumnFileHeader {
+    char magic[8];          // "SLCXCOL\0"
+    uint32_t version;       // 1
+    uint32_t block_records; // Largest block
+    uint64_t records;
+    uint64_t blocks;
+    uint64_t index_offset;  // 0 if the writer did not finish; readers then walk the blocks
+    uint64_t series;
+    uint64_t first_ns;      // Over all records
+    uint64_t last_ns;
+};
+
+static_assert(sizeof(ColumnFileHeader) == 64, "ColumnFileHeader layout is part of the file format");
+
+// ColumnBlockInfo::flags
+constexpr uint8_t COLUMN_EXT = 1 << 0;
+
+// Block header and index entry. The block's columns follow its header:
+// count timestamps (uint64), count lengths, count CAPTURE_* flags, count
+// rows of `stride` payload bytes, then padding to 8 bytes.
+struct ColumnBlockInfo {
+    uint64_t first_ns;      // Smallest / largest timestamp in the block
+    uint64_t last_ns;
+    uint64_t offset;        // Of this header in the file
+    uint32_t id;
+    uint32_t count;
+    uint8_t channel;
+    uint8_t flags;          // COLUMN_EXT
+    uint8_t stride;         // Longest payload in the block
+    uint8_t reserved[5];
+
+    size_t size() const;    // Header and columns, padded
+};
+
+static_assert(sizeof(ColumnBlockInfo) == 40, "ColumnBlockInfo layout is part of the file format");
+
+struct ColumnOptions {
+    std::string path = "capture.slcol";
+    size_t block_records = 1024;       // Frames per block
+    size_t memory_bytes = 64 << 20;    // Open blocks; beyond this all of them are written out early
+    size_t ring_bytes = 4 << 20;       // Producer ring (~40k records)
+    uint32_t flush_interval_ms = 5;    // Longest a record waits in the ring
+};
+
+struct ColumnStats {
+    uint64_t records = 0;   // Stored
+    uint64_t dropped = 0;   // Ring full or write error
+    uint64_t blocks = 0;    // Written so far
+    uint64_t open_series = 0; // With frames not yet in a block
+    uint64_t bytes = 0;     // File size so far
+};
+
+// Records of a series must arrive in time order for blocks not to
+// overlap; a block is sorted by timestamp before it is written either way.
+// Throws std::runtime_error if the file cannot be created.
+class ColumnWriter : public CaptureSink {
+public:
+    explicit ColumnWriter(const ColumnOptions& options = ColumnOptions());
+    ~ColumnWriter() override; // Writes the open blocks and the index
+
+    ColumnStats stats() const;
+
+protected:
+    bool consume(const CaptureRecord& record) override;
+
+private:
+    struct Series {
+        uint8_t channel = 0;
+        uint8_t flags = 0;
+        uint32_t id = 0;
+        std::vector<uint64_t> timestamps;
+        std::vector<uint8_t> lens;
+        std::vector<uint8_t> frame_flags;
+        std::vector<uint8_t> data;     // Payloads back to back
+    };
+
+    bool write_block(Series& s);
+    bool write_all();
+    bool put(const void* data, size_t len);
+    void finish();
+
+    ColumnOptions opt_;
+    std::FILE* file_ = nullptr;
+    std::unordered_map<uint64_t, Series> series_;
+    std::vector<ColumnBlockInfo> index_;
+    std::vector<uint8_t> block_;      // Block being assembled
+    std::vector<uint32_t> starts_;    // Payload offset of each open frame
+    std::vector<uint32_t> order_;     // Rows by timestamp
+    size_t buffered_ = 0;             // Bytes in open blocks
+    uint64_t offset_ = 0;
+    uint64_t first_ns_ = UINT64_MAX;
+    uint64_t last_ns_ = 0;
+    bool failed_ = false;
+
+    std::atomic<uint64_t> blocks_{0};
+    std::atomic<uint64_t> open_series_{0};
+    std::atomic<uint64_t> bytes_{0};
+};
+
+// Columns of one block, pointing into the read-only mapping.
+struct ColumnBlockView {
+    const ColumnBlockInfo* info = nullptr;
+    const uint64_t* timestamps = nullptr;  // Ascending
+    const uint8_t* lens = nullptr;
+    const uint8_t* flags = nullptr;        // CAPTURE_RTR / FD / BRS / TX
+    const uint8_t* payload = nullptr;
+
+    size_t size() const { return info ? info->count : 0; }
+    const uint8_t* row(size_t i) const { return payload + i * info->stride; }
+};
+
+struct ColumnSeries {
+    uint8_t channel;
+    bool ext;
+    uint32_t id;
+    uint64_t records;
+    uint64_t first_ns;
+    uint64_t last_ns;
+    size_t blocks;
+};
+
+struct ColumnQueryStats {
+    uint64_t blocks = 0;    // Blocks read
+    uint64_t rows = 0;      // Frames in range
+};
+
+// Maps the file read-only. Throws std::runtime_error if it cannot be opened
+// or is not a column store.
+class ColumnReader {
+public:
+    explicit ColumnReader(const std::string& path);
+    ~ColumnReader();
+    ColumnReader(const ColumnReader&) = delete;
+    ColumnReader& operator=(const ColumnReader&) = delete;
+
+    // Counts are rebuilt from the blocks for an unfinished file.
+    const ColumnFileHeader& header() const { return header_; }
+    // Every series, in index order. Built from the index alone.
+    std::vector<ColumnSeries> series() const;
+
+    // Index entries of one series, oldest first; no block data is read.
+    span<const ColumnBlockInfo> blocks(uint8_t channel, uint32_t id, bool ext = false) const;
+    ColumnBlockView block(const ColumnBlockInfo& info) const;
+
+    // Calls fn(view, begin, end) for each block of the series holding
+    // frames with from_ns <= timestamp <= to_ns; rows [begin, end) are the
+    // ones in range. Blocks outside the range are not touched.
+    template <typename Fn>
+    ColumnQueryStats query(uint8_t channel, uint32_t id, bool ext, uint64_t from_ns, uint64_t to_ns, Fn&& fn) const;
+
+private:
+    void rebuild_index();
+
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    ColumnFileHeader header_;
+    span<const ColumnBlockInfo> index_;
+    std::vector<ColumnBlockInfo> rebuilt_;  // Index of an unfinished file
+    // last_ns ascends within every series, so queries can binary-search
+    // their first block. Only out-of-order input breaks this.
+    bool ordered_ = true;
+};
+
+inline size_t ColumnBlockInfo::size() const {
+    size_t n = sizeof(ColumnBlockInfo) + (size_t)count * (sizeof(uint64_t) + 2 + stride);
+    return (n + 7) & ~(size_t)7;
+}
+
+template <typename Fn>
+ColumnQueryStats ColumnReader::query(uint8_t channel, uint32_t id, bool ext, uint64_t from_ns, uint64_t to_ns,
+                                     Fn&& fn) const {
+    ColumnQueryStats st;
+    span<const ColumnBlockInfo> all = blocks(channel, id, ext);
+    const ColumnBlockInfo* b = all.begin();
+    if (ordered_) {
+        b = std::partition_point(all.begin(), all.end(),
+                                 [from_ns](const ColumnBlockInfo& x) { return x.last_ns < from_ns; });
+    }
+    for (; b != all.end(); ++b) {
+        if (b->first_ns > to_ns) break; // Sorted by first_ns
+        if (b->last_ns < from_ns) continue;
+        ColumnBlockView v = block(*b);
+        const uint64_t* end = v.timestamps + v.size();
+        const uint64_t* lo = std::lower_bound(v.timestamps, end, from_ns);
+        const uint64_t* hi = std::upper_bound(lo, end, to_ns);
+        ++st.blocks;
+        if (lo == hi) continue;
+        fn(v, (size_t)(lo - v.timestamps), (size_t)(hi - v.timestamps));
+        st.rows += (uint64_t)(hi - lo);
+    }
+    return st;
+}
+
+} // namespace slcanx
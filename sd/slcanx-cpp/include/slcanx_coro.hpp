@@ -0,0 +1,353 @@
+#pragma once
+
+// C++20 coroutine API (POSIX, separate slcanx_coro target).
+//
+// An EventLoop runs epoll on the calling thread and drives any number of
+// Devices; there are no internal threads. Awaiting a device never allocates:
+// awaiters live in the coroutine frame and are linked into intrusive wait
+// lists, and recv()/send() complete without suspending when a frame is
+// already queued or the TX buffer has room.
+//
+//   slcanx::coro::EventLoop loop;
+//   slcanx::coro::Device dev(loop, "/dev/ttyACM0");
+//   slcanx::coro::spawn([&]() -> slcanx::coro::Task<> {
+//       dev.send_cmd(0, "S6");
+//       dev.send_cmd(0, "O");
+//       for (;;) {
+//           slcanx::CanFrame f = co_await dev.recv(0);
+//           co_await dev.send(1, f);
+//       }
+//   }());
+//   loop.run();
+
+#include "slcanx.hpp"
+#include "slcanx_codec.hpp"
+#include "slcanx_queue.hpp"
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace slcanx {
+namespace coro {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+        std::coroutine_handle<> next = h.promise().continuation;
+        return next ? next : std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+};
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    void return_value(T v) { value.emplace(std::move(v)); }
+    T result() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+    void result() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+} // namespace detail
+
+// Lazily started coroutine; runs when awaited (or spawn()ed) and resumes
+// its awaiter by symmetric transfer when done.
+template <typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::Promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    explicit Task(handle_type h) noexcept : h_(h) {}
+    Task(Task&& other) noexcept : h_(std::exchange(other.h_, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(other.h_, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (h_) h_.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        h_.promise().continuation = caller;
+        return h_;
+    }
+    T await_resume() { return h_.promise().result(); }
+
+private:
+    handle_type h_;
+};
+
+namespace detail {
+
+template <typename T>
+inline Task<T> Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+inline Detached run_detached(Task<void> task) {
+    co_await std::move(task);
+}
+
+// FIFO of awaiters linked through their own `next` member.
+template <typename T>
+struct WaitList {
+    T* head = nullptr;
+    T* tail = nullptr;
+
+    bool empty() const { return head == nullptr; }
+    void push(T* w) {
+        w->next = nullptr;
+        if (tail) tail->next = w; else head = w;
+        tail = w;
+    }
+    T* pop() {
+        T* w = head;
+        if (w) {
+            head = w->next;
+            if (!head) tail = nullptr;
+        }
+        return w;
+    }
+};
+
+} // namespace detail
+
+// Start a task on the current thread; it runs until its first suspension
+// and then completes on the event loop. An escaping exception terminates.
+inline void spawn(Task<void> task) {
+    detail::run_detached(std::move(task));
+}
+
+// Single-threaded epoll loop. All Device operations and all coroutines
+// awaiting them must run on the thread that calls run()/run_once().
+class EventLoop {
+public:
+    struct Watcher {
+        virtual void on_io(uint32_t events) = 0; // epoll events for its fd
+        virtual void flush() = 0;                // End of each pass: push out TX
+    protected:
+        ~Watcher() = default;
+    };
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Run until stop().
+    void run();
+
+    // One pass: resume ready coroutines, wait up to timeout_ms (-1 = forever)
+    // for I/O, dispatch it. Returns false if stop() was called.
+    bool run_once(int timeout_ms = -1);
+
+    // Make run() return. Safe to call from any thread.
+    void stop();
+
+    // Resume `h` on the next pass.
+    void post(std::coroutine_handle<> h) { ready_.push_back(h); }
+
+    // Device plumbing
+    void add(int fd, uint32_t events, Watcher* w);
+    void modify(int fd, uint32_t events, Watcher* w);
+    void remove(int fd, Watcher* w);
+
+private:
+    void drain_ready();
+
+    int epfd_ = -1;
+    int wakefd_ = -1;
+    bool stopped_ = false;
+    std::vector<std::coroutine_handle<>> ready_;
+    std::vector<std::coroutine_handle<>> running_;
+    std::vector<Watcher*> watchers_;
+};
+
+// One SLCANX adapter on an EventLoop. Frames for a channel nobody is
+// awaiting are queued per channel (drop-newest when full, see rx_stats()).
+class Device : private EventLoop::Watcher {
+public:
+    // Opens the tty (raw, non-blocking) and registers it with `loop`.
+    // Throws std::runtime_error on failure.
+    Device(EventLoop& loop, const std::string& port, uint32_t baudrate = 115200,
+           size_t rx_queue_depth = 4096, size_t tx_buffer_bytes = 256 * 1024);
+    ~Device();
+    Device(const Device&) = delete;
+    Device& operator=(const Device&) = delete;
+
+    class RecvAwaiter;
+    class SendAwaiter;
+    class QueryAwaiter;
+
+    // co_await -> CanFrame. Suspends only if nothing is queued on the channel.
+    RecvAwaiter recv(uint8_t channel);
+
+    // co_await -> void. Suspends only while the TX buffer is full; the bytes
+    // go out at the end of the current loop pass, together with every other
+    // send of that pass.
+    SendAwaiter send(uint8_t channel, const CanFrame& frame);
+
+    // co_await -> std::string. Sends a query (q, Q, N, ...) and resumes with
+    // the reply line minus its leading letter. Replies are matched in order
+    // per command letter. There is no timeout; closing the device fails it.
+    QueryAwaiter query(uint8_t channel, char cmd);
+
+    // Queue a plain command (O, C, S6, y500000, ...) without waiting.
+    bool send_cmd(uint8_t channel, std::string_view cmd);
+
+    // False after a port error or hang-up. Pending and later awaits throw.
+    bool is_open() const { return fd_ >= 0; }
+
+    RxQueueStats rx_stats(uint8_t channel) const;
+
+    class RecvAwaiter {
+    public:
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> h);
+        CanFrame await_resume();
+
+    private:
+        friend class Device;
+        friend struct detail::WaitList<RecvAwaiter>;
+        RecvAwaiter(Device& dev, uint8_t channel) : dev_(dev), channel_(channel) {}
+
+        Device& dev_;
+        uint8_t channel_;
+        bool done_ = false;
+        CanFrame frame_;
+        std::coroutine_handle<> handle_;
+        RecvAwaiter* next = nullptr;
+    };
+
+    class SendAwaiter {
+    public:
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> h);
+        void await_resume();
+
+    private:
+        friend class Device;
+        friend struct detail::WaitList<SendAwaiter>;
+        SendAwaiter(Device& dev, uint8_t channel, const CanFrame& frame)
+            : dev_(dev), channel_(channel), frame_(frame) {}
+
+        Device& dev_;
+        uint8_t channel_;
+        bool done_ = false;
+        CanFrame frame_;
+        std::coroutine_handle<> handle_;
+        SendAwaiter* next = nullptr;
+    };
+
+    class QueryAwaiter {
+    public:
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> h);
+        std::string await_resume();
+
+    private:
+        friend class Device;
+        friend struct detail::WaitList<QueryAwaiter>;
+        QueryAwaiter(Device& dev, uint8_t channel, char cmd)
+            : dev_(dev), channel_(channel), cmd_(cmd) {}
+
+        Device& dev_;
+        uint8_t channel_;
+        char cmd_;
+        bool done_ = false;
+        std::string reply_;
+        std::coroutine_handle<> handle_;
+        QueryAwaiter* next = nullptr;
+    };
+
+private:
+    void on_io(uint32_t events) override;
+    void flush() override;
+
+    void handle_line(const uint8_t* line, size_t len);
+    void deliver(uint8_t channel, const CanFrame& frame);
+    void handle_reply(const uint8_t* line, size_t len);
+    bool append_frame(uint8_t channel, const CanFrame& frame);
+    void admit_senders();
+    void fail(); // Close the port and resume every waiter
+
+    EventLoop& loop_;
+    int fd_ = -1;
+    bool want_write_ = false;
+    size_t tx_limit_;
+    std::vector<uint8_t> tx_; // Encoded lines not yet written
+    LineParser lines_;
+    uint64_t read_ts_ = 0;
+    std::unique_ptr<RxQueue> rx_[NUM_CHANNELS];
+    detail::WaitList<RecvAwaiter> recv_waiters_[NUM_CHANNELS];
+    detail::WaitList<SendAwaiter> send_waiters_;
+    detail::WaitList<QueryAwaiter> query_waiters_;
+};
+
+inline Device::RecvAwaiter Device::recv(uint8_t channel) {
+    return RecvAwaiter(*this, channel);
+}
+
+inline Device::SendAwaiter Device::send(uint8_t channel, const CanFrame& frame) {
+    return SendAwaiter(*this, channel, frame);
+}
+
+inline Device::QueryAwaiter Device::query(uint8_t channel, char cmd) {
+    return QueryAwaiter(*this, channel, cmd);
+}
+
+} // namespace coro
+} // namespace slcanx
@@ -0,0 +1,142 @@
+#pragma once
+
+// Cyclic transmission for rest-bus simulation.
+//
+// One thread drives a hierarchical timer wheel on absolute tick deadlines
+// (clock_nanosleep on POSIX), so periods do not drift. Each message is kept
+// as a PreparedFrame; per period only its counter and checksum digits are
+// rewritten, and every message due in the same tick goes to
+// Slcanx::send_encoded() as one buffer, i.e. one USB write.
+//
+//   slcanx::CyclicScheduler cyclic(bus);
+//   uint8_t data[8] = {};
+//   slcanx::CyclicMessage m;
+//   m.channel = 0;
+//   m.frame = slcanx::CanFrame::new_std(0x100, data);
+//   m.period = std::chrono::milliseconds(10);
+//   m.counter_byte = 6;  // Low nibble counts 0..15
+//   m.checksum_byte = 7; // XOR of bytes 0..6
+//   auto id = cyclic.add(m);
+//   ...
+//   slcanx::CyclicStats st = cyclic.stats(id);
+
+#include "slcanx.hpp"
+#include "slcanx_codec.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace slcanx {
+
+// Computes the checksum byte from the payload; `checksum_byte` is the
+// position it will be written to.
+using ChecksumFn = uint8_t (*)(const uint8_t* data, size_t len, size_t checksum_byte);
+
+// XOR / sum of every payload byte except the checksum byte itself.
+uint8_t checksum_xor(const uint8_t* data, size_t len, size_t checksum_byte);
+uint8_t checksum_sum(const uint8_t* data, size_t len, size_t checksum_byte);
+
+struct CyclicMessage {
+    uint8_t channel = 0;
+    CanFrame frame;
+    std::chrono::microseconds period{100000};  // Rounded to whole ticks
+    std::chrono::microseconds offset{0};       // Delay of the first send after add()
+    int counter_byte = -1;                     // Payload byte with a rolling counter (-1 = none)
+    uint8_t counter_mask = 0x0F;               // Counter bits within that byte
+    int checksum_byte = -1;                    // Payload byte with a checksum (-1 = none)
+    ChecksumFn checksum = checksum_xor;
+};
+
+// Jitter is the interval between two consecutive sends minus the period;
+// lateness is how far a send trailed its ideal tick time. Both are measured
+// when the tick's buffer is handed to the TX ring.
+struct CyclicStats {
+    uint64_t sent = 0;
+    uint64_t skipped = 0;        // Periods dropped after the scheduler fell behind
+    int64_t jitter_min_ns = 0;
+    int64_t jitter_max_ns = 0;
+    uint64_t jitter_mean_ns = 0; // Mean absolute jitter
+    uint64_t late_max_ns = 0;
+};
+
+class CyclicScheduler {
+public:
+    using Id = size_t;
+
+    // Starts the scheduler thread. `tick` is the wheel resolution: every
+    // period and offset is a whole number of ticks (at least one).
+    explicit CyclicScheduler(Slcanx& bus, std::chrono::microseconds tick = std::chrono::microseconds(1000));
+    ~CyclicScheduler();
+    CyclicScheduler(const CyclicScheduler&) = delete;
+    CyclicScheduler& operator=(const CyclicScheduler&) = delete;
+
+    // Encode and schedule a message. Throws std::runtime_error for an
+    // invalid channel or counter/checksum byte outside the payload.
+    Id add(const CyclicMessage& msg);
+
+    // Stop sending a message. Its id is not reused.
+    bool remove(Id id);
+
+    // Replace payload bytes [offset, offset + bytes.size()) from the next
+    // period on. Counter and checksum are still applied on top.
+    bool update(Id id, size_t offset, span<const uint8_t> bytes);
+
+    CyclicStats stats(Id id) const;
+
+private:
+    struct Message {
+        PreparedFrame frame;
+        uint64_t period_ticks = 1;
+        uint64_t period_ns = 0;
+        uint64_t due_tick = 0;
+        int counter_byte = -1;
+        uint8_t counter_mask = 0;
+        uint8_t counter_shift = 0;
+        uint8_t counter = 0;
+        int checksum_byte = -1;
+        ChecksumFn checksum = nullptr;
+        bool active = true;
+
+        // Stats
+        uint64_t sent = 0;
+        uint64_t skipped = 0;
+        uint64_t last_sent_ns = 0;
+        int64_t jitter_min_ns = 0;
+        int64_t jitter_max_ns = 0;
+        uint64_t jitter_abs_sum_ns = 0;
+        uint64_t jitter_count = 0;
+        uint64_t late_max_ns = 0;
+    };
+
+    // 4 levels of 64 slots: level n holds messages due within 64^(n+1) ticks.
+    static constexpr int WHEEL_BITS = 6;
+    static constexpr int WHEEL_SLOTS = 1 << WHEEL_BITS;
+    static constexpr int WHEEL_LEVELS = 4;
+
+    void run();
+    void insert(uint32_t index);
+    void cascade(int level);
+    void run_tick(uint64_t last_tick, uint64_t now_ns);
+    void emit(Message& m, uint64_t now_ns);
+
+    Slcanx& bus_;
+    uint64_t tick_ns_;
+    uint64_t start_ns_ = 0;  // Time of tick 0
+    uint64_t now_tick_ = 0;  // Last tick processed
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool running_ = true;
+    size_t active_ = 0;
+    std::vector<Message> messages_;
+    std::vector<uint32_t> wheel_[WHEEL_LEVELS][WHEEL_SLOTS];
+    std::vector<uint32_t> due_;   // Slot being fired
+    std::vector<uint8_t> batch_;  // Lines of the current tick
+    std::vector<uint8_t> sending_;
+    std::thread thread_;
+};
+
+} // namespace slcanx
@@ -0,0 +1,75 @@
+#pragma once
+
+// Per-channel acceptance filters for the RX path (Slcanx::set_filter()).
+//
+// Rules are compiled into a 2048-bit bitmap for 11-bit IDs and a sorted
+// interval table for 29-bit IDs, and are checked right after the ID digits
+// are decoded, so rejected frames never have their payload decoded.
+//
+//   slcanx::FilterBank bank;
+//   bank.accept(0x100, 0x7F0)              // 0x100..0x10F
+//       .accept_range(0x18FF0000, 0x18FFFFFF, true)
+//       .types(slcanx::FILTER_CLASSIC | slcanx::FILTER_FD);
+//   bus.set_filter(0, bank);
+
+#include "slcanx_codec.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace slcanx {
+
+// Frame kinds for FilterBank::types().
+constexpr uint8_t FILTER_CLASSIC = 1 << 0; // t/T
+constexpr uint8_t FILTER_REMOTE = 1 << 1;  // r/R
+constexpr uint8_t FILTER_FD = 1 << 2;      // d/D/b/B
+constexpr uint8_t FILTER_ALL_TYPES = FILTER_CLASSIC | FILTER_REMOTE | FILTER_FD;
+
+// An empty bank rejects every frame; a channel without a bank accepts all.
+class FilterBank {
+public:
+    // Accept IDs with (frame_id & mask) == (id & mask).
+    FilterBank& accept(uint32_t id, uint32_t mask, bool ext = false);
+    // Accept IDs first..last inclusive.
+    FilterBank& accept_range(uint32_t first, uint32_t last, bool ext = false);
+    // Frame kinds let through at all (default FILTER_ALL_TYPES).
+    FilterBank& types(uint8_t flags);
+
+    // Build the lookup tables. Slcanx::set_filter() does this on its copy.
+    void compile();
+
+    // Valid after compile().
+    bool accepts(const FrameHeader& h) const {
+        uint8_t type = h.fd ? FILTER_FD : (h.rtr ? FILTER_REMOTE : FILTER_CLASSIC);
+        if (!(types_ & type)) return false;
+        if (!h.ext) return (std_bits_[h.id >> 6] >> (h.id & 63)) & 1;
+        return accepts_ext(h.id);
+    }
+
+private:
+    struct Rule {
+        bool ext;
+        bool range;
+        uint32_t a; // id, or first for ranges
+        uint32_t b; // mask, or last for ranges
+    };
+    struct Interval {
+        uint32_t first;
+        uint32_t last;
+    };
+    struct MaskRule {
+        uint32_t id;
+        uint32_t mask;
+    };
+
+    bool accepts_ext(uint32_t id) const;
+
+    std::vector<Rule> rules_;
+    uint8_t types_ = FILTER_ALL_TYPES;
+
+    // Compiled
+    uint64_t std_bits_[2048 / 64] = {};
+    std::vector<Interval> ext_intervals_; // Sorted, disjoint
+    std::vector<MaskRule> ext_masks_;     // Masks with too many scattered free bits to expand
+};
+
+} // namespace slcanx
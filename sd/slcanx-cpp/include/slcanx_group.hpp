@@ -0,0 +1,128 @@
+#pragma once
+
+// Many SLCANX adapters on a fixed set of event loop threads (POSIX).
+//
+// Every device is opened with SlcanxOptions::external_drive, so it starts no
+// threads of its own. Its serial fd goes into the epoll set of one of the
+// group's loops (the least loaded one when it is added); that loop reads,
+// parses, runs the TX coalescing window on a timerfd and delivers frames.
+// The thread count is set once and stays the same however many devices are
+// added, and loops can be pinned to chosen cores.
+//
+// Channels are addressed as (device, channel): the device index is returned
+// by add() and never reused. Received frames of all devices are merged into
+// one SPSC queue per loop and come out of recv() tagged with both.
+//
+//   slcanx::DeviceGroup group;
+//   uint16_t a = group.add("/dev/ttyACM0");
+//   uint16_t b = group.add("/dev/ttyACM1");
+//   group.device(a).configure(...);
+//   slcanx::GroupFrame rx[64];
+//   size_t n = group.recv(rx, std::chrono::milliseconds(100));
+//   group.send(b, rx[0].channel, rx[0].frame);
+
+#include "slcanx.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace slcanx {
+
+// A received frame with its source.
+struct GroupFrame {
+    uint16_t device = 0;
+    uint8_t channel = 0;
+    CanFrame frame;
+};
+
+struct DeviceGroupOptions {
+    SlcanxOptions device;               // For every device; external_drive is forced on
+    unsigned threads = 1;               // Event loops, fixed for the group's lifetime
+    std::vector<int> cpus;              // Loop i runs on cpus[i % size] (empty = not pinned)
+    size_t max_devices = 64;
+    size_t rx_queue_depth = 16384;      // Frames per loop in the merged RX queue
+    RxOverflowPolicy rx_overflow = RxOverflowPolicy::DropNewest;
+};
+
+struct DeviceGroupStats {
+    size_t devices = 0;
+    size_t online = 0;        // Devices whose port has not failed
+    unsigned threads = 0;
+    uint64_t wakeups = 0;     // epoll_wait returns over all loops
+    uint64_t rx_frames = 0;   // Frames queued into the merged queues
+    uint64_t rx_dropped = 0;  // Frames lost to merged queue overflow
+    size_t rx_depth = 0;      // Frames currently queued
+};
+
+class DeviceGroup {
+public:
+    using RxCallback = std::function<void(uint16_t device, uint8_t channel, const CanFrame&)>;
+
+    // Starts the loop threads. Throws std::runtime_error.
+    explicit DeviceGroup(const DeviceGroupOptions& options = DeviceGroupOptions());
+    ~DeviceGroup();
+    DeviceGroup(const DeviceGroup&) = delete;
+    DeviceGroup& operator=(const DeviceGroup&) = delete;
+
+    // Open a port and hand it to a loop; safe while traffic is running.
+    // Returns the device index. Throws std::runtime_error if the port cannot
+    // be opened or max_devices is reached.
+    uint16_t add(const std::string& port);
+
+    size_t size() const { return count_.load(std::memory_order_acquire); }
+
+    // The device itself, for configure(), query(), filters and metrics. Its
+    // set_rx_callback() and recv() belong to the group and must not be used.
+    Slcanx& device(uint16_t device);
+
+    // False once the loop saw the port hang up or fail.
+    bool online(uint16_t device) const;
+
+    // Lock-free from any thread, see Slcanx::send() / try_send().
+    bool send(uint16_t device, uint8_t channel, const CanFrame& frame);
+    bool try_send(uint16_t device, uint8_t channel, const CanFrame& frame);
+    size_t send_batch(uint16_t device, span<const ChannelFrame> frames);
+
+    // Called on the loop threads, one call at a time per loop. While set,
+    // frames bypass the merged queues.
+    void set_rx_callback(RxCallback cb);
+
+    // Pull up to frames.size() frames from the merged queues, taking turns
+    // between loops. Waits up to `timeout` for the first one (0 = don't
+    // wait). One consumer thread.
+    size_t recv(span<GroupFrame> frames,
+                std::chrono::nanoseconds timeout = std::chrono::nanoseconds::zero());
+
+    DeviceGroupStats stats() const;
+
+private:
+    struct Device;
+    struct Loop;
+
+    void run(Loop& loop);
+    void deliver(Loop& loop, uint16_t device, uint8_t channel, const CanFrame& frame);
+    size_t pop(GroupFrame* out, size_t max);
+    void stop();
+    Device& at(uint16_t device) const;
+
+    DeviceGroupOptions opt_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::unique_ptr<std::unique_ptr<Device>[]> devices_; // max_devices slots
+    std::atomic<size_t> count_{0};
+    std::mutex add_mutex_;
+    std::atomic<bool> running_{true};
+
+    // Merged queue consumer
+    size_t next_loop_ = 0;
+    std::atomic<bool> rx_waiting_{false};
+    std::mutex rx_mutex_;
+    std::condition_variable rx_cv_;
+};
+
+} // namespace slcanx
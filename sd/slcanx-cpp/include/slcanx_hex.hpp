@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace slcanx {
+namespace hex {
+
+// Hex codec for SLCAN payloads (up to 64 bytes = 128 characters for CAN FD).
+// The implementation is picked once at startup from what the CPU supports:
+// AVX2, SSE2 or a table-driven scalar fallback.
+
+enum class Isa { Scalar, SSE2, AVX2 };
+
+// Write 2*n upper-case hex characters for n bytes.
+void encode(const uint8_t* in, size_t n, uint8_t* out);
+
+// Decode 2*n hex characters (either case) into n bytes.
+// Returns false if any character is not a hex digit.
+bool decode(const uint8_t* in, size_t n, uint8_t* out);
+
+// True if all `len` characters are hex digits.
+bool validate(const uint8_t* in, size_t len);
+
+Isa active_isa();
+const char* isa_name(Isa isa);
+
+// Force an implementation, e.g. to compare them in benchmarks.
+// Returns false (and changes nothing) if the CPU or build lacks it.
+bool set_isa(Isa isa);
+
+} // namespace hex
+} // namespace slcanx
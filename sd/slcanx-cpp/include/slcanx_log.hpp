@@ -0,0 +1,163 @@
+#pragma once
+
+// Streaming Vector ASC / BLF and candump .log files (POSIX).
+//
+// The writers are capture sinks: producers copy records into the lock-free
+// ring of CaptureSink, and its background thread formats them, packs BLF
+// objects into log containers, deflates each full container with zlib and
+// appends it to the file. Readers return one record at a time. Both sides
+// hold at most one container (or one line) in memory, whatever the size of
+// the file.
+//
+//   slcanx::BlfWriter blf("run42.blf");
+//   bus.set_capture(&blf);
+//   ...
+//   auto log = slcanx::open_log("run42.blf");   // .blf, .asc, .log or a capture
+//   slcanx::CaptureRecord r;
+//   while (log->next(r)) { ... }
+//
+// Channels are 1-based in ASC and BLF files and 0-based in CaptureRecord.
+// Timestamps in the files count from the start of measurement; readers
+// return them as wall clock time (Unix ns).
+
+#include "slcanx_capture.hpp"
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace slcanx {
+
+struct LogOptions {
+    size_t ring_bytes = 4 << 20;           // Producer ring (~40k records)
+    uint32_t flush_interval_ms = 5;        // Longest a record waits in the ring
+    // Wall clock time (Unix ns) of the measurement start, written to the file
+    // header. 0: the first record's timestamp if it is a wall clock reading,
+    // else the time that record reaches the writer.
+    uint64_t start_time_ns = 0;
+    // BLF only. zlib level 1..9, 0 = store containers uncompressed; level 6
+    // makes files ~10% smaller than 1 at twice the CPU time.
+    int compression_level = 1;
+    size_t container_bytes = 128 << 10;    // BLF: uncompressed size of a log container
+};
+
+struct LogStats {
+    uint64_t records = 0;   // Written to the file
+    uint64_t dropped = 0;   // Ring full or write error
+    uint64_t bytes = 0;     // File size so far
+};
+
+// Common part of the file writers: the file, start time and statistics.
+// Throws std::runtime_error if the file cannot be created.
+class LogWriter : public CaptureSink {
+public:
+    ~LogWriter() override;
+
+    LogStats stats() const;
+
+protected:
+    LogWriter(const std::string& path, const LogOptions& options);
+
+    // Background thread
+    bool consume(const CaptureRecord& record) override;
+    virtual bool append(const CaptureRecord& record, uint64_t offset_ns) = 0; // From the start
+    virtual void begin() {}   // Before the first record
+    virtual void end() {}     // After the last one, before the file is closed
+    bool put(const void* data, size_t len);
+    // Stops the thread, calls end() and closes the file. Subclass destructors
+    // call it first.
+    void close();
+
+    LogOptions opt_;
+    std::FILE* file_ = nullptr;
+    uint64_t start_ns_ = 0;    // Wall clock at offset 0, valid after begin()
+    uint64_t first_ns_ = 0;    // Record timestamp at offset 0
+
+private:
+    bool started_ = false;
+    bool failed_ = false;
+    std::atomic<uint64_t> bytes_{0};
+};
+
+// Vector ASC, "base hex  timestamps absolute", microsecond resolution.
+class AscWriter : public LogWriter {
+public:
+    explicit AscWriter(const std::string& path, const LogOptions& options = LogOptions());
+    ~AscWriter() override;
+
+protected:
+    bool append(const CaptureRecord& record, uint64_t offset_ns) override;
+    void begin() override;
+    void end() override;
+};
+
+// Vector BLF: CAN_MESSAGE and CAN_FD_MESSAGE objects with nanosecond
+// timestamps in zlib-compressed log containers. The file header (size,
+// object count, last timestamp) is rewritten when the writer closes.
+class BlfWriter : public LogWriter {
+public:
+    explicit BlfWriter(const std::string& path, const LogOptions& options = LogOptions());
+    ~BlfWriter() override;
+
+protected:
+    bool append(const CaptureRecord& record, uint64_t offset_ns) override;
+    void end() override;
+
+private:
+    struct Deflater;
+
+    bool write_container();
+    void write_header();
+
+    std::unique_ptr<Deflater> deflater_;
+    std::vector<uint8_t> container_;
+    std::vector<uint8_t> compressed_;
+    uint64_t objects_ = 0;
+    uint64_t uncompressed_ = 0;
+    uint64_t last_offset_ns_ = 0;
+};
+
+// candump -l format, "(1436509052.249713) can0 123#DEADBEEF".
+class CandumpWriter : public LogWriter {
+public:
+    explicit CandumpWriter(const std::string& path, const LogOptions& options = LogOptions());
+    ~CandumpWriter() override;
+
+protected:
+    bool append(const CaptureRecord& record, uint64_t offset_ns) override;
+};
+
+// By extension: .asc, .blf or .log. Throws std::runtime_error for anything else.
+std::unique_ptr<LogWriter> open_log_writer(const std::string& path, const LogOptions& options = LogOptions());
+
+struct LogReaderOptions {
+    // candump interface -> channel. Names not listed use their trailing
+    // number (can1 -> 1), or 0 without one; -1 skips the interface.
+    std::map<std::string, int> interfaces;
+    std::string capture_prefix = "capture";  // For capture directories
+};
+
+// One record at a time. Lines and objects that are not CAN frames are
+// skipped and counted.
+class LogReader {
+public:
+    virtual ~LogReader() = default;
+
+    // Next record; false at the end.
+    virtual bool next(CaptureRecord& out) = 0;
+    // Back to the first record.
+    virtual void rewind() = 0;
+
+    uint64_t skipped() const { return skipped_; }
+
+protected:
+    uint64_t skipped_ = 0;
+};
+
+// Opens a capture (directory or .slcap segment), BLF, ASC or candump log;
+// the format is taken from the file contents. Throws std::runtime_error if
+// the file cannot be opened or its header is invalid.
+std::unique_ptr<LogReader> open_log(const std::string& path, const LogReaderOptions& options = LogReaderOptions());
+
+} // namespace slcanx
@@ -0,0 +1,147 @@
+#pragma once
+
+// Runtime metrics (Slcanx::snapshot()).
+//
+// Counters are relaxed atomics, each written by one SDK thread, so keeping
+// them costs a load and a store; snapshot() only reads. Where a frame got
+// lost shows up in a different place per layer:
+//
+//   host      rx_dropped (RX queue full), tx_rejected / tx_blocked (TX ring full)
+//   USB link  parse_errors, line_overflows, unknown_lines, read/write_errors
+//   firmware  fw_rx_overflow, fw_tx_full, fw_usb_overflow, from the device's
+//             "<ch>Eslffttss" status lines
+//
+//   slcanx::MetricsSnapshot m = bus.snapshot();
+//   std::cout << m.tx_latency_ns.quantile(0.99) << "\n";
+//   std::cout << slcanx::format_metrics(m);  // Prometheus text format
+
+#include "slcanx.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace slcanx {
+
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> counts; // Per bucket, see Histogram::bucket_low()
+
+    double mean() const { return count ? (double)sum / (double)count : 0.0; }
+    // Upper edge of the bucket holding the q-quantile (q in 0..1), capped at max.
+    uint64_t quantile(double q) const;
+};
+
+// Log-linear histogram in the style of HdrHistogram: exact below 16, then
+// 16 buckets per power of two (at most 6.25% relative error) up to 2^40;
+// larger values land in the last bucket. record() is for one writer thread,
+// snapshot() may run concurrently from any thread.
+class Histogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int MAX_BITS = 40;
+    static constexpr size_t BUCKETS = (size_t)(MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+    void record(uint64_t value) {
+        bump(counts_[bucket_of(value)], 1);
+        bump(sum_, value);
+        if (value > max_.load(std::memory_order_relaxed)) max_.store(value, std::memory_order_relaxed);
+    }
+
+    HistogramSnapshot snapshot() const;
+
+    static size_t bucket_of(uint64_t value) {
+        if (value < (1u << SUB_BITS)) return (size_t)value;
+        int e = log2_floor(value);
+        if (e >= MAX_BITS) return BUCKETS - 1;
+        return ((size_t)(e - SUB_BITS + 1) << SUB_BITS) +
+               (size_t)((value >> (e - SUB_BITS)) & ((1u << SUB_BITS) - 1));
+    }
+
+    // Smallest value that falls into bucket i.
+    static uint64_t bucket_low(size_t i) {
+        if (i < (1u << SUB_BITS)) return i;
+        int e = (int)(i >> SUB_BITS) + SUB_BITS - 1;
+        uint64_t sub = (1u << SUB_BITS) + (i & ((1u << SUB_BITS) - 1));
+        return sub << (e - SUB_BITS);
+    }
+
+private:
+    static void bump(std::atomic<uint64_t>& c, uint64_t n) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static int log2_floor(uint64_t v) {
+        int e = 0;
+        for (int s = 32; s > 0; s >>= 1) {
+            if (v >> s) {
+                v >>= s;
+                e += s;
+            }
+        }
+        return e;
+    }
+
+    std::atomic<uint64_t> counts_[BUCKETS] = {};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+struct ChannelMetrics {
+    // Host
+    uint64_t rx_frames = 0;    // Delivered to the callback or the RX queue
+    uint64_t rx_bytes = 0;     // Payload bytes of those frames
+    uint64_t rx_filtered = 0;  // Rejected by the acceptance filter
+    uint64_t rx_dropped = 0;   // Lost to a full RX queue
+    size_t rx_queue_depth = 0;
+    uint64_t tx_frames = 0;    // Handed to the serial port
+    uint64_t tx_bytes = 0;     // Payload bytes of those frames
+
+    // USB link
+    uint64_t parse_errors = 0; // Frame lines for this channel that did not decode
+
+    // Firmware, from E status lines
+    uint64_t status_lines = 0;
+    uint64_t fw_rx_overflow = 0;  // Lines flagging a full CAN RX buffer
+    uint64_t fw_tx_full = 0;      // Lines flagging a full CAN TX FIFO
+    uint64_t fw_usb_overflow = 0; // Lines flagging a full USB IN buffer
+    uint8_t bus_state = 0;        // Last reported: 0 active, 1 warning, 2 passive, 3 bus-off
+    uint8_t fw_flags = 0;
+    uint8_t tx_error_count = 0;
+    uint8_t rx_error_count = 0;
+};
+
+struct MetricsSnapshot {
+    uint64_t timestamp_ns = 0; // steady_clock
+    std::array<ChannelMetrics, NUM_CHANNELS> channels{};
+
+    // Serial link
+    uint64_t reads = 0;          // Serial reads that returned data
+    uint64_t read_bytes = 0;
+    uint64_t read_errors = 0;    // Port errors and hang-ups, not idle polls
+    uint64_t line_overflows = 0; // Lines dropped for missing their '\r'
+    uint64_t unknown_lines = 0;  // Neither a frame, a status line nor an awaited reply
+
+    // TX
+    TxStats tx;
+    uint64_t tx_rejected = 0;    // try_send*() calls refused for a full ring
+    uint64_t tx_blocked = 0;     // send*() calls that had to wait for ring space
+    uint64_t write_errors = 0;   // Serial writes that failed
+    size_t tx_ring_used = 0;     // Bytes queued, including record headers
+    size_t tx_ring_peak = 0;     // Highest tx_ring_used seen by the writer
+    size_t tx_ring_capacity = 0;
+
+    HistogramSnapshot tx_latency_ns;    // send() to serial write done, one sample per write
+    HistogramSnapshot write_bytes;      // Bytes per serial write
+    HistogramSnapshot read_chunk_bytes; // Bytes per serial read
+    HistogramSnapshot callback_ns;      // RX callback duration, every 16th call
+};
+
+// Prometheus text exposition format; histograms become summaries with the
+// 0.5, 0.9, 0.99 and 0.999 quantiles.
+std::string format_metrics(const MetricsSnapshot& m, const std::string& prefix = "slcanx");
+
+} // namespace slcanx
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "slcanx.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace slcanx {
+
+// Bounded lock-free multi-producer / single-consumer byte ring.
+//
+// Producers claim() an exact number of bytes, write them in place and
+// commit(); there is no lock and no allocation after construction. The
+// single consumer (the write thread) drains committed records in order.
+//
+// Each record starts with a 4-byte length header that is 0 while the record
+// is being written, so a slow producer simply holds back the records behind
+// it. A record never wraps: if it does not fit before the end of the buffer
+// the producer also claims the remainder as a padding record.
+class TxRing {
+public:
+    struct Claim {
+        uint8_t* data = nullptr; // Space for `size` bytes
+        size_t size = 0;
+        size_t offset = 0;       // Internal: record position in the ring
+        uint64_t end = 0;        // Ring position just past the record, see drained()
+        explicit operator bool() const { return data != nullptr; }
+    };
+
+    // Capacity is rounded up to a power of two (minimum 4 KiB).
+    explicit TxRing(size_t capacity) {
+        size_t cap = 4096;
+        while (cap < capacity) cap <<= 1;
+        capacity_ = cap;
+        mask_ = cap - 1;
+        buffer_.reset(new uint8_t[cap]);
+        std::memset(buffer_.get(), 0, cap);
+    }
+
+    TxRing(const TxRing&) = delete;
+    TxRing& operator=(const TxRing&) = delete;
+
+    size_t capacity() const { return capacity_; }
+
+    // Largest record a single claim can hold.
+    size_t max_claim() const { return capacity_ / 2 - HEADER; }
+
+    // Reserve `size` bytes. Returns an empty claim if the ring is full or
+    // `size` exceeds max_claim(). Never blocks.
+    Claim claim(size_t size) {
+        if (size == 0 || size > max_claim()) return Claim{};
+        size_t rec = record_size(size);
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t off = (size_t)(head & mask_);
+            size_t to_end = capacity_ - off;
+            size_t padding = rec > to_end ? to_end : 0;
+            uint64_t need = padding + rec;
+            uint64_t tail = tail_.load(std::memory_order_acquire);
+            if (head + need - tail > capacity_) return Claim{};
+            if (head_.compare_exchange_weak(head, head + need,
+                                            std::memory_order_relaxed,
+                                            std::memory_order_relaxed)) {
+                if (padding) {
+                    header(off).store(-(int32_t)padding, std::memory_order_release);
+                    off = 0;
+                }
+                Claim c;
+                c.data = buffer_.get() + off + HEADER;
+                c.size = size;
+                c.offset = off;
+                c.end = head + need;
+                return c;
+            }
+        }
+    }
+
+    // Publish a claimed record to the consumer.
+    void commit(const Claim& c) {
+        header(c.offset).store((int32_t)c.size, std::memory_order_release);
+    }
+
+    // Consumer side: call fn(const uint8_t* data, size_t len) for every
+    // committed record in order, then release their space. Stops at the first
+    // record that is still being written. Returns the number of bytes handed out.
+    template <typename Fn>
+    size_t drain(Fn&& fn) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        size_t bytes = 0;
+        for (;;) {
+            size_t off = (size_t)(tail & mask_);
+            int32_t h = header(off).load(std::memory_order_acquire);
+            if (h == 0) break;
+            size_t rec;
+            if (h < 0) {
+                rec = (size_t)(-h);
+            } else {
+                rec = record_size((size_t)h);
+                fn(buffer_.get() + off + HEADER, (size_t)h);
+                bytes += (size_t)h;
+            }
+            // Any 8-byte slot may become a header later, so clear it all
+            std::memset(buffer_.get() + off + HEADER, 0, rec - HEADER);
+            header(off).store(0, std::memory_order_relaxed);
+            tail += rec;
+        }
+        tail_.store(tail, std::memory_order_release);
+        return bytes;
+    }
+
+    // True if the next record is committed (consumer side).
+    bool readable() const {
+        size_t off = (size_t)(tail_.load(std::memory_order_relaxed) & mask_);
+        return header(off).load(std::memory_order_acquire) != 0;
+    }
+
+    // Monotonic ring positions: total bytes ever claimed / drained, including
+    // headers and padding. Their difference is used().
+    uint64_t claimed() const { return head_.load(std::memory_order_acquire); }
+    uint64_t drained() const { return tail_.load(std::memory_order_acquire); }
+
+    // Bytes claimed but not yet drained, including headers and padding.
+    size_t used() const {
+        return (size_t)(head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed));
+    }
+
+private:
+    static constexpr size_t HEADER = 4;
+    static constexpr size_t ALIGN = 8;
+
+    static size_t record_size(size_t size) {
+        return (HEADER + size + ALIGN - 1) & ~(ALIGN - 1);
+    }
+
+    std::atomic<int32_t>& header(size_t off) const {
+        return *reinterpret_cast<std::atomic<int32_t>*>(buffer_.get() + off);
+    }
+
+    size_t capacity_;
+    size_t mask_;
+    std::unique_ptr<uint8_t[]> buffer_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+};
+
+static_assert(std::atomic<int32_t>::is_always_lock_free, "TxRing needs lock-free 32-bit atomics");
+
+// Bounded single-producer / single-consumer frame ring (RxQueue: one per
+// channel, filled by the read thread and drained by the application).
+//
+// When full, DropNewest discards the incoming frame. DropOldest lets the
+// producer advance the tail itself; the consumer copies frames out first and
+// then commits with a CAS on the tail, retrying if the producer overwrote
+// what it was copying in the meantime.
+template <typename T>
+class BasicRxQueue {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "BasicRxQueue needs trivially copyable items");
+
+    BasicRxQueue(size_t depth, RxOverflowPolicy policy) : policy_(policy) {
+        size_t cap = 16;
+        while (cap < depth) cap <<= 1;
+        capacity_ = cap;
+        mask_ = cap - 1;
+        slots_.reset(new T[cap]);
+    }
+
+    BasicRxQueue(const BasicRxQueue&) = delete;
+    BasicRxQueue& operator=(const BasicRxQueue&) = delete;
+
+    size_t capacity() const { return capacity_; }
+    RxOverflowPolicy policy() const { return policy_; }
+
+    // Producer side. Returns false if the frame (or an older one) was dropped.
+    bool push(const T& frame) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        bool dropped = false;
+        if (head - tail >= capacity_) {
+            if (policy_ == RxOverflowPolicy::DropNewest) {
+                count_drop();
+                return false;
+            }
+            // Evict the oldest; if the consumer got there first, nothing is lost
+            if (tail_.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel)) {
+                count_drop();
+                dropped = true;
+            }
+        }
+        slots_[head & mask_] = frame;
+        head_.store(head + 1, std::memory_order_release);
+        pushed_.store(pushed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return !dropped;
+    }
+
+    // Consumer side. Copies up to `max` frames into `out`, returns the count.
+    size_t pop(T* out, size_t max) {
+        for (;;) {
+            uint64_t tail = tail_.load(std::memory_order_acquire);
+            uint64_t head = head_.load(std::memory_order_acquire);
+            size_t n = (size_t)(head - tail);
+            if (n > capacity_) n = capacity_; // raced with an eviction; CAS below fails
+            if (n > max) n = max;
+            if (n == 0) return 0;
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = slots_[(tail + i) & mask_];
+            }
+            if (tail_.compare_exchange_strong(tail, tail + n, std::memory_order_acq_rel)) {
+                return n;
+            }
+        }
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return (size_t)(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+    }
+
+    uint64_t pushed() const { return pushed_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void count_drop() {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    size_t capacity_;
+    size_t mask_;
+    RxOverflowPolicy policy_;
+    std::unique_ptr<T[]> slots_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    // Written by the producer only, read by anyone
+    alignas(64) std::atomic<uint64_t> pushed_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace slcanx
@@ -0,0 +1,116 @@
+#pragma once
+
+// Time-accurate replay of captured traffic (POSIX).
+//
+// Reads anything open_log() takes (slcanx_log.hpp: a binary capture, BLF,
+// ASC or candump .log), and hands each frame to Slcanx at its
+// capture time offset divided by `speed`. The thread sleeps to an absolute
+// deadline with clock_nanosleep and busy-waits the last `spin` microseconds.
+// Frames due together (equal timestamps, or already late) go out as one
+// batch, and by default flush() bypasses the coalescing window. The
+// timing error is measured once each batch has been handed to the serial
+// port.
+//
+//   slcanx::ReplayOptions opt;
+//   opt.speed = 2.0;
+//   slcanx::ReplayEngine replay(bus, "run42.log", opt);
+//   replay.wait();
+//   slcanx::ReplayStats st = replay.stats();
+//   std::cout << st.lateness_ns.quantile(0.99) << "\n";
+
+#include "slcanx.hpp"
+#include "slcanx_metrics.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace slcanx {
+
+class LogReader;
+
+struct ReplayOptions {
+    double speed = 1.0;                      // Time scale, 0.1 .. 10
+    bool max_speed = false;                  // Ignore timestamps, send as fast as the ring takes them
+    uint32_t loops = 1;                      // Passes over the capture (0 = until stop())
+    std::chrono::microseconds loop_gap{1000}; // Pause between passes
+    std::chrono::microseconds spin{100};     // Busy-wait before each deadline
+    bool flush = true;                       // flush() every batch instead of waiting for the TX window
+    // Capture channel -> bus channel (-1 = skip). Empty: identity for 0..3,
+    // anything else is skipped.
+    std::vector<int> channel_map;
+    // candump interface -> capture channel. Names not listed use their
+    // trailing number (can1 -> 1), or 0 without one.
+    std::map<std::string, int> interfaces;
+    std::string capture_prefix = "capture";  // For capture directories
+};
+
+struct ReplayStats {
+    uint64_t frames = 0;          // Handed to the bus
+    uint64_t batches = 0;
+    uint64_t skipped = 0;         // Unmapped channels, unparsable lines
+    uint64_t loops = 0;           // Completed passes
+    std::array<uint64_t, NUM_CHANNELS> channel_frames{};
+    // Hand-off time minus deadline, per frame
+    HistogramSnapshot lateness_ns;
+    // |achieved - intended| gap between consecutive batches
+    HistogramSnapshot interval_error_ns;
+    bool done = false;
+};
+
+class ReplayEngine {
+public:
+    // Opens the capture and starts the replay thread. Throws
+    // std::runtime_error if the file cannot be read or speed is out of range.
+    ReplayEngine(Slcanx& bus, const std::string& path, const ReplayOptions& options = ReplayOptions());
+    ~ReplayEngine(); // Stops
+    ReplayEngine(const ReplayEngine&) = delete;
+    ReplayEngine& operator=(const ReplayEngine&) = delete;
+
+    void stop();
+    void wait();
+    // False if still running after `timeout`.
+    bool wait_for(std::chrono::nanoseconds timeout);
+
+    ReplayStats stats() const;
+
+private:
+    void run();
+    void send();
+
+    Slcanx& bus_;
+    ReplayOptions opt_;
+    std::unique_ptr<LogReader> source_;
+
+    struct Pending {
+        uint64_t deadline_ns;
+        ChannelFrame item;
+    };
+    std::vector<Pending> batch_;
+    std::vector<ChannelFrame> sending_;
+    uint64_t last_deadline_ns_ = 0;   // Of the previous batch
+    uint64_t last_sent_ns_ = 0;
+
+    Histogram lateness_;
+    Histogram interval_error_;
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> loops_{0};
+    std::atomic<uint64_t> channel_frames_[NUM_CHANNELS] = {};
+
+    std::atomic<bool> running_{true};
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool done_ = false;
+    std::thread thread_;
+};
+
+} // namespace slcanx
@@ -0,0 +1,371 @@
+#include "slcanx_capture.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace slcanx {
+
+static const char CAPTURE_MAGIC[8] = {'S', 'L', 'C', 'X', 'C', 'A', 'P', '\0'};
+static constexpr uint32_t CAPTURE_VERSION = 1;
+
+CanFrame CaptureRecord::frame() const {
+    CanFrame f;
+    f.id = id;
+    f.len = len > CanFrame::MAX_LEN ? (uint8_t)CanFrame::MAX_LEN : len;
+    f.ext = (flags & CAPTURE_EXT) != 0;
+    f.rtr = (flags & CAPTURE_RTR) != 0;
+    f.fd = (flags & CAPTURE_FD) != 0;
+    f.brs = (flags & CAPTURE_BRS) != 0;
+    f.timestamp_ns = timestamp_ns;
+    std::memcpy(f.data.data(), data, sizeof(data));
+    return f;
+}
+
+// Sequence number of "<prefix>_<n>.slcap", 0 if the name does not match.
+static uint64_t segment_number(const std::string& name, const std::string& prefix) {
+    static const std::string ext = ".slcap";
+    if (name.size() <= prefix.size() + 1 + ext.size()) return 0;
+    if (name.compare(0, prefix.size(), prefix) != 0 || name[prefix.size()] != '_') return 0;
+    if (name.compare(name.size() - ext.size(), ext.size(), ext) != 0) return 0;
+    uint64_t n = 0;
+    for (size_t i = prefix.size() + 1; i < name.size() - ext.size(); ++i) {
+        if (name[i] < '0' || name[i] > '9') return 0;
+        n = n * 10 + (uint64_t)(name[i] - '0');
+    }
+    return n;
+}
+
+// Segments of a directory, oldest first.
+static std::vector<std::pair<uint64_t, std::string>> list_segments(const std::string& dir,
+                                                                   const std::string& prefix) {
+    std::vector<std::pair<uint64_t, std::string>> found;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return found;
+    while (struct dirent* e = readdir(d)) {
+        uint64_t n = segment_number(e->d_name, prefix);
+        if (n > 0) found.emplace_back(n, dir + "/" + e->d_name);
+    }
+    closedir(d);
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+// ================= CaptureSink =================
+
+CaptureSink::CaptureSink(size_t ring_bytes, uint32_t flush_interval_ms)
+    : ring_(std::make_unique<TxRing>(ring_bytes)), flush_interval_ms_(flush_interval_ms) {}
+
+CaptureSink::~CaptureSink() {
+    stop();
+}
+
+void CaptureSink::start() {
+    thread_ = std::thread(&CaptureSink::run, this);
+}
+
+void CaptureSink::stop() {
+    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_all();
+    }
+    if (thread_.joinable()) thread_.join();
+}
+
+void CaptureSink::write_wait(const CaptureRecord& record) {
+    for (;;) {
+        TxRing::Claim c = ring_->claim(sizeof(CaptureRecord));
+        if (c) {
+            std::memcpy(c.data, &record, sizeof(CaptureRecord));
+            ring_->commit(c);
+            if (ring_->used() > ring_->capacity() / 2) wake();
+            return;
+        }
+        wake();
+        std::this_thread::yield();
+    }
+}
+
+void CaptureSink::run() {
+    const std::chrono::milliseconds interval(flush_interval_ms_);
+    for (;;) {
+        bool stopping = !running_;
+        uint64_t stored = 0, lost = 0;
+        ring_->drain([this, &stored, &lost](const uint8_t* data, size_t len) {
+            if (len != sizeof(CaptureRecord)) return;
+            // Ring records are only 4-byte aligned
+            CaptureRecord r;
+            std::memcpy(&r, data, sizeof(r));
+            if (consume(r)) {
+                ++stored;
+            } else {
+                ++lost;
+            }
+        });
+        idle();
+        if (stored > 0) records_.fetch_add(stored, std::memory_order_relaxed);
+        if (lost > 0) dropped_.fetch_add(lost, std::memory_order_relaxed);
+        if (stopping) break;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv_.wait_for(lock, interval, [this] {
+            return !running_ || ring_->used() > ring_->capacity() / 2;
+        });
+        waiting_.store(false, std::memory_order_relaxed);
+    }
+}
+
+// ================= CaptureWriter =================
+
+struct CaptureWriter::Segment {
+    std::string path;
+    int fd = -1;
+    uint8_t* base = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;  // Records that fit
+    size_t count = 0;     // Records copied in, published to the header by publish()
+    uint64_t last_ns = 0;
+
+    ~Segment() {
+        if (base) munmap(base, size);
+        if (fd >= 0) ::close(fd);
+    }
+
+    CaptureSegmentHeader* header() { return reinterpret_cast<CaptureSegmentHeader*>(base); }
+    uint8_t* record(size_t i) { return base + sizeof(CaptureSegmentHeader) + i * sizeof(CaptureRecord); }
+
+    void publish() {
+        CaptureSegmentHeader* h = header();
+        if (h->records == count) return;
+        if (h->records == 0) std::memcpy(&h->first_ns, record(0), sizeof(uint64_t));
+        h->last_ns = last_ns;
+        // Records first, then the count a concurrent reader trusts
+        std::atomic_thread_fence(std::memory_order_release);
+        h->records = count;
+    }
+};
+
+CaptureWriter::CaptureWriter(const CaptureOptions& options)
+    : CaptureSink(options.ring_bytes, options.flush_interval_ms), opt_(options) {
+    if (opt_.directory.empty()) opt_.directory = ".";
+    if (opt_.segment_bytes < sizeof(CaptureSegmentHeader) + 64 * sizeof(CaptureRecord)) {
+        opt_.segment_bytes = sizeof(CaptureSegmentHeader) + 64 * sizeof(CaptureRecord);
+    }
+    if (::mkdir(opt_.directory.c_str(), 0755) < 0 && errno != EEXIST) {
+        throw std::runtime_error("Failed to create capture directory " + opt_.directory);
+    }
+    // Continue after what an earlier run left, never overwrite it. Its
+    // segments count towards max_segments and are deleted first.
+    auto existing = list_segments(opt_.directory, opt_.prefix);
+    if (!existing.empty()) sequence_ = existing.back().first;
+    for (auto& seg : existing) finished_.push_back(seg.second);
+
+    current_ = prepare();
+    prune(opt_.max_segments - 1);
+    segments_.store(1, std::memory_order_relaxed);
+    bytes_.store(sizeof(CaptureSegmentHeader), std::memory_order_relaxed);
+    start();
+}
+
+CaptureWriter::~CaptureWriter() {
+    stop();
+    if (current_) finish(*current_);
+    if (next_) ::unlink(next_->path.c_str());
+}
+
+CaptureStats CaptureWriter::stats() const {
+    CaptureStats st;
+    st.records = records();
+    st.dropped = dropped();
+    st.segments = segments_.load(std::memory_order_relaxed);
+    st.bytes = bytes_.load(std::memory_order_relaxed);
+    return st;
+}
+
+std::unique_ptr<CaptureWriter::Segment> CaptureWriter::prepare() {
+    auto seg = std::make_unique<Segment>();
+    char name[32];
+    std::snprintf(name, sizeof(name), "_%06llu.slcap", (unsigned long long)++sequence_);
+    seg->path = opt_.directory + "/" + opt_.prefix + name;
+    seg->capacity = (opt_.segment_bytes - sizeof(CaptureSegmentHeader)) / sizeof(CaptureRecord);
+    seg->size = sizeof(CaptureSegmentHeader) + seg->capacity * sizeof(CaptureRecord);
+
+    seg->fd = ::open(seg->path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (seg->fd < 0) throw std::runtime_error("Failed to create capture segment " + seg->path);
+    // Reserve the blocks now, so filling the mapping never hits ENOSPC as SIGBUS
+    int rc = posix_fallocate(seg->fd, 0, (off_t)seg->size);
+    if (rc == EOPNOTSUPP || rc == EINVAL) rc = ::ftruncate(seg->fd, (off_t)seg->size) < 0 ? errno : 0;
+    if (rc != 0) {
+        ::unlink(seg->path.c_str());
+        throw std::runtime_error("Failed to preallocate capture segment " + seg->path);
+    }
+    void* p = mmap(nullptr, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+    if (p == MAP_FAILED) {
+        ::unlink(seg->path.c_str());
+        throw std::runtime_error("Failed to map capture segment " + seg->path);
+    }
+    seg->base = static_cast<uint8_t*>(p);
+    madvise(seg->base, seg->size, MADV_SEQUENTIAL);
+
+    CaptureSegmentHeader* h = seg->header();
+    std::memcpy(h->magic, CAPTURE_MAGIC, sizeof(h->magic));
+    h->version = CAPTURE_VERSION;
+    h->record_size = sizeof(CaptureRecord);
+    h->sequence = sequence_;
+    h->records = 0;
+    h->first_ns = 0;
+    h->last_ns = 0;
+    std::memset(h->reserved, 0, sizeof(h->reserved));
+    return seg;
+}
+
+void CaptureWriter::finish(Segment& seg) {
+    seg.publish();
+    size_t used = sizeof(CaptureSegmentHeader) + seg.count * sizeof(CaptureRecord);
+    munmap(seg.base, seg.size);
+    seg.base = nullptr;
+    // Give back the preallocated tail. If that fails the file stays
+    // readable, since the header bounds the records.
+    int rc = ::ftruncate(seg.fd, (off_t)used);
+    (void)rc;
+    ::close(seg.fd);
+    seg.fd = -1;
+
+    finished_.push_back(seg.path);
+    // While running, the segment being written counts towards max_segments
+    prune(running() ? opt_.max_segments - 1 : opt_.max_segments);
+}
+
+void CaptureWriter::prune(size_t keep) {
+    while (opt_.max_segments > 0 && finished_.size() > keep) {
+        ::unlink(finished_.front().c_str());
+        finished_.pop_front();
+    }
+}
+
+void CaptureWriter::roll() {
+    if (current_) finish(*current_);
+    current_ = std::move(next_);
+    try {
+        if (!current_) current_ = prepare();
+    } catch (const std::runtime_error&) {
+        // Disk full or similar: keep counting what cannot be stored
+        current_.reset();
+        return;
+    }
+    segments_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(sizeof(CaptureSegmentHeader), std::memory_order_relaxed);
+}
+
+bool CaptureWriter::consume(const CaptureRecord& record) {
+    if (current_ && current_->count == current_->capacity) roll();
+    if (!current_) return false;
+    Segment& seg = *current_;
+    std::memcpy(seg.record(seg.count), &record, sizeof(CaptureRecord));
+    seg.last_ns = record.timestamp_ns;
+    ++seg.count;
+    ++unpublished_;
+    return true;
+}
+
+void CaptureWriter::idle() {
+    if (current_) {
+        current_->publish();
+        // Open the next segment while this one still has room
+        if (!next_ && current_->count >= current_->capacity / 2) {
+            try {
+                next_ = prepare();
+            } catch (const std::runtime_error&) {
+                // Retried by roll()
+            }
+        }
+    }
+    if (unpublished_ > 0) {
+        bytes_.fetch_add(unpublished_ * sizeof(CaptureRecord), std::memory_order_relaxed);
+        unpublished_ = 0;
+    }
+}
+
+// ================= CaptureReader =================
+
+CaptureReader::CaptureReader(const std::string& path, const std::string& prefix) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) < 0) throw std::runtime_error("Failed to open capture " + path);
+    if (S_ISDIR(st.st_mode)) {
+        for (auto& seg : list_segments(path, prefix)) files_.push_back(seg.second);
+        if (files_.empty()) throw std::runtime_error("No capture segments in " + path);
+    } else {
+        files_.push_back(path);
+    }
+    open_next();
+}
+
+CaptureReader::~CaptureReader() {
+    unmap();
+}
+
+void CaptureReader::unmap() {
+    if (map_) munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+    header_ = nullptr;
+    pos_ = end_ = nullptr;
+}
+
+bool CaptureReader::open_next() {
+    unmap();
+    while (file_ < files_.size()) {
+        const std::string& path = files_[file_++];
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::runtime_error("Failed to open capture segment " + path);
+        struct stat st;
+        if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(CaptureSegmentHeader)) {
+            ::close(fd);
+            continue; // Cut off before its header was written
+        }
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("Failed to map capture segment " + path);
+        map_ = p;
+        map_size_ = (size_t)st.st_size;
+        madvise(map_, map_size_, MADV_SEQUENTIAL);
+
+        header_ = static_cast<const CaptureSegmentHeader*>(map_);
+        if (std::memcmp(header_->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 ||
+            header_->version != CAPTURE_VERSION || header_->record_size != sizeof(CaptureRecord)) {
+            unmap();
+            throw std::runtime_error("Not a capture segment: " + path);
+        }
+        size_t fit = (map_size_ - sizeof(CaptureSegmentHeader)) / sizeof(CaptureRecord);
+        size_t count = (size_t)std::min<uint64_t>(header_->records, fit);
+        pos_ = reinterpret_cast<const CaptureRecord*>(static_cast<const uint8_t*>(map_) +
+                                                      sizeof(CaptureSegmentHeader));
+        end_ = pos_ + count;
+        if (count > 0) return true;
+        unmap();
+    }
+    return false;
+}
+
+const CaptureRecord* CaptureReader::next() {
+    if (pos_ == end_ && !open_next()) return nullptr;
+    return pos_++;
+}
+
+span<const CaptureRecord> CaptureReader::next_block() {
+    if (pos_ == end_ && !open_next()) return span<const CaptureRecord>();
+    span<const CaptureRecord> block(pos_, (size_t)(end_ - pos_));
+    pos_ = end_;
+    return block;
+}
+
+} // namespace slcanx
@@ -0,0 +1,222 @@
+#include "slcanx_codec.hpp"
+#include "slcanx_hex.hpp"
+#include "hex_kernels.hpp"
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace slcanx {
+
+// ================= Lookup tables =================
+
+using hex::detail::kHexDigits;
+using hex::detail::kHexValues;
+
+static constexpr uint8_t kLenToDlc[CanFrame::MAX_LEN + 1] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8,                          // 0..8
+    9, 9, 9, 9,                                         // 9..12
+    10, 10, 10, 10,                                     // 13..16
+    11, 11, 11, 11,                                     // 17..20
+    12, 12, 12, 12,                                     // 21..24
+    13, 13, 13, 13, 13, 13, 13, 13,                     // 25..32
+    14, 14, 14, 14, 14, 14, 14, 14,                     // 33..40
+    14, 14, 14, 14, 14, 14, 14, 14,                     // 41..48
+    15, 15, 15, 15, 15, 15, 15, 15,                     // 49..56
+    15, 15, 15, 15, 15, 15, 15, 15                      // 57..64
+};
+
+static constexpr uint8_t kDlcToLen[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+uint8_t len_to_dlc(size_t len) {
+    return len <= CanFrame::MAX_LEN ? kLenToDlc[len] : 15;
+}
+
+size_t dlc_to_len(uint8_t dlc) {
+    return dlc < 16 ? kDlcToLen[dlc] : CanFrame::MAX_LEN;
+}
+
+// ================= Encoder =================
+
+char frame_command(const CanFrame& frame) {
+    if (frame.fd) {
+        if (frame.brs) return frame.ext ? 'B' : 'b';
+        return frame.ext ? 'D' : 'd';
+    }
+    if (frame.rtr) return frame.ext ? 'R' : 'r';
+    return frame.ext ? 'T' : 't';
+}
+
+// DLC and number of payload bytes that go on the wire. Classic frames are
+// capped at 8 bytes; FD payloads are padded up to the next valid DLC length.
+static inline void wire_layout(const CanFrame& frame, uint8_t& dlc, size_t& wire_len) {
+    size_t len = frame.len <= CanFrame::MAX_LEN ? frame.len : CanFrame::MAX_LEN;
+    if (frame.fd) {
+        dlc = kLenToDlc[len];
+        wire_len = kDlcToLen[dlc];
+    } else {
+        if (len > 8) len = 8;
+        dlc = (uint8_t)len;
+        wire_len = frame.rtr ? 0 : len;
+    }
+}
+
+size_t encoded_size(const CanFrame& frame) {
+    uint8_t dlc;
+    size_t wire_len;
+    wire_layout(frame, dlc, wire_len);
+    return 1 + 1 + (frame.ext ? 8 : 3) + 1 + 2 * wire_len + 1;
+}
+
+size_t encode_frame(uint8_t channel, const CanFrame& frame, uint8_t* out) {
+    uint8_t dlc;
+    size_t wire_len;
+    wire_layout(frame, dlc, wire_len);
+
+    uint8_t* p = out;
+    *p++ = (uint8_t)('0' + channel);
+    *p++ = (uint8_t)frame_command(frame);
+
+    if (frame.ext) {
+        uint32_t id = frame.id & 0x1FFFFFFF;
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            *p++ = (uint8_t)kHexDigits[(id >> shift) & 0xF];
+        }
+    } else {
+        uint32_t id = frame.id & 0x7FF;
+        p[0] = (uint8_t)kHexDigits[id >> 8];
+        p[1] = (uint8_t)kHexDigits[(id >> 4) & 0xF];
+        p[2] = (uint8_t)kHexDigits[id & 0xF];
+        p += 3;
+    }
+
+    *p++ = (uint8_t)kHexDigits[dlc];
+
+    size_t n = wire_len < frame.len ? wire_len : frame.len;
+    hex::encode(frame.data.data(), n, p);
+    p += 2 * n;
+    for (size_t i = n; i < wire_len; ++i) { // FD padding
+        p[0] = '0';
+        p[1] = '0';
+        p += 2;
+    }
+
+    *p++ = '\r';
+    return (size_t)(p - out);
+}
+
+// ================= PreparedFrame =================
+
+PreparedFrame::PreparedFrame(uint8_t channel, const CanFrame& frame) {
+    if (channel >= NUM_CHANNELS) throw std::runtime_error("Invalid channel");
+    line_len_ = (uint8_t)encode_frame(channel, frame, line_.data());
+    data_pos_ = (uint8_t)(2 + (frame.ext ? 8 : 3) + 1);
+    payload_len_ = (uint8_t)((line_len_ - 1 - data_pos_) / 2);
+    size_t n = payload_len_ < frame.len ? payload_len_ : frame.len;
+    std::memcpy(payload_.data(), frame.data.data(), n); // The rest is FD padding
+}
+
+// ================= Decoder =================
+
+uint64_t frame_duration_ns(const CanFrame& frame, uint32_t bitrate, uint32_t data_bitrate) {
+    if (bitrate == 0) return 0;
+    uint8_t dlc;
+    size_t wire_len;
+    wire_layout(frame, dlc, wire_len);
+
+    uint64_t nominal_bits, data_bits = 0;
+    if (!frame.fd) {
+        // SOF..DLC, data, CRC 15 + delimiter, ACK 2, EOF 7, IFS 3
+        nominal_bits = (frame.ext ? 67 : 47) + 8 * (uint64_t)wire_len;
+    } else {
+        // Arbitration up to BRS, then ESI + DLC + data + stuff count + CRC,
+        // then CRC delimiter, ACK, EOF and IFS back at the nominal rate
+        nominal_bits = (frame.ext ? 36 : 17) + 13;
+        data_bits = 1 + 4 + 8 * (uint64_t)wire_len + 4 + (wire_len <= 16 ? 17 : 21);
+        if (!frame.brs || data_bitrate == 0) {
+            nominal_bits += data_bits;
+            data_bits = 0;
+        }
+    }
+    uint64_t ns = nominal_bits * 1000000000ull / bitrate;
+    if (data_bits) ns += data_bits * 1000000000ull / data_bitrate;
+    return ns;
+}
+
+bool decode_header(const uint8_t* line, size_t len, FrameHeader& h) {
+    const uint8_t* p = line;
+    const uint8_t* end = line + len;
+
+    h.channel = 0;
+    if (p < end && *p >= '0' && *p <= '3') {
+        h.channel = (uint8_t)(*p++ - '0');
+    }
+    if (p >= end) return false;
+
+    bool ext, rtr = false, fd = false, brs = false;
+    switch (*p++) {
+        case 't': ext = false; break;
+        case 'T': ext = true; break;
+        case 'r': ext = false; rtr = true; break;
+        case 'R': ext = true; rtr = true; break;
+        case 'd': ext = false; fd = true; break;
+        case 'D': ext = true; fd = true; break;
+        case 'b': ext = false; fd = true; brs = true; break;
+        case 'B': ext = true; fd = true; brs = true; break;
+        default: return false;
+    }
+
+    size_t id_len = ext ? 8 : 3;
+    if ((size_t)(end - p) < id_len + 1) return false;
+
+    uint32_t id = 0;
+    uint8_t bad = 0;
+    for (size_t i = 0; i < id_len; ++i) {
+        uint8_t v = kHexValues[p[i]];
+        bad |= v;
+        id = (id << 4) | (v & 0xF);
+    }
+    uint8_t dlc = kHexValues[p[id_len]];
+    bad |= dlc;
+    if (bad & 0xF0) return false;
+    p += id_len + 1;
+
+    size_t payload_len;
+    if (fd) {
+        payload_len = kDlcToLen[dlc];
+    } else {
+        if (dlc > 8) return false;
+        payload_len = rtr ? 0 : dlc;
+    }
+    if ((size_t)(end - p) < 2 * payload_len) return false;
+
+    h.id = ext ? (id & 0x1FFFFFFF) : (id & 0x7FF);
+    h.ext = ext;
+    h.rtr = rtr;
+    h.fd = fd;
+    h.brs = brs;
+    h.dlc = dlc;
+    h.payload_len = (uint8_t)payload_len;
+    h.payload_pos = (uint8_t)(p - line);
+    return true;
+}
+
+bool decode_payload(const uint8_t* line, const FrameHeader& h, CanFrame& frame) {
+    if (!hex::decode(line + h.payload_pos, h.payload_len, frame.data.data())) return false;
+
+    frame.id = h.id;
+    frame.len = h.rtr ? h.dlc : h.payload_len;
+    frame.ext = h.ext;
+    frame.rtr = h.rtr;
+    frame.fd = h.fd;
+    frame.brs = h.brs;
+    return true;
+}
+
+bool decode_frame(const uint8_t* line, size_t len, uint8_t& channel, CanFrame& frame) {
+    FrameHeader h;
+    if (!decode_header(line, len, h)) return false;
+    channel = h.channel;
+    return decode_payload(line, h, frame);
+}
+
+} // namespace slcanx
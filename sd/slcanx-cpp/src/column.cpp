@@ -0,0 +1,318 @@
+#include "slcanx_column.hpp"
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace slcanx {
+
+static const char COLUMN_MAGIC[8] = {'S', 'L', 'C', 'X', 'C', 'O', 'L', '\0'};
+static constexpr uint32_t COLUMN_VERSION = 1;
+
+static uint64_t series_key(uint8_t channel, uint8_t flags, uint32_t id) {
+    return (uint64_t)channel << 40 | (uint64_t)flags << 32 | id;
+}
+
+static bool index_less(const ColumnBlockInfo& a, const ColumnBlockInfo& b) {
+    return std::make_tuple(a.channel, a.flags, a.id, a.first_ns) < std::make_tuple(b.channel, b.flags, b.id, b.first_ns);
+}
+
+static bool same_series(const ColumnBlockInfo& a, const ColumnBlockInfo& b) {
+    return a.channel == b.channel && a.flags == b.flags && a.id == b.id;
+}
+
+static uint64_t count_series(const std::vector<ColumnBlockInfo>& sorted) {
+    uint64_t n = 0;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (i == 0 || !same_series(sorted[i - 1], sorted[i])) ++n;
+    }
+    return n;
+}
+
+static void bump(std::atomic<uint64_t>& c, uint64_t n = 1) {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// ================= ColumnWriter =================
+
+ColumnWriter::ColumnWriter(const ColumnOptions& options)
+    : CaptureSink(options.ring_bytes, options.flush_interval_ms), opt_(options) {
+    if (opt_.block_records < 16) opt_.block_records = 16;
+    if (opt_.block_records > UINT32_MAX) opt_.block_records = UINT32_MAX;
+    file_ = std::fopen(opt_.path.c_str(), "wb");
+    if (!file_) throw std::runtime_error("Failed to create " + opt_.path);
+    std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+    // Placeholder without an index, rewritten by finish()
+    ColumnFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, COLUMN_MAGIC, sizeof(h.magic));
+    h.version = COLUMN_VERSION;
+    h.block_records = (uint32_t)opt_.block_records;
+    put(&h, sizeof(h));
+    start();
+}
+
+ColumnWriter::~ColumnWriter() {
+    stop();
+    finish();
+}
+
+ColumnStats ColumnWriter::stats() const {
+    ColumnStats st;
+    st.records = records();
+    st.dropped = dropped();
+    st.blocks = blocks_.load(std::memory_order_relaxed);
+    st.open_series = open_series_.load(std::memory_order_relaxed);
+    st.bytes = bytes_.load(std::memory_order_relaxed);
+    return st;
+}
+
+bool ColumnWriter::put(const void* data, size_t len) {
+    if (failed_) return false;
+    if (std::fwrite(data, 1, len, file_) != len) {
+        // Disk full or similar: keep counting what cannot be stored
+        failed_ = true;
+        return false;
+    }
+    offset_ += len;
+    bump(bytes_, len);
+    return true;
+}
+
+bool ColumnWriter::consume(const CaptureRecord& r) {
+    if (failed_) return false;
+    uint8_t flags = (r.flags & CAPTURE_EXT) ? COLUMN_EXT : 0;
+    uint64_t key = series_key(r.channel, flags, r.id);
+    auto it = series_.find(key);
+    if (it == series_.end()) {
+        it = series_.emplace(key, Series()).first;
+        it->second.channel = r.channel;
+        it->second.flags = flags;
+        it->second.id = r.id;
+        bump(open_series_);
+    }
+    Series& s = it->second;
+    uint8_t len = r.len > CanFrame::MAX_LEN ? (uint8_t)CanFrame::MAX_LEN : r.len;
+    size_t n = (r.flags & CAPTURE_RTR) ? 0 : len;
+    s.timestamps.push_back(r.timestamp_ns);
+    s.lens.push_back(len);
+    s.frame_flags.push_back((uint8_t)(r.flags & ~CAPTURE_EXT));
+    s.data.insert(s.data.end(), r.data, r.data + n);
+    buffered_ += sizeof(uint64_t) + 2 + n;
+    if (r.timestamp_ns < first_ns_) first_ns_ = r.timestamp_ns;
+    if (r.timestamp_ns > last_ns_) last_ns_ = r.timestamp_ns;
+
+    if (s.timestamps.size() >= opt_.block_records) return write_block(s);
+    // Too many open blocks: close them all rather than pick one, so the
+    // cost stays at one pass over the series per memory_bytes of input
+    if (buffered_ > opt_.memory_bytes) return write_all();
+    return true;
+}
+
+bool ColumnWriter::write_block(Series& s) {
+    size_t n = s.timestamps.size();
+    if (n == 0) return true;
+
+    // Payload start of each frame, in arrival order
+    starts_.resize(n);
+    uint8_t stride = 0;
+    uint32_t at = 0;
+    for (size_t i = 0; i < n; ++i) {
+        starts_[i] = at;
+        uint8_t bytes = (s.frame_flags[i] & CAPTURE_RTR) ? 0 : s.lens[i];
+        at += bytes;
+        if (bytes > stride) stride = bytes;
+    }
+    order_.resize(n);
+    std::iota(order_.begin(), order_.end(), 0u);
+    if (!std::is_sorted(s.timestamps.begin(), s.timestamps.end())) {
+        std::stable_sort(order_.begin(), order_.end(),
+                         [&s](uint32_t a, uint32_t b) { return s.timestamps[a] < s.timestamps[b]; });
+    }
+
+    ColumnBlockInfo h;
+    std::memset(&h, 0, sizeof(h));
+    h.first_ns = s.timestamps[order_.front()];
+    h.last_ns = s.timestamps[order_.back()];
+    h.offset = offset_;
+    h.id = s.id;
+    h.count = (uint32_t)n;
+    h.channel = s.channel;
+    h.flags = s.flags;
+    h.stride = stride;
+
+    block_.assign(h.size(), 0);
+    uint8_t* p = block_.data();
+    std::memcpy(p, &h, sizeof(h));
+    uint8_t* ts = p + sizeof(h);
+    uint8_t* lens = ts + n * sizeof(uint64_t);
+    uint8_t* flags = lens + n;
+    uint8_t* rows = flags + n;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t k = order_[i];
+        std::memcpy(ts + i * sizeof(uint64_t), &s.timestamps[k], sizeof(uint64_t));
+        lens[i] = s.lens[k];
+        flags[i] = s.frame_flags[k];
+        uint8_t bytes = (s.frame_flags[k] & CAPTURE_RTR) ? 0 : s.lens[k];
+        std::memcpy(rows + i * stride, s.data.data() + starts_[k], bytes);
+    }
+    bool ok = put(block_.data(), block_.size());
+    if (ok) {
+        index_.push_back(h);
+        bump(blocks_);
+    }
+
+    buffered_ -= n * (sizeof(uint64_t) + 2) + s.data.size();
+    // Give the memory back: most series are idle most of the time
+    std::vector<uint64_t>().swap(s.timestamps);
+    std::vector<uint8_t>().swap(s.lens);
+    std::vector<uint8_t>().swap(s.frame_flags);
+    std::vector<uint8_t>().swap(s.data);
+    return ok;
+}
+
+bool ColumnWriter::write_all() {
+    bool ok = true;
+    for (auto& it : series_) ok = write_block(it.second) && ok;
+    // Forget idle series too, or a bus full of distinct extended IDs would
+    // grow the map without bound
+    series_.clear();
+    open_series_.store(0, std::memory_order_relaxed);
+    return ok;
+}
+
+void ColumnWriter::finish() {
+    if (!file_) return;
+    write_all();
+    std::sort(index_.begin(), index_.end(), index_less);
+    ColumnFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, COLUMN_MAGIC, sizeof(h.magic));
+    h.version = COLUMN_VERSION;
+    h.block_records = (uint32_t)opt_.block_records;
+    h.records = records();
+    h.blocks = index_.size();
+    h.series = count_series(index_);
+    h.first_ns = h.records > 0 ? first_ns_ : 0;
+    h.last_ns = last_ns_;
+    h.index_offset = offset_;
+    if (put(index_.data(), index_.size() * sizeof(ColumnBlockInfo)) && std::fseek(file_, 0, SEEK_SET) == 0) {
+        std::fwrite(&h, 1, sizeof(h), file_);
+    }
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+// ================= ColumnReader =================
+
+ColumnReader::ColumnReader(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::runtime_error("Failed to open " + path);
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ColumnFileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Not a column store: " + path);
+    }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) throw std::runtime_error("Failed to map " + path);
+    map_ = p;
+    map_size_ = (size_t)st.st_size;
+    // Queries jump between blocks; readahead would pull in the neighbours
+    madvise(map_, map_size_, MADV_RANDOM);
+
+    std::memcpy(&header_, map_, sizeof(header_));
+    if (std::memcmp(header_.magic, COLUMN_MAGIC, sizeof(COLUMN_MAGIC)) != 0 || header_.version != COLUMN_VERSION) {
+        munmap(map_, map_size_);
+        throw std::runtime_error("Not a column store: " + path);
+    }
+    uint64_t index_end = header_.index_offset + header_.blocks * sizeof(ColumnBlockInfo);
+    if (header_.index_offset != 0 && header_.index_offset % 8 == 0 && index_end <= map_size_) {
+        index_ = span<const ColumnBlockInfo>(
+            reinterpret_cast<const ColumnBlockInfo*>(static_cast<const uint8_t*>(map_) + header_.index_offset),
+            (size_t)header_.blocks);
+    } else {
+        rebuild_index();
+    }
+    for (size_t i = 1; i < index_.size(); ++i) {
+        const ColumnBlockInfo& a = index_[i - 1];
+        const ColumnBlockInfo& b = index_[i];
+        if (same_series(a, b) && b.last_ns < a.last_ns) ordered_ = false;
+    }
+}
+
+ColumnReader::~ColumnReader() {
+    if (map_) munmap(map_, map_size_);
+}
+
+// The writer stopped before the index: walk the block headers instead, up
+// to the first incomplete block. Blocks still open in its memory are lost.
+void ColumnReader::rebuild_index() {
+    const uint8_t* base = static_cast<const uint8_t*>(map_);
+    size_t off = sizeof(ColumnFileHeader);
+    header_.records = 0;
+    header_.first_ns = UINT64_MAX;
+    header_.last_ns = 0;
+    while (off + sizeof(ColumnBlockInfo) <= map_size_) {
+        ColumnBlockInfo b;
+        std::memcpy(&b, base + off, sizeof(b));
+        if (b.offset != off || b.count == 0 || b.stride > CanFrame::MAX_LEN || off + b.size() > map_size_) break;
+        rebuilt_.push_back(b);
+        header_.records += b.count;
+        header_.first_ns = std::min(header_.first_ns, b.first_ns);
+        header_.last_ns = std::max(header_.last_ns, b.last_ns);
+        off += b.size();
+    }
+    if (rebuilt_.empty()) header_.first_ns = 0;
+    std::sort(rebuilt_.begin(), rebuilt_.end(), index_less);
+    header_.blocks = rebuilt_.size();
+    header_.series = count_series(rebuilt_);
+    index_ = span<const ColumnBlockInfo>(rebuilt_);
+}
+
+std::vector<ColumnSeries> ColumnReader::series() const {
+    std::vector<ColumnSeries> out;
+    for (const ColumnBlockInfo& b : index_) {
+        if (out.empty() || out.back().channel != b.channel || out.back().ext != ((b.flags & COLUMN_EXT) != 0) ||
+            out.back().id != b.id) {
+            out.push_back(ColumnSeries{b.channel, (b.flags & COLUMN_EXT) != 0, b.id, 0, b.first_ns, b.last_ns, 0});
+        }
+        ColumnSeries& s = out.back();
+        s.records += b.count;
+        s.first_ns = std::min(s.first_ns, b.first_ns);
+        s.last_ns = std::max(s.last_ns, b.last_ns);
+        ++s.blocks;
+    }
+    return out;
+}
+
+span<const ColumnBlockInfo> ColumnReader::blocks(uint8_t channel, uint32_t id, bool ext) const {
+    ColumnBlockInfo key;
+    std::memset(&key, 0, sizeof(key));
+    key.channel = channel;
+    key.flags = ext ? COLUMN_EXT : 0;
+    key.id = id;
+    auto same_series_less = [](const ColumnBlockInfo& a, const ColumnBlockInfo& b) {
+        return std::make_tuple(a.channel, a.flags, a.id) < std::make_tuple(b.channel, b.flags, b.id);
+    };
+    auto range = std::equal_range(index_.begin(), index_.end(), key, same_series_less);
+    return span<const ColumnBlockInfo>(range.first, (size_t)(range.second - range.first));
+}
+
+ColumnBlockView ColumnReader::block(const ColumnBlockInfo& info) const {
+    ColumnBlockView v;
+    if (info.offset + info.size() > map_size_) return v;
+    const uint8_t* p = static_cast<const uint8_t*>(map_) + info.offset;
+    v.info = reinterpret_cast<const ColumnBlockInfo*>(p);
+    v.timestamps = reinterpret_cast<const uint64_t*>(p + sizeof(ColumnBlockInfo));
+    v.lens = p + sizeof(ColumnBlockInfo) + (size_t)info.count * sizeof(uint64_t);
+    v.flags = v.lens + info.count;
+    v.payload = v.flags + info.count;
+    return v;
+}
+
+} // namespace slcanx
@@ -0,0 +1,354 @@
+#include "slcanx_coro.hpp"
+#include "posix_tty.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace slcanx {
+namespace coro {
+
+// ================= EventLoop =================
+
+EventLoop::EventLoop() {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakefd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epfd_ < 0 || wakefd_ < 0) {
+        if (epfd_ >= 0) ::close(epfd_);
+        if (wakefd_ >= 0) ::close(wakefd_);
+        throw std::runtime_error("Failed to create epoll instance");
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr; // The wake eventfd
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev) < 0) {
+        ::close(epfd_);
+        ::close(wakefd_);
+        throw std::runtime_error("Failed to register wake event");
+    }
+    ready_.reserve(256);
+    running_.reserve(256);
+}
+
+EventLoop::~EventLoop() {
+    ::close(wakefd_);
+    ::close(epfd_);
+}
+
+void EventLoop::run() {
+    while (run_once(-1)) {
+    }
+}
+
+void EventLoop::stop() {
+    uint64_t one = 1;
+    ssize_t r = ::write(wakefd_, &one, sizeof(one));
+    (void)r;
+}
+
+void EventLoop::drain_ready() {
+    // Resumed coroutines may post more work; keep going until quiet, then
+    // let every device write what this pass produced.
+    while (!ready_.empty()) {
+        running_.swap(ready_);
+        for (std::coroutine_handle<> h : running_) h.resume();
+        running_.clear();
+    }
+    // flush() may fail a device, which remove()s it; removed slots are
+    // nulled rather than erased, so index and size stay valid here.
+    for (size_t i = 0; i < watchers_.size(); ++i) {
+        if (watchers_[i]) watchers_[i]->flush();
+    }
+    watchers_.erase(std::remove(watchers_.begin(), watchers_.end(), nullptr), watchers_.end());
+}
+
+bool EventLoop::run_once(int timeout_ms) {
+    stopped_ = false;
+    drain_ready();
+
+    struct epoll_event evs[64];
+    int n = epoll_wait(epfd_, evs, 64, ready_.empty() ? timeout_ms : 0);
+    if (n < 0 && errno != EINTR) {
+        throw std::runtime_error("epoll_wait failed");
+    }
+    for (int i = 0; i < n; ++i) {
+        Watcher* w = static_cast<Watcher*>(evs[i].data.ptr);
+        if (!w) {
+            uint64_t v;
+            ssize_t r = ::read(wakefd_, &v, sizeof(v));
+            (void)r;
+            stopped_ = true;
+            continue;
+        }
+        w->on_io(evs[i].events);
+    }
+    drain_ready();
+    return !stopped_;
+}
+
+void EventLoop::add(int fd, uint32_t events, Watcher* w) {
+    struct epoll_event ev = {};
+    ev.events = events;
+    ev.data.ptr = w;
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        throw std::runtime_error("Failed to register serial port");
+    }
+    watchers_.push_back(w);
+}
+
+void EventLoop::modify(int fd, uint32_t events, Watcher* w) {
+    struct epoll_event ev = {};
+    ev.events = events;
+    ev.data.ptr = w;
+    epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void EventLoop::remove(int fd, Watcher* w) {
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+    std::replace(watchers_.begin(), watchers_.end(), w, static_cast<Watcher*>(nullptr));
+}
+
+// ================= Device =================
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+Device::Device(EventLoop& loop, const std::string& port, uint32_t baudrate,
+               size_t rx_queue_depth, size_t tx_buffer_bytes)
+    : loop_(loop), tx_limit_(tx_buffer_bytes) {
+    for (auto& rx : rx_) {
+        rx = std::make_unique<RxQueue>(rx_queue_depth, RxOverflowPolicy::DropNewest);
+    }
+    // Commands and query lines may go past the limit; frames wait for room
+    tx_.reserve(tx_limit_ + MAX_LINE_LEN + 1024);
+    fd_ = open_tty(port, baudrate);
+    try {
+        loop_.add(fd_, EPOLLIN, this);
+    } catch (...) {
+        ::close(fd_);
+        throw;
+    }
+}
+
+Device::~Device() {
+    fail();
+}
+
+RxQueueStats Device::rx_stats(uint8_t channel) const {
+    RxQueueStats st;
+    if (channel >= NUM_CHANNELS) return st;
+    const RxQueue& q = *rx_[channel];
+    st.received = q.pushed();
+    st.dropped = q.dropped();
+    st.depth = q.size();
+    st.capacity = q.capacity();
+    return st;
+}
+
+bool Device::send_cmd(uint8_t channel, std::string_view cmd) {
+    if (fd_ < 0 || channel >= NUM_CHANNELS) return false;
+    tx_.push_back((uint8_t)('0' + channel));
+    tx_.insert(tx_.end(), cmd.begin(), cmd.end());
+    tx_.push_back('\r');
+    return true;
+}
+
+bool Device::append_frame(uint8_t channel, const CanFrame& frame) {
+    if (tx_.size() >= tx_limit_) return false;
+    size_t old = tx_.size();
+    tx_.resize(old + encoded_size(frame));
+    encode_frame(channel, frame, tx_.data() + old);
+    return true;
+}
+
+void Device::admit_senders() {
+    while (!send_waiters_.empty() && tx_.size() < tx_limit_) {
+        SendAwaiter* w = send_waiters_.pop();
+        append_frame(w->channel_, w->frame_);
+        w->done_ = true;
+        loop_.post(w->handle_);
+    }
+}
+
+void Device::flush() {
+    if (fd_ < 0 || tx_.empty() || want_write_) return;
+    size_t off = 0;
+    while (off < tx_.size()) {
+        ssize_t n = ::write(fd_, tx_.data() + off, tx_.size() - off);
+        if (n > 0) {
+            off += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            want_write_ = true;
+            loop_.modify(fd_, EPOLLIN | EPOLLOUT, this);
+            break;
+        }
+        tx_.erase(tx_.begin(), tx_.begin() + off);
+        fail();
+        return;
+    }
+    tx_.erase(tx_.begin(), tx_.begin() + off);
+    admit_senders();
+}
+
+void Device::on_io(uint32_t events) {
+    if (events & EPOLLIN) {
+        uint8_t buf[4096];
+        for (;;) {
+            ssize_t n = ::read(fd_, buf, sizeof(buf));
+            if (n > 0) {
+                read_ts_ = monotonic_ns();
+                lines_.feed(buf, (size_t)n, [this](const uint8_t* line, size_t len) {
+                    handle_line(line, len);
+                });
+                if ((size_t)n < sizeof(buf)) break;
+                continue;
+            }
+            // VMIN = VTIME = 0: a drained tty reads 0, like EAGAIN
+            if (n == 0) break;
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            fail(); // EIO and the like
+            return;
+        }
+    }
+    // Checked after the reads, so bytes that arrived before a hang-up are
+    // still handled
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        fail();
+        return;
+    }
+    if (want_write_ && (events & EPOLLOUT)) {
+        want_write_ = false;
+        loop_.modify(fd_, EPOLLIN, this);
+        flush();
+    }
+}
+
+void Device::handle_line(const uint8_t* line, size_t len) {
+    uint8_t channel;
+    CanFrame frame;
+    if (decode_frame(line, len, channel, frame)) {
+        frame.timestamp_ns = read_ts_;
+        deliver(channel, frame);
+    } else {
+        handle_reply(line, len);
+    }
+}
+
+void Device::deliver(uint8_t channel, const CanFrame& frame) {
+    if (RecvAwaiter* w = recv_waiters_[channel].pop()) {
+        w->frame_ = frame;
+        w->done_ = true;
+        loop_.post(w->handle_);
+        return;
+    }
+    rx_[channel]->push(frame);
+}
+
+void Device::handle_reply(const uint8_t* line, size_t len) {
+    // "<letter>payload", optionally prefixed with the channel digit
+    int channel = -1;
+    if (len >= 2 && line[0] >= '0' && line[0] <= '3') {
+        channel = line[0] - '0';
+        ++line;
+        --len;
+    }
+    if (len == 0) return;
+
+    // Oldest pending query for this letter (and channel, when tagged)
+    QueryAwaiter* prev = nullptr;
+    for (QueryAwaiter* w = query_waiters_.head; w; prev = w, w = w->next) {
+        if (w->cmd_ != (char)line[0]) continue;
+        if (channel >= 0 && w->channel_ != channel) continue;
+        if (prev) prev->next = w->next; else query_waiters_.head = w->next;
+        if (query_waiters_.tail == w) query_waiters_.tail = prev;
+        w->reply_.assign(reinterpret_cast<const char*>(line + 1), len - 1);
+        w->done_ = true;
+        loop_.post(w->handle_);
+        return;
+    }
+}
+
+void Device::fail() {
+    if (fd_ >= 0) {
+        loop_.remove(fd_, this);
+        ::close(fd_);
+        fd_ = -1;
+    }
+    tx_.clear();
+    // Waiters resume with done_ == false and throw from await_resume()
+    for (auto& list : recv_waiters_) {
+        while (RecvAwaiter* w = list.pop()) loop_.post(w->handle_);
+    }
+    while (SendAwaiter* w = send_waiters_.pop()) loop_.post(w->handle_);
+    while (QueryAwaiter* w = query_waiters_.pop()) loop_.post(w->handle_);
+}
+
+// ================= Awaiters =================
+
+bool Device::RecvAwaiter::await_ready() {
+    if (channel_ >= NUM_CHANNELS) return true;
+    // Frames queued before a hang-up are still handed out
+    done_ = dev_.rx_[channel_]->pop(&frame_, 1) == 1;
+    return done_ || dev_.fd_ < 0;
+}
+
+void Device::RecvAwaiter::await_suspend(std::coroutine_handle<> h) {
+    handle_ = h;
+    dev_.recv_waiters_[channel_].push(this);
+}
+
+CanFrame Device::RecvAwaiter::await_resume() {
+    // The device may be gone by now, so only look at our own state
+    if (!done_) {
+        throw std::runtime_error(channel_ >= NUM_CHANNELS ? "Invalid channel" : "Serial port closed");
+    }
+    return frame_;
+}
+
+bool Device::SendAwaiter::await_ready() {
+    if (channel_ >= NUM_CHANNELS || dev_.fd_ < 0) return true;
+    // Keep FIFO order behind senders that are already waiting for room
+    if (dev_.send_waiters_.empty() && dev_.append_frame(channel_, frame_)) done_ = true;
+    return done_;
+}
+
+void Device::SendAwaiter::await_suspend(std::coroutine_handle<> h) {
+    handle_ = h;
+    dev_.send_waiters_.push(this);
+}
+
+void Device::SendAwaiter::await_resume() {
+    if (!done_) {
+        throw std::runtime_error(channel_ >= NUM_CHANNELS ? "Invalid channel" : "Serial port closed");
+    }
+}
+
+void Device::QueryAwaiter::await_suspend(std::coroutine_handle<> h) {
+    handle_ = h;
+    char cmd[1] = {cmd_};
+    if (!dev_.send_cmd(channel_, std::string_view(cmd, 1))) {
+        dev_.loop_.post(h); // Fails in await_resume()
+        return;
+    }
+    dev_.query_waiters_.push(this);
+}
+
+std::string Device::QueryAwaiter::await_resume() {
+    if (!done_) {
+        throw std::runtime_error(channel_ >= NUM_CHANNELS ? "Invalid channel" : "Serial port closed");
+    }
+    return std::move(reply_);
+}
+
+} // namespace coro
+} // namespace slcanx
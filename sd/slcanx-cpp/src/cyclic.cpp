@@ -0,0 +1,256 @@
+#include "slcanx_cyclic.hpp"
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <time.h>
+#endif
+
+namespace slcanx {
+
+// ================= Clock =================
+
+// steady_clock is CLOCK_MONOTONIC on Linux, the clock slept on below.
+static uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void sleep_until_ns(uint64_t deadline) {
+#ifndef _WIN32
+    // Absolute deadline: oversleeping one tick does not shift the next one
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline / 1000000000ull);
+    ts.tv_nsec = (long)(deadline % 1000000000ull);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+#else
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline)));
+#endif
+}
+
+// ================= Checksums =================
+
+uint8_t checksum_xor(const uint8_t* data, size_t len, size_t checksum_byte) {
+    uint8_t x = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (i != checksum_byte) x ^= data[i];
+    }
+    return x;
+}
+
+uint8_t checksum_sum(const uint8_t* data, size_t len, size_t checksum_byte) {
+    uint8_t s = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (i != checksum_byte) s = (uint8_t)(s + data[i]);
+    }
+    return s;
+}
+
+// ================= CyclicScheduler =================
+
+CyclicScheduler::CyclicScheduler(Slcanx& bus, std::chrono::microseconds tick)
+    : bus_(bus) {
+    tick_ns_ = tick.count() > 0 ? (uint64_t)tick.count() * 1000 : 1000000;
+    start_ns_ = now_ns();
+    due_.reserve(256);
+    batch_.reserve(64 * MAX_LINE_LEN);
+    sending_.reserve(64 * MAX_LINE_LEN);
+    thread_ = std::thread(&CyclicScheduler::run, this);
+}
+
+CyclicScheduler::~CyclicScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+CyclicScheduler::Id CyclicScheduler::add(const CyclicMessage& msg) {
+    if (msg.channel >= NUM_CHANNELS) throw std::runtime_error("Invalid channel");
+
+    Message m;
+    m.frame = PreparedFrame(msg.channel, msg.frame);
+    int payload_len = (int)m.frame.payload_size();
+    if (msg.counter_byte >= payload_len || msg.checksum_byte >= payload_len) {
+        throw std::runtime_error("Counter or checksum byte outside the payload");
+    }
+    if (msg.counter_byte >= 0 && msg.counter_mask == 0) {
+        throw std::runtime_error("Empty counter mask");
+    }
+    if (msg.checksum_byte >= 0 && !msg.checksum) {
+        throw std::runtime_error("Missing checksum function");
+    }
+
+    m.counter_byte = msg.counter_byte;
+    m.counter_mask = msg.counter_mask;
+    while (m.counter_mask && !(m.counter_mask & (1u << m.counter_shift))) ++m.counter_shift;
+    m.checksum_byte = msg.checksum_byte;
+    m.checksum = msg.checksum;
+
+    uint64_t period_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(msg.period).count();
+    uint64_t offset_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(msg.offset).count();
+    m.period_ticks = (period_ns + tick_ns_ / 2) / tick_ns_;
+    if (m.period_ticks == 0) m.period_ticks = 1;
+    m.period_ns = m.period_ticks * tick_ns_;
+    uint64_t offset_ticks = (offset_ns + tick_ns_ / 2) / tick_ns_;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    m.due_tick = now_tick_ + (offset_ticks ? offset_ticks : 1);
+    messages_.push_back(m);
+    uint32_t index = (uint32_t)(messages_.size() - 1);
+    insert(index);
+    if (active_++ == 0) cv_.notify_one();
+    return index;
+}
+
+bool CyclicScheduler::remove(Id id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id >= messages_.size() || !messages_[id].active) return false;
+    // The wheel entry is dropped when it fires
+    messages_[id].active = false;
+    --active_;
+    return true;
+}
+
+bool CyclicScheduler::update(Id id, size_t offset, span<const uint8_t> bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id >= messages_.size() || !messages_[id].active) return false;
+    PreparedFrame& f = messages_[id].frame;
+    if (offset + bytes.size() > f.payload_size()) return false;
+    f.set_bytes(offset, bytes);
+    return true;
+}
+
+CyclicStats CyclicScheduler::stats(Id id) const {
+    CyclicStats st;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id >= messages_.size()) return st;
+    const Message& m = messages_[id];
+    st.sent = m.sent;
+    st.skipped = m.skipped;
+    st.jitter_min_ns = m.jitter_min_ns;
+    st.jitter_max_ns = m.jitter_max_ns;
+    st.jitter_mean_ns = m.jitter_count ? m.jitter_abs_sum_ns / m.jitter_count : 0;
+    st.late_max_ns = m.late_max_ns;
+    return st;
+}
+
+void CyclicScheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (active_ == 0) {
+            cv_.wait(lock, [this] { return !running_ || active_ > 0; });
+            // Carry on from the current time rather than catching up the idle gap
+            start_ns_ = now_ns() - now_tick_ * tick_ns_;
+            continue;
+        }
+
+        uint64_t deadline = start_ns_ + (now_tick_ + 1) * tick_ns_;
+        lock.unlock();
+        sleep_until_ns(deadline);
+        uint64_t now = now_ns();
+        lock.lock();
+        if (!running_) break;
+
+        run_tick((now - start_ns_) / tick_ns_, now);
+        if (batch_.empty()) continue;
+
+        // Send outside the lock so add()/update() never wait on the TX ring
+        sending_.swap(batch_);
+        batch_.clear();
+        lock.unlock();
+        bus_.send_encoded(span<const uint8_t>(sending_.data(), sending_.size()));
+        lock.lock();
+    }
+}
+
+void CyclicScheduler::insert(uint32_t index) {
+    uint64_t due = messages_[index].due_tick;
+    uint64_t delta = due - now_tick_;
+    for (int level = 0; level < WHEEL_LEVELS - 1; ++level) {
+        if (delta < (1ull << (WHEEL_BITS * (level + 1)))) {
+            wheel_[level][(due >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)].push_back(index);
+            return;
+        }
+    }
+    // Top level; anything further out is re-filed when its slot comes round
+    const int top = WHEEL_LEVELS - 1;
+    const uint64_t span_ticks = 1ull << (WHEEL_BITS * WHEEL_LEVELS);
+    if (delta >= span_ticks) due = now_tick_ + span_ticks - 1;
+    wheel_[top][(due >> (WHEEL_BITS * top)) & (WHEEL_SLOTS - 1)].push_back(index);
+}
+
+void CyclicScheduler::cascade(int level) {
+    std::vector<uint32_t>& slot = wheel_[level][(now_tick_ >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)];
+    due_.swap(slot);
+    for (uint32_t index : due_) {
+        if (messages_[index].active) insert(index);
+    }
+    due_.clear();
+}
+
+void CyclicScheduler::run_tick(uint64_t last_tick, uint64_t now_ns) {
+    // Normally one tick; after a late wake-up every missed tick is processed
+    // here and their frames share the same write.
+    while (now_tick_ < last_tick) {
+        uint64_t t = ++now_tick_;
+        for (int level = 1; level < WHEEL_LEVELS; ++level) {
+            if (t & ((1ull << (WHEEL_BITS * level)) - 1)) break;
+            cascade(level);
+        }
+
+        due_.swap(wheel_[0][t & (WHEEL_SLOTS - 1)]);
+        uint64_t ideal_ns = start_ns_ + t * tick_ns_;
+        uint64_t late = now_ns > ideal_ns ? now_ns - ideal_ns : 0;
+        for (uint32_t index : due_) {
+            Message& m = messages_[index];
+            if (!m.active || m.due_tick != t) continue;
+            if (late > m.late_max_ns) m.late_max_ns = late;
+            emit(m, now_ns);
+
+            // Next period; periods that are already over are skipped, not burst
+            uint64_t next = t + m.period_ticks;
+            if (next <= last_tick) {
+                uint64_t k = (last_tick - next) / m.period_ticks + 1;
+                next += k * m.period_ticks;
+                m.skipped += k;
+                m.last_sent_ns = 0; // No jitter sample across the gap
+            }
+            m.due_tick = next;
+            insert(index);
+        }
+        due_.clear();
+    }
+}
+
+void CyclicScheduler::emit(Message& m, uint64_t now_ns) {
+    PreparedFrame& f = m.frame;
+    if (m.counter_byte >= 0) {
+        uint8_t b = f.byte((size_t)m.counter_byte);
+        b = (uint8_t)((b & ~m.counter_mask) | ((m.counter << m.counter_shift) & m.counter_mask));
+        f.set_byte((size_t)m.counter_byte, b);
+        m.counter = (uint8_t)((m.counter + 1) & (m.counter_mask >> m.counter_shift));
+    }
+    if (m.checksum_byte >= 0) {
+        f.set_byte((size_t)m.checksum_byte,
+                   m.checksum(f.payload(), f.payload_size(), (size_t)m.checksum_byte));
+    }
+    size_t old = batch_.size();
+    batch_.resize(old + f.size());
+    f.copy_to(batch_.data() + old);
+
+    if (m.last_sent_ns) {
+        int64_t jitter = (int64_t)(now_ns - m.last_sent_ns) - (int64_t)m.period_ns;
+        if (m.jitter_count == 0 || jitter < m.jitter_min_ns) m.jitter_min_ns = jitter;
+        if (m.jitter_count == 0 || jitter > m.jitter_max_ns) m.jitter_max_ns = jitter;
+        m.jitter_abs_sum_ns += (uint64_t)(jitter < 0 ? -jitter : jitter);
+        ++m.jitter_count;
+    }
+    m.last_sent_ns = now_ns;
+    ++m.sent;
+}
+
+} // namespace slcanx
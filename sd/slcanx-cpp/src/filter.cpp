@@ -0,0 +1,100 @@
+#include "slcanx_filter.hpp"
+#include <algorithm>
+
+namespace slcanx {
+
+static constexpr uint32_t STD_ID_MASK = 0x7FF;
+static constexpr uint32_t EXT_ID_MASK = 0x1FFFFFFF;
+
+// A mask rule with up to this many scattered don't-care bits is expanded
+// into single IDs; beyond that it is checked as a mask.
+static constexpr int MAX_EXPAND_BITS = 12;
+
+static int bit_count(uint32_t v) {
+    int n = 0;
+    for (; v; v &= v - 1) ++n;
+    return n;
+}
+
+FilterBank& FilterBank::accept(uint32_t id, uint32_t mask, bool ext) {
+    rules_.push_back({ext, false, id, mask});
+    return *this;
+}
+
+FilterBank& FilterBank::accept_range(uint32_t first, uint32_t last, bool ext) {
+    if (first <= last) rules_.push_back({ext, true, first, last});
+    return *this;
+}
+
+FilterBank& FilterBank::types(uint8_t flags) {
+    types_ = flags;
+    return *this;
+}
+
+void FilterBank::compile() {
+    for (uint64_t& w : std_bits_) w = 0;
+    ext_intervals_.clear();
+    ext_masks_.clear();
+
+    for (const Rule& r : rules_) {
+        if (!r.ext) {
+            if (r.range) {
+                uint32_t last = std::min(r.b, STD_ID_MASK);
+                for (uint32_t id = r.a; id <= last; ++id) std_bits_[id >> 6] |= 1ull << (id & 63);
+            } else {
+                for (uint32_t id = 0; id <= STD_ID_MASK; ++id) {
+                    if (((id ^ r.a) & r.b & STD_ID_MASK) == 0) std_bits_[id >> 6] |= 1ull << (id & 63);
+                }
+            }
+            continue;
+        }
+
+        if (r.range) {
+            if (r.a <= EXT_ID_MASK) ext_intervals_.push_back({r.a, std::min(r.b, EXT_ID_MASK)});
+            continue;
+        }
+        uint32_t mask = r.b & EXT_ID_MASK;
+        uint32_t base = r.a & mask;
+        uint32_t free = ~mask & EXT_ID_MASK;
+        if ((free & (free + 1)) == 0) {
+            // Don't-care bits are the low bits: one interval
+            ext_intervals_.push_back({base, base | free});
+        } else if (bit_count(free) <= MAX_EXPAND_BITS) {
+            // Every combination of the free bits, in increasing order
+            uint32_t sub = 0;
+            do {
+                ext_intervals_.push_back({base | sub, base | sub});
+                sub = (sub - free) & free;
+            } while (sub != 0);
+        } else {
+            ext_masks_.push_back({base, mask});
+        }
+    }
+
+    // Sort and merge overlapping or adjacent intervals
+    std::sort(ext_intervals_.begin(), ext_intervals_.end(),
+              [](const Interval& x, const Interval& y) { return x.first < y.first; });
+    size_t out = 0;
+    for (size_t i = 0; i < ext_intervals_.size(); ++i) {
+        if (out > 0 && ext_intervals_[i].first <= ext_intervals_[out - 1].last + 1) {
+            ext_intervals_[out - 1].last = std::max(ext_intervals_[out - 1].last, ext_intervals_[i].last);
+        } else {
+            ext_intervals_[out++] = ext_intervals_[i];
+        }
+    }
+    ext_intervals_.resize(out);
+    ext_intervals_.shrink_to_fit();
+}
+
+bool FilterBank::accepts_ext(uint32_t id) const {
+    // Last interval starting at or before id
+    auto it = std::upper_bound(ext_intervals_.begin(), ext_intervals_.end(), id,
+                               [](uint32_t v, const Interval& iv) { return v < iv.first; });
+    if (it != ext_intervals_.begin() && id <= (it - 1)->last) return true;
+    for (const MaskRule& m : ext_masks_) {
+        if ((id & m.mask) == m.id) return true;
+    }
+    return false;
+}
+
+} // namespace slcanx
@@ -0,0 +1,376 @@
+#include "slcanx_group.hpp"
+#include "slcanx_queue.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+namespace slcanx {
+
+static int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+struct DeviceGroup::Device {
+    uint16_t index = 0;
+    Loop* loop = nullptr;
+    std::unique_ptr<Slcanx> bus;
+    int fd = -1;
+    std::atomic<bool> pending{true}; // Wakeup fired; starts set so the writer runs once
+    std::atomic<bool> online{true};
+    // Loop thread only: CLOCK_MONOTONIC deadlines, -1 = none
+    int64_t write_at = -1;
+    int64_t read_at = -1;
+};
+
+// One epoll thread. Its epoll set holds the wake eventfd (data.ptr = the
+// Loop), the deadline timerfd (data.ptr = nullptr) and the device fds
+// (data.ptr = the Device).
+struct DeviceGroup::Loop {
+    std::thread thread;
+    int epfd = -1;
+    int wakefd = -1;
+    int timerfd = -1;
+    std::atomic<bool> signaled{false}; // A wake is pending in wakefd
+    std::atomic<size_t> load{0};       // Devices assigned, for add()
+
+    std::mutex mutex;                  // Guards added and callback
+    std::vector<Device*> added;
+    RxCallback callback;
+    std::atomic<bool> has_callback{false};
+
+    std::unique_ptr<BasicRxQueue<GroupFrame>> queue;
+    std::atomic<uint64_t> wakeups{0};
+
+    // Loop thread only
+    std::vector<Device*> devices;
+    int64_t timer_at = -1;
+    bool delivered = false;
+
+    ~Loop() {
+        if (timerfd >= 0) ::close(timerfd);
+        if (wakefd >= 0) ::close(wakefd);
+        if (epfd >= 0) ::close(epfd);
+    }
+
+    void wake() {
+        if (signaled.exchange(true)) return;
+        uint64_t one = 1;
+        ssize_t r = ::write(wakefd, &one, sizeof(one));
+        (void)r;
+    }
+};
+
+DeviceGroup::DeviceGroup(const DeviceGroupOptions& options) : opt_(options) {
+    if (opt_.threads == 0) opt_.threads = 1;
+    if (opt_.max_devices == 0 || opt_.max_devices > 65536) {
+        throw std::runtime_error("max_devices must be 1..65536");
+    }
+    opt_.device.external_drive = true;
+    devices_.reset(new std::unique_ptr<Device>[opt_.max_devices]);
+
+    for (unsigned i = 0; i < opt_.threads; ++i) {
+        auto loop = std::make_unique<Loop>();
+        loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        loop->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (loop->epfd < 0 || loop->wakefd < 0 || loop->timerfd < 0) {
+            stop();
+            throw std::runtime_error("Failed to create epoll instance");
+        }
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = loop.get();
+        bool ok = epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->wakefd, &ev) == 0;
+        ev.data.ptr = nullptr;
+        ok = ok && epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->timerfd, &ev) == 0;
+        if (!ok) {
+            stop();
+            throw std::runtime_error("Failed to register wake event");
+        }
+        loop->queue = std::make_unique<BasicRxQueue<GroupFrame>>(opt_.rx_queue_depth, opt_.rx_overflow);
+        loops_.push_back(std::move(loop));
+    }
+
+    for (unsigned i = 0; i < opt_.threads; ++i) {
+        Loop& loop = *loops_[i];
+        loop.thread = std::thread(&DeviceGroup::run, this, std::ref(loop));
+        if (opt_.cpus.empty()) continue;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(opt_.cpus[i % opt_.cpus.size()], &set);
+        if (pthread_setaffinity_np(loop.thread.native_handle(), sizeof(set), &set) != 0) {
+            stop();
+            throw std::runtime_error("Failed to pin event loop to CPU " +
+                                     std::to_string(opt_.cpus[i % opt_.cpus.size()]));
+        }
+    }
+}
+
+DeviceGroup::~DeviceGroup() {
+    stop();
+}
+
+void DeviceGroup::stop() {
+    running_ = false;
+    for (auto& loop : loops_) {
+        if (loop->wakefd >= 0) {
+            uint64_t one = 1;
+            ssize_t r = ::write(loop->wakefd, &one, sizeof(one));
+            (void)r;
+        }
+    }
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) loop->thread.join();
+    }
+    std::lock_guard<std::mutex> lock(rx_mutex_);
+    rx_cv_.notify_all();
+}
+
+uint16_t DeviceGroup::add(const std::string& port) {
+    std::lock_guard<std::mutex> lock(add_mutex_);
+    size_t index = count_.load(std::memory_order_relaxed);
+    if (index >= opt_.max_devices) throw std::runtime_error("DeviceGroup is full");
+
+    Loop* loop = loops_[0].get();
+    for (auto& l : loops_) {
+        if (l->load.load(std::memory_order_relaxed) < loop->load.load(std::memory_order_relaxed)) loop = l.get();
+    }
+
+    auto dev = std::make_unique<Device>();
+    dev->index = (uint16_t)index;
+    dev->loop = loop;
+    dev->bus = std::make_unique<Slcanx>(port, opt_.device);
+    dev->fd = dev->bus->io_handle();
+    Device* d = dev.get();
+    d->bus->set_rx_callback([this, loop, d](uint8_t channel, const CanFrame& frame) {
+        deliver(*loop, d->index, channel, frame);
+    });
+    d->bus->set_wakeup([loop, d] {
+        d->pending.store(true);
+        loop->wake();
+    });
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = d;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, d->fd, &ev) < 0) {
+        throw std::runtime_error("Failed to register serial port");
+    }
+    devices_[index] = std::move(dev);
+    count_.store(index + 1, std::memory_order_release);
+    loop->load.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> l(loop->mutex);
+        loop->added.push_back(d);
+    }
+    loop->wake();
+    return (uint16_t)index;
+}
+
+DeviceGroup::Device& DeviceGroup::at(uint16_t device) const {
+    if (device >= count_.load(std::memory_order_acquire)) throw std::runtime_error("Invalid device");
+    return *devices_[device];
+}
+
+Slcanx& DeviceGroup::device(uint16_t device) {
+    return *at(device).bus;
+}
+
+bool DeviceGroup::online(uint16_t device) const {
+    return at(device).online.load(std::memory_order_relaxed);
+}
+
+bool DeviceGroup::send(uint16_t device, uint8_t channel, const CanFrame& frame) {
+    return at(device).bus->send(channel, frame);
+}
+
+bool DeviceGroup::try_send(uint16_t device, uint8_t channel, const CanFrame& frame) {
+    return at(device).bus->try_send(channel, frame);
+}
+
+size_t DeviceGroup::send_batch(uint16_t device, span<const ChannelFrame> frames) {
+    return at(device).bus->send_batch(frames);
+}
+
+void DeviceGroup::set_rx_callback(RxCallback cb) {
+    for (auto& loop : loops_) {
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        loop->callback = cb;
+        loop->has_callback.store((bool)cb, std::memory_order_release);
+    }
+}
+
+void DeviceGroup::deliver(Loop& loop, uint16_t device, uint8_t channel, const CanFrame& frame) {
+    if (loop.has_callback.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(loop.mutex);
+        if (loop.callback) {
+            loop.callback(device, channel, frame);
+            return;
+        }
+    }
+    GroupFrame item;
+    item.device = device;
+    item.channel = channel;
+    item.frame = frame;
+    loop.queue->push(item);
+    loop.delivered = true;
+}
+
+size_t DeviceGroup::pop(GroupFrame* out, size_t max) {
+    size_t n = 0;
+    for (size_t i = 0; i < loops_.size() && n < max; ++i) {
+        Loop& loop = *loops_[(next_loop_ + i) % loops_.size()];
+        n += loop.queue->pop(out + n, max - n);
+    }
+    // Start with the next loop on the following call, so none starves
+    next_loop_ = (next_loop_ + 1) % loops_.size();
+    return n;
+}
+
+size_t DeviceGroup::recv(span<GroupFrame> frames, std::chrono::nanoseconds timeout) {
+    if (frames.empty()) return 0;
+    size_t n = pop(frames.data(), frames.size());
+    if (n > 0 || timeout <= std::chrono::nanoseconds::zero()) return n;
+
+    {
+        std::unique_lock<std::mutex> lock(rx_mutex_);
+        rx_waiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto ready = [&] {
+            for (auto& loop : loops_) {
+                if (!loop->queue->empty()) return true;
+            }
+            return !running_;
+        };
+        if (timeout == std::chrono::nanoseconds::max()) {
+            rx_cv_.wait(lock, ready);
+        } else {
+            rx_cv_.wait_for(lock, timeout, ready);
+        }
+        rx_waiting_.store(false, std::memory_order_relaxed);
+    }
+    return pop(frames.data(), frames.size());
+}
+
+DeviceGroupStats DeviceGroup::stats() const {
+    DeviceGroupStats st;
+    st.devices = count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < st.devices; ++i) {
+        if (devices_[i]->online.load(std::memory_order_relaxed)) ++st.online;
+    }
+    st.threads = (unsigned)loops_.size();
+    for (auto& loop : loops_) {
+        st.wakeups += loop->wakeups.load(std::memory_order_relaxed);
+        st.rx_frames += loop->queue->pushed();
+        st.rx_dropped += loop->queue->dropped();
+        st.rx_depth += loop->queue->size();
+    }
+    return st;
+}
+
+void DeviceGroup::run(Loop& loop) {
+    struct epoll_event evs[64];
+    int timeout = -1;
+
+    while (running_) {
+        int n = epoll_wait(loop.epfd, evs, 64, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        loop.wakeups.store(loop.wakeups.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        bool woken = false;
+        for (int i = 0; i < n; ++i) {
+            void* ptr = evs[i].data.ptr;
+            if (ptr == &loop) {
+                uint64_t v;
+                ssize_t r = ::read(loop.wakefd, &v, sizeof(v));
+                (void)r;
+                woken = true;
+            } else if (ptr == nullptr) {
+                uint64_t v;
+                ssize_t r = ::read(loop.timerfd, &v, sizeof(v));
+                (void)r;
+                loop.timer_at = -1;
+            } else {
+                Device* d = static_cast<Device*>(ptr);
+                if (evs[i].events & EPOLLIN) {
+                    int ms = d->bus->drive_read(true);
+                    d->read_at = ms < 0 ? -1 : monotonic_ns() + (int64_t)ms * 1000000;
+                }
+                if (evs[i].events & (EPOLLERR | EPOLLHUP)) {
+                    // Gone (unplugged): stop polling, keep the index valid
+                    epoll_ctl(loop.epfd, EPOLL_CTL_DEL, d->fd, nullptr);
+                    d->online.store(false, std::memory_order_relaxed);
+                }
+            }
+        }
+        if (!running_) break;
+
+        if (woken) {
+            // Cleared before the scan below, so a wakeup that races with it
+            // signals again instead of being lost
+            loop.signaled.store(false);
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            loop.devices.insert(loop.devices.end(), loop.added.begin(), loop.added.end());
+            loop.added.clear();
+        }
+
+        int64_t now = monotonic_ns();
+        int64_t next = INT64_MAX;
+        for (Device* d : loop.devices) {
+            bool wake = woken && d->pending.exchange(false);
+            if (wake || (d->read_at >= 0 && d->read_at <= now)) {
+                int ms = d->bus->drive_read(false);
+                d->read_at = ms < 0 ? -1 : now + (int64_t)ms * 1000000;
+            }
+            if (wake || (d->write_at >= 0 && d->write_at <= now)) {
+                int64_t ns = d->bus->drive_write();
+                d->write_at = ns < 0 ? -1 : now + ns;
+            }
+            if (d->read_at >= 0) next = std::min(next, d->read_at);
+            if (d->write_at >= 0) next = std::min(next, d->write_at);
+        }
+
+        if (loop.delivered) {
+            loop.delivered = false;
+            // Same handshake as Slcanx::deliver(): only notify a parked recv()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (rx_waiting_.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(rx_mutex_);
+                rx_cv_.notify_one();
+            }
+        }
+
+        // Sub-millisecond TX windows need the timerfd; epoll_wait alone
+        // only has millisecond resolution
+        if (next == INT64_MAX) {
+            timeout = -1;
+        } else if (next <= monotonic_ns()) {
+            timeout = 0;
+        } else {
+            timeout = -1;
+            if (next != loop.timer_at) {
+                struct itimerspec its = {};
+                its.it_value.tv_sec = next / 1000000000;
+                its.it_value.tv_nsec = next % 1000000000;
+                timerfd_settime(loop.timerfd, TFD_TIMER_ABSTIME, &its, nullptr);
+                loop.timer_at = next;
+            }
+        }
+    }
+}
+
+} // namespace slcanx
@@ -0,0 +1,146 @@
+#include "slcanx_hex.hpp"
+#include "hex_kernels.hpp"
+#include <cstring>
+#if defined(SLCANX_HEX_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace slcanx {
+namespace hex {
+
+// ================= Scalar kernels =================
+
+namespace detail {
+
+void encode_scalar(const uint8_t* in, size_t n, uint8_t* out) {
+    for (size_t i = 0; i < n; ++i) {
+        std::memcpy(out + 2 * i, kHexPairs[in[i]].data(), 2);
+    }
+}
+
+bool decode_scalar(const uint8_t* in, size_t n, uint8_t* out) {
+    uint8_t bad = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t hi = kHexValues[in[2 * i]];
+        uint8_t lo = kHexValues[in[2 * i + 1]];
+        bad |= hi | lo;
+        out[i] = (uint8_t)((hi << 4) | (lo & 0xF));
+    }
+    return (bad & 0xF0) == 0;
+}
+
+bool validate_scalar(const uint8_t* in, size_t len) {
+    uint8_t bad = 0;
+    for (size_t i = 0; i < len; ++i) bad |= kHexValues[in[i]];
+    return (bad & 0xF0) == 0;
+}
+
+} // namespace detail
+
+// ================= Runtime dispatch =================
+
+struct Kernels {
+    Isa isa;
+    void (*encode)(const uint8_t*, size_t, uint8_t*);
+    bool (*decode)(const uint8_t*, size_t, uint8_t*);
+    bool (*validate)(const uint8_t*, size_t);
+};
+
+static const Kernels kScalar = {
+    Isa::Scalar, detail::encode_scalar, detail::decode_scalar, detail::validate_scalar
+};
+#ifdef SLCANX_HEX_X86
+static const Kernels kSse2 = {
+    Isa::SSE2, detail::encode_sse2, detail::decode_sse2, detail::validate_sse2
+};
+static const Kernels kAvx2 = {
+    Isa::AVX2, detail::encode_avx2, detail::decode_avx2, detail::validate_avx2
+};
+#endif
+
+static bool cpu_supports(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar:
+            return true;
+#ifdef SLCANX_HEX_X86
+        case Isa::SSE2:
+            return true; // baseline on x86-64; the build enables it on x86
+        case Isa::AVX2: {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx) return false;
+            if ((_xgetbv(0) & 0x6) != 0x6) return false; // OS saves YMM state
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+static const Kernels* kernels_for(Isa isa) {
+    if (!cpu_supports(isa)) return nullptr;
+    switch (isa) {
+#ifdef SLCANX_HEX_X86
+        case Isa::SSE2: return &kSse2;
+        case Isa::AVX2: return &kAvx2;
+#endif
+        case Isa::Scalar: return &kScalar;
+        default: return nullptr;
+    }
+}
+
+static const Kernels* detect() {
+    for (Isa isa : {Isa::AVX2, Isa::SSE2}) {
+        if (const Kernels* k = kernels_for(isa)) return k;
+    }
+    return &kScalar;
+}
+
+// Resolved once at load time; set_isa() is meant for benchmarks and tests,
+// not for switching while other threads are encoding.
+static const Kernels* g_kernels = detect();
+
+void encode(const uint8_t* in, size_t n, uint8_t* out) {
+    g_kernels->encode(in, n, out);
+}
+
+bool decode(const uint8_t* in, size_t n, uint8_t* out) {
+    return g_kernels->decode(in, n, out);
+}
+
+bool validate(const uint8_t* in, size_t len) {
+    return g_kernels->validate(in, len);
+}
+
+Isa active_isa() {
+    return g_kernels->isa;
+}
+
+const char* isa_name(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar: return "scalar";
+        case Isa::SSE2: return "sse2";
+        case Isa::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+bool set_isa(Isa isa) {
+    const Kernels* k = kernels_for(isa);
+    if (!k) return false;
+    g_kernels = k;
+    return true;
+}
+
+} // namespace hex
+} // namespace slcanx
@@ -0,0 +1,87 @@
+// AVX2 hex kernels: 32 bytes <-> 64 characters per step, so a 64-byte CAN FD
+// payload is two iterations. Compiled with AVX2 enabled for this file only;
+// only called after the runtime CPU check in hex.cpp.
+
+#include "hex_kernels.hpp"
+#include <immintrin.h>
+
+namespace slcanx {
+namespace hex {
+namespace detail {
+
+static inline __m256i le_epu8(__m256i v, __m256i limit) {
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(v, limit), v);
+}
+
+static inline __m256i ascii_to_nibble(__m256i c, __m256i& valid) {
+    __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i is_digit = le_epu8(digit, _mm256_set1_epi8(9));
+    __m256i alpha = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i is_alpha = le_epu8(alpha, _mm256_set1_epi8(5));
+    valid = _mm256_or_si256(is_digit, is_alpha);
+    return _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+                           _mm256_and_si256(is_alpha, _mm256_add_epi8(alpha, _mm256_set1_epi8(10))));
+}
+
+static inline __m256i combine_pairs(__m256i nib) {
+    __m256i hi = _mm256_slli_epi16(nib, 4);
+    __m256i lo = _mm256_srli_epi16(nib, 8);
+    return _mm256_and_si256(_mm256_or_si256(hi, lo), _mm256_set1_epi16(0x00FF));
+}
+
+void encode_avx2(const uint8_t* in, size_t n, uint8_t* out) {
+    const __m256i lut = _mm256_setr_epi8(
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F',
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, mask));
+        // Unpack works per 128-bit lane: a = bytes 0-7 | 16-23, b = 8-15 | 24-31
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    if (i + 8 <= n) {
+        encode_sse2(in + i, n - i, out + 2 * i);
+    } else {
+        encode_scalar(in + i, n - i, out + 2 * i);
+    }
+}
+
+bool decode_avx2(const uint8_t* in, size_t n, uint8_t* out) {
+    __m256i all_valid = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v0, v1;
+        __m256i a = ascii_to_nibble(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * i)), v0);
+        __m256i b = ascii_to_nibble(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * i + 32)), v1);
+        all_valid = _mm256_and_si256(all_valid, _mm256_and_si256(v0, v1));
+        // packus interleaves lanes (a.lo, b.lo, a.hi, b.hi); restore byte order
+        __m256i packed = _mm256_packus_epi16(combine_pairs(a), combine_pairs(b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    bool ok = _mm256_movemask_epi8(all_valid) == -1;
+    bool tail = i + 8 <= n ? decode_sse2(in + 2 * i, n - i, out + i)
+                            : decode_scalar(in + 2 * i, n - i, out + i);
+    return tail && ok;
+}
+
+bool validate_avx2(const uint8_t* in, size_t len) {
+    __m256i all_valid = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v;
+        ascii_to_nibble(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), v);
+        all_valid = _mm256_and_si256(all_valid, v);
+    }
+    bool ok = _mm256_movemask_epi8(all_valid) == -1;
+    return validate_sse2(in + i, len - i) && ok;
+}
+
+} // namespace detail
+} // namespace hex
+} // namespace slcanx
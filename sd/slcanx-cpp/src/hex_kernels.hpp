@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace slcanx {
+namespace hex {
+namespace detail {
+
+inline constexpr char kHexDigits[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7',
+    '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+// Byte -> two upper-case hex characters, built from the nibble table at
+// compile time so the scalar loop is a single 2-byte copy per byte.
+constexpr std::array<std::array<char, 2>, 256> make_hex_pairs() {
+    std::array<std::array<char, 2>, 256> t{};
+    for (size_t i = 0; i < 256; ++i) {
+        t[i][0] = kHexDigits[i >> 4];
+        t[i][1] = kHexDigits[i & 0xF];
+    }
+    return t;
+}
+
+inline constexpr auto kHexPairs = make_hex_pairs();
+
+// ASCII -> nibble value, 0xFF for anything that is not a hex digit. OR-ing
+// decoded nibbles together lets a whole field be validated with one test.
+constexpr std::array<uint8_t, 256> make_hex_values() {
+    std::array<uint8_t, 256> t{};
+    for (size_t i = 0; i < 256; ++i) t[i] = 0xFF;
+    for (uint8_t i = 0; i < 10; ++i) t['0' + i] = i;
+    for (uint8_t i = 0; i < 6; ++i) {
+        t['A' + i] = (uint8_t)(10 + i);
+        t['a' + i] = (uint8_t)(10 + i);
+    }
+    return t;
+}
+
+inline constexpr auto kHexValues = make_hex_values();
+
+// Each kernel handles the full length; SIMD kernels finish the tail with the
+// scalar ones.
+void encode_scalar(const uint8_t* in, size_t n, uint8_t* out);
+bool decode_scalar(const uint8_t* in, size_t n, uint8_t* out);
+bool validate_scalar(const uint8_t* in, size_t len);
+
+#ifdef SLCANX_HEX_X86
+void encode_sse2(const uint8_t* in, size_t n, uint8_t* out);
+bool decode_sse2(const uint8_t* in, size_t n, uint8_t* out);
+bool validate_sse2(const uint8_t* in, size_t len);
+
+void encode_avx2(const uint8_t* in, size_t n, uint8_t* out);
+bool decode_avx2(const uint8_t* in, size_t n, uint8_t* out);
+bool validate_avx2(const uint8_t* in, size_t len);
+#endif
+
+} // namespace detail
+} // namespace hex
+} // namespace slcanx
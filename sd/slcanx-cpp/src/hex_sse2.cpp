@@ -0,0 +1,97 @@
+// SSE2 hex kernels: 16 bytes <-> 32 characters per step.
+// SSE2 has no byte shuffle, so nibbles are mapped to ASCII arithmetically.
+
+#include "hex_kernels.hpp"
+#include <emmintrin.h>
+
+namespace slcanx {
+namespace hex {
+namespace detail {
+
+// nibble (0..15) -> '0'..'9', 'A'..'F'
+static inline __m128i nibble_to_ascii(__m128i v) {
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(9)), _mm_set1_epi8('A' - '0' - 10));
+    return _mm_add_epi8(_mm_add_epi8(v, _mm_set1_epi8('0')), letter);
+}
+
+// Unsigned "v <= limit" per byte.
+static inline __m128i le_epu8(__m128i v, __m128i limit) {
+    return _mm_cmpeq_epi8(_mm_min_epu8(v, limit), v);
+}
+
+// ASCII -> nibble values, and a mask of bytes that were valid hex digits.
+static inline __m128i ascii_to_nibble(__m128i c, __m128i& valid) {
+    __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i is_digit = le_epu8(digit, _mm_set1_epi8(9));
+    __m128i alpha = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_alpha = le_epu8(alpha, _mm_set1_epi8(5));
+    valid = _mm_or_si128(is_digit, is_alpha);
+    return _mm_or_si128(_mm_and_si128(is_digit, digit),
+                        _mm_and_si128(is_alpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+}
+
+// 16 characters (8 hi/lo pairs) -> 8 bytes in the low half of each 16-bit lane.
+static inline __m128i combine_pairs(__m128i nib) {
+    __m128i hi = _mm_slli_epi16(nib, 4);      // low byte: hi << 4
+    __m128i lo = _mm_srli_epi16(nib, 8);      // low byte: lo
+    return _mm_and_si128(_mm_or_si128(hi, lo), _mm_set1_epi16(0x00FF));
+}
+
+void encode_sse2(const uint8_t* in, size_t n, uint8_t* out) {
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hi = nibble_to_ascii(_mm_and_si128(_mm_srli_epi16(x, 4), mask));
+        __m128i lo = nibble_to_ascii(_mm_and_si128(x, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    if (i + 8 <= n) { // classic CAN payload size: one half-width step
+        __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hi = nibble_to_ascii(_mm_and_si128(_mm_srli_epi16(x, 4), mask));
+        __m128i lo = nibble_to_ascii(_mm_and_si128(x, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        i += 8;
+    }
+    encode_scalar(in + i, n - i, out + 2 * i);
+}
+
+bool decode_sse2(const uint8_t* in, size_t n, uint8_t* out) {
+    __m128i all_valid = _mm_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v0, v1;
+        __m128i a = ascii_to_nibble(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i)), v0);
+        __m128i b = ascii_to_nibble(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i + 16)), v1);
+        all_valid = _mm_and_si128(all_valid, _mm_and_si128(v0, v1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_packus_epi16(combine_pairs(a), combine_pairs(b)));
+    }
+    if (i + 8 <= n) {
+        __m128i v;
+        __m128i a = ascii_to_nibble(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i)), v);
+        all_valid = _mm_and_si128(all_valid, v);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i),
+                         _mm_packus_epi16(combine_pairs(a), _mm_setzero_si128()));
+        i += 8;
+    }
+    bool ok = _mm_movemask_epi8(all_valid) == 0xFFFF;
+    return decode_scalar(in + 2 * i, n - i, out + i) && ok;
+}
+
+bool validate_sse2(const uint8_t* in, size_t len) {
+    __m128i all_valid = _mm_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v;
+        ascii_to_nibble(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), v);
+        all_valid = _mm_and_si128(all_valid, v);
+    }
+    bool ok = _mm_movemask_epi8(all_valid) == 0xFFFF;
+    return validate_scalar(in + i, len - i) && ok;
+}
+
+} // namespace detail
+} // namespace hex
+} // namespace slcanx
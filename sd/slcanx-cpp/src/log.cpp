@@ -0,0 +1,1257 @@
+#include "slcanx_log.hpp"
+#include "slcanx_codec.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <sys/stat.h>
+#ifdef SLCANX_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace slcanx {
+
+// Anything later than 2001-09-09 is taken for a wall clock (CLOCK_REALTIME
+// or CLOCK_TAI) reading rather than time since boot.
+static constexpr uint64_t WALL_CLOCK_MIN_NS = 1000000000000000000ull;
+
+static uint64_t wall_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static const char HEX_UPPER[] = "0123456789ABCDEF";
+
+static uint8_t hex_digit(char c) {
+    if (c >= '0' && c <= '9') return (uint8_t)(c - '0');
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') return (uint8_t)(c - 'a' + 10);
+    return 0xFF;
+}
+
+static bool ends_with(const std::string& s, const char* suffix) {
+    size_t n = std::strlen(suffix);
+    if (s.size() < n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if ((s[s.size() - n + i] | 0x20) != (suffix[i] | 0x20)) return false;
+    }
+    return true;
+}
+
+// Decimal, right-aligned in `width` characters.
+static char* put_dec(char* p, uint64_t v, int width = 0) {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    for (int i = n; i < width; ++i) *p++ = ' ';
+    while (n) *p++ = tmp[--n];
+    return p;
+}
+
+// Upper-case hex without leading zeros, or zero-padded to `digits`.
+static char* put_hex(char* p, uint32_t v, int digits = 0) {
+    char tmp[8];
+    int n = 0;
+    do {
+        tmp[n++] = HEX_UPPER[v & 0xF];
+        v >>= 4;
+    } while (v);
+    for (int i = n; i < digits; ++i) *p++ = '0';
+    while (n) *p++ = tmp[--n];
+    return p;
+}
+
+static char* put_str(char* p, const char* s) {
+    while (*s) *p++ = *s++;
+    return p;
+}
+
+// Local time of a Unix ns timestamp.
+static bool local_time(uint64_t unix_ns, struct tm& tm, unsigned& ms) {
+    time_t t = (time_t)(unix_ns / 1000000000ull);
+    ms = (unsigned)(unix_ns / 1000000ull % 1000);
+    return localtime_r(&t, &tm) != nullptr;
+}
+
+static uint64_t from_local_time(struct tm& tm, unsigned ms) {
+    tm.tm_isdst = -1;
+    time_t t = mktime(&tm);
+    if (t < 0) return 0;
+    return (uint64_t)t * 1000000000ull + (uint64_t)ms * 1000000ull;
+}
+
+static const char* const MONTHS[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                       "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+static const char* const WEEKDAYS[7] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+
+// ================= LogWriter =================
+
+LogWriter::LogWriter(const std::string& path, const LogOptions& options)
+    : CaptureSink(options.ring_bytes, options.flush_interval_ms), opt_(options) {
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) throw std::runtime_error("Failed to create " + path);
+    std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+}
+
+LogWriter::~LogWriter() {
+    stop();
+    if (file_) std::fclose(file_);
+}
+
+LogStats LogWriter::stats() const {
+    LogStats st;
+    st.records = records();
+    st.dropped = dropped();
+    st.bytes = bytes_.load(std::memory_order_relaxed);
+    return st;
+}
+
+bool LogWriter::put(const void* data, size_t len) {
+    if (failed_) return false;
+    if (std::fwrite(data, 1, len, file_) != len) {
+        // Disk full or similar: keep counting what cannot be stored
+        failed_ = true;
+        return false;
+    }
+    bytes_.store(bytes_.load(std::memory_order_relaxed) + len, std::memory_order_relaxed);
+    return true;
+}
+
+bool LogWriter::consume(const CaptureRecord& record) {
+    if (failed_) return false;
+    if (!started_) {
+        first_ns_ = record.timestamp_ns;
+        if (opt_.start_time_ns != 0) {
+            start_ns_ = opt_.start_time_ns;
+        } else {
+            start_ns_ = record.timestamp_ns >= WALL_CLOCK_MIN_NS ? record.timestamp_ns : wall_ns();
+        }
+        started_ = true;
+        begin();
+    }
+    // Never before the start, which keeps offsets unsigned
+    uint64_t offset = record.timestamp_ns > first_ns_ ? record.timestamp_ns - first_ns_ : 0;
+    return append(record, offset) && !failed_;
+}
+
+void LogWriter::close() {
+    stop();
+    if (!file_) return;
+    if (!started_) {
+        start_ns_ = opt_.start_time_ns != 0 ? opt_.start_time_ns : wall_ns();
+        started_ = true;
+        begin();
+    }
+    end();
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+// ================= AscWriter =================
+
+// "Thu Oct 16 10:22:33.123 am 2026", as CANoe writes it
+static std::string asc_date(uint64_t unix_ns) {
+    struct tm tm;
+    unsigned ms;
+    if (!local_time(unix_ns, tm, ms)) return "Thu Jan 01 12:00:00.000 am 1970";
+    int hour12 = tm.tm_hour % 12 == 0 ? 12 : tm.tm_hour % 12;
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%s %s %02d %02d:%02d:%02d.%03u %s %d", WEEKDAYS[tm.tm_wday % 7],
+                  MONTHS[tm.tm_mon % 12], tm.tm_mday, hour12, tm.tm_min, tm.tm_sec, ms,
+                  tm.tm_hour < 12 ? "am" : "pm", tm.tm_year + 1900);
+    return buf;
+}
+
+AscWriter::AscWriter(const std::string& path, const LogOptions& options) : LogWriter(path, options) {
+    start();
+}
+
+AscWriter::~AscWriter() {
+    close();
+}
+
+void AscWriter::begin() {
+    std::string date = asc_date(start_ns_);
+    std::string head = "date " + date + "\nbase hex  timestamps absolute\ninternal events logged\n"
+                       "// version 9.0.0\nBegin Triggerblock " + date + "\n   0.000000 Start of measurement\n";
+    put(head.data(), head.size());
+}
+
+void AscWriter::end() {
+    static const char tail[] = "End TriggerBlock\n";
+    put(tail, sizeof(tail) - 1);
+}
+
+// Six zero-padded fraction digits
+static char* put_micros(char* p, uint32_t frac) {
+    for (int i = 5; i >= 0; --i, frac /= 10) p[i] = (char)('0' + frac % 10);
+    return p + 6;
+}
+
+static char* put_bytes(char* p, const uint8_t* data, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        *p++ = ' ';
+        *p++ = HEX_UPPER[data[i] >> 4];
+        *p++ = HEX_UPPER[data[i] & 0xF];
+    }
+    return p;
+}
+
+bool AscWriter::append(const CaptureRecord& r, uint64_t offset_ns) {
+    char line[512];
+    char* p = line;
+    uint64_t us = (offset_ns + 500) / 1000;
+    p = put_dec(p, us / 1000000, 4);
+    *p++ = '.';
+    p = put_micros(p, (uint32_t)(us % 1000000));
+    *p++ = ' ';
+
+    uint8_t len = r.len > CanFrame::MAX_LEN ? (uint8_t)CanFrame::MAX_LEN : r.len;
+    const char* dir = (r.flags & CAPTURE_TX) ? "Tx  " : "Rx  ";
+    char id[10];
+    char* id_end = put_hex(id, r.id);
+    if (r.flags & CAPTURE_EXT) *id_end++ = 'x';
+    size_t id_len = (size_t)(id_end - id);
+
+    if (r.flags & CAPTURE_FD) {
+        // CANFD ch dir id name brs esi dlc len data duration length flags crc
+        // and four bit timings, in CANoe's column layout
+        p = put_str(p, "CANFD ");
+        p = put_dec(p, (uint64_t)r.channel + 1, 3);
+        *p++ = ' ';
+        p = put_str(p, dir);
+        *p++ = ' ';
+        for (size_t i = id_len; i < 8; ++i) *p++ = ' ';
+        std::memcpy(p, id, id_len);
+        p += id_len;
+        for (int i = 0; i < 35; ++i) *p++ = ' '; // Empty 32-column symbolic name
+        *p++ = (r.flags & CAPTURE_BRS) ? '1' : '0';
+        p = put_str(p, " 0 ");
+        *p++ = "0123456789abcdef"[len_to_dlc(len) & 0xF];
+        *p++ = ' ';
+        p = put_dec(p, len, 2);
+        p = put_bytes(p, r.data, len);
+        p = put_str(p, "        0    0     ");
+        p = put_str(p, (r.flags & CAPTURE_BRS) ? "3000" : "1000");
+        p = put_str(p, "        0        0        0        0        0");
+    } else {
+        // ch  id  dir  d dlc data
+        p = put_dec(p, (uint64_t)r.channel + 1);
+        p = put_str(p, "  ");
+        std::memcpy(p, id, id_len);
+        p += id_len;
+        for (size_t i = id_len; i < 16; ++i) *p++ = ' ';
+        p = put_str(p, dir);
+        *p++ = ' ';
+        if (r.flags & CAPTURE_RTR) {
+            p = put_str(p, "r ");
+            *p++ = HEX_UPPER[std::min<uint8_t>(len, 15)];
+        } else {
+            if (len > 8) len = 8;
+            p = put_str(p, "d ");
+            *p++ = HEX_UPPER[len];
+            p = put_bytes(p, r.data, len);
+        }
+    }
+    *p++ = '\n';
+    return put(line, (size_t)(p - line));
+}
+
+// ================= BLF =================
+
+// Layouts of the Vector binlog structures written and read here.
+// Little-endian, like the capture records.
+
+static constexpr uint32_t BLF_CAN_MESSAGE = 1;
+static constexpr uint32_t BLF_LOG_CONTAINER = 10;
+static constexpr uint32_t BLF_CAN_MESSAGE2 = 86;
+static constexpr uint32_t BLF_CAN_FD_MESSAGE = 100;
+static constexpr uint32_t BLF_CAN_FD_MESSAGE_64 = 101;
+
+static constexpr uint16_t BLF_NO_COMPRESSION = 0;
+static constexpr uint16_t BLF_ZLIB_DEFLATE = 2;
+
+static constexpr uint32_t BLF_TIME_TEN_MICS = 1;
+static constexpr uint32_t BLF_TIME_ONE_NANS = 2;
+
+static constexpr uint32_t BLF_EXT_ID = 0x80000000u;
+static constexpr uint8_t BLF_DIR_TX = 0x01;      // CAN_MESSAGE / CAN_FD_MESSAGE flags
+static constexpr uint8_t BLF_REMOTE = 0x80;
+static constexpr uint8_t BLF_FD_EDL = 0x01;      // CAN_FD_MESSAGE fd_flags
+static constexpr uint8_t BLF_FD_BRS = 0x02;
+static constexpr uint32_t BLF_FD64_REMOTE = 0x0010; // CAN_FD_MESSAGE_64 flags
+static constexpr uint32_t BLF_FD64_EDL = 0x1000;
+static constexpr uint32_t BLF_FD64_BRS = 0x2000;
+
+struct BlfFileHeader {
+    char signature[4];        // "LOGG"
+    uint32_t header_size;     // sizeof(BlfFileHeader)
+    uint8_t application_id;
+    uint8_t application_major;
+    uint8_t application_minor;
+    uint8_t application_build;
+    uint8_t binlog_major;
+    uint8_t binlog_minor;
+    uint8_t binlog_build;
+    uint8_t binlog_patch;
+    uint64_t file_size;
+    uint64_t uncompressed_size;
+    uint32_t object_count;
+    uint32_t objects_read;
+    uint16_t start_time[8];   // SYSTEMTIME, local time
+    uint16_t stop_time[8];
+    uint8_t reserved[72];
+};
+
+struct BlfObjectHeader {
+    char signature[4];        // "LOBJ"
+    uint16_t header_size;     // This header, plus the version 1/2 part below
+    uint16_t header_version;
+    uint32_t object_size;     // Header and payload, without padding
+    uint32_t object_type;
+    // Version 1 and 2 agree up to the timestamp
+    uint32_t flags;           // BLF_TIME_*
+    uint16_t client_index;    // Version 2: timestamp status, reserved
+    uint16_t object_version;
+    uint64_t timestamp;       // Since the start of measurement
+};
+
+struct BlfContainerHeader {
+    uint16_t compression;     // BLF_NO_COMPRESSION or BLF_ZLIB_DEFLATE
+    uint8_t reserved1[6];
+    uint32_t uncompressed_size;
+    uint8_t reserved2[4];
+};
+
+struct BlfCanMessage {        // CAN_MESSAGE, CAN_MESSAGE2 (followed by frame length and bit count)
+    uint16_t channel;
+    uint8_t flags;
+    uint8_t dlc;
+    uint32_t id;
+    uint8_t data[8];
+};
+
+struct BlfCanFdMessage {      // CAN_FD_MESSAGE
+    uint16_t channel;
+    uint8_t flags;
+    uint8_t dlc;
+    uint32_t id;
+    uint32_t frame_length;
+    uint8_t bit_count;
+    uint8_t fd_flags;
+    uint8_t valid_bytes;
+    uint8_t reserved[5];
+    uint8_t data[64];
+};
+
+struct BlfCanFdMessage64 {    // CAN_FD_MESSAGE_64, followed by valid_bytes of data
+    uint8_t channel;
+    uint8_t dlc;
+    uint8_t valid_bytes;
+    uint8_t tx_count;
+    uint32_t id;
+    uint32_t frame_length;
+    uint32_t flags;
+    uint32_t btr_arb;
+    uint32_t btr_data;
+    uint32_t time_offset_brs;
+    uint32_t time_offset_crc;
+    uint16_t bit_count;
+    uint8_t dir;
+    uint8_t ext_data_offset;
+    uint32_t crc;
+};
+
+static_assert(sizeof(BlfFileHeader) == 144, "BLF file header");
+static_assert(sizeof(BlfObjectHeader) == 32, "BLF object header");
+static_assert(sizeof(BlfContainerHeader) == 16, "BLF container header");
+static_assert(sizeof(BlfCanMessage) == 16, "BLF CAN_MESSAGE");
+static_assert(sizeof(BlfCanFdMessage) == 84, "BLF CAN_FD_MESSAGE");
+static_assert(sizeof(BlfCanFdMessage64) == 40, "BLF CAN_FD_MESSAGE_64");
+
+// Top-level objects are followed by object_size % 4 padding bytes. That is
+// what CANoe writes and python-can expects, though it is not 4-byte alignment.
+static size_t blf_padding(uint32_t object_size) {
+    return object_size % 4;
+}
+
+static void to_systemtime(uint64_t unix_ns, uint16_t st[8]) {
+    struct tm tm;
+    unsigned ms;
+    std::memset(st, 0, 8 * sizeof(uint16_t));
+    if (!local_time(unix_ns, tm, ms)) return;
+    st[0] = (uint16_t)(tm.tm_year + 1900);
+    st[1] = (uint16_t)(tm.tm_mon + 1);
+    st[2] = (uint16_t)tm.tm_wday;
+    st[3] = (uint16_t)tm.tm_mday;
+    st[4] = (uint16_t)tm.tm_hour;
+    st[5] = (uint16_t)tm.tm_min;
+    st[6] = (uint16_t)tm.tm_sec;
+    st[7] = (uint16_t)ms;
+}
+
+static uint64_t from_systemtime(const uint16_t st[8]) {
+    if (st[0] < 1970 || st[1] < 1 || st[1] > 12) return 0;
+    struct tm tm;
+    std::memset(&tm, 0, sizeof(tm));
+    tm.tm_year = st[0] - 1900;
+    tm.tm_mon = st[1] - 1;
+    tm.tm_mday = st[3];
+    tm.tm_hour = st[4];
+    tm.tm_min = st[5];
+    tm.tm_sec = st[6];
+    return from_local_time(tm, st[7] % 1000);
+}
+
+// One zlib stream for the whole file, reset per container, so compressing
+// does not allocate.
+struct BlfWriter::Deflater {
+#ifdef SLCANX_HAVE_ZLIB
+    z_stream zs;
+
+    explicit Deflater(int level) {
+        std::memset(&zs, 0, sizeof(zs));
+        if (deflateInit(&zs, level) != Z_OK) throw std::runtime_error("zlib deflateInit failed");
+    }
+
+    ~Deflater() { deflateEnd(&zs); }
+
+    // Compressed size, 0 if `out` is too small.
+    size_t compress(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_len) {
+        deflateReset(&zs);
+        zs.next_in = const_cast<Bytef*>(in);
+        zs.avail_in = (uInt)in_len;
+        zs.next_out = out;
+        zs.avail_out = (uInt)out_len;
+        if (deflate(&zs, Z_FINISH) != Z_STREAM_END) return 0;
+        return out_len - zs.avail_out;
+    }
+#endif
+};
+
+BlfWriter::BlfWriter(const std::string& path, const LogOptions& options) : LogWriter(path, options) {
+#ifndef SLCANX_HAVE_ZLIB
+    opt_.compression_level = 0;
+#endif
+    if (opt_.compression_level > 9) opt_.compression_level = 9;
+    if (opt_.container_bytes < 4096) opt_.container_bytes = 4096;
+    // Largest object, so a container never reallocates
+    container_.reserve(opt_.container_bytes + sizeof(BlfObjectHeader) + sizeof(BlfCanFdMessage));
+#ifdef SLCANX_HAVE_ZLIB
+    if (opt_.compression_level > 0) {
+        deflater_ = std::make_unique<Deflater>(opt_.compression_level);
+        compressed_.resize(deflateBound(&deflater_->zs, (uLong)container_.capacity()));
+    }
+#endif
+    uncompressed_ = sizeof(BlfFileHeader);
+    // Placeholder, rewritten by end()
+    BlfFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    put(&h, sizeof(h));
+    start();
+}
+
+BlfWriter::~BlfWriter() {
+    close();
+}
+
+bool BlfWriter::append(const CaptureRecord& r, uint64_t offset_ns) {
+    BlfObjectHeader h;
+    std::memcpy(h.signature, "LOBJ", 4);
+    h.header_size = 16 + 16;
+    h.header_version = 1;
+    h.flags = BLF_TIME_ONE_NANS;
+    h.client_index = 0;
+    h.object_version = 0;
+    h.timestamp = offset_ns;
+
+    uint8_t flags = (uint8_t)((r.flags & CAPTURE_TX) ? BLF_DIR_TX : 0);
+    uint32_t id = r.id | ((r.flags & CAPTURE_EXT) ? BLF_EXT_ID : 0);
+    uint8_t len = r.len > CanFrame::MAX_LEN ? (uint8_t)CanFrame::MAX_LEN : r.len;
+    size_t at = container_.size();
+    if (r.flags & CAPTURE_FD) {
+        BlfCanFdMessage m;
+        std::memset(&m, 0, sizeof(m));
+        m.channel = (uint16_t)(r.channel + 1);
+        m.flags = flags;
+        m.dlc = len_to_dlc(len);
+        m.id = id;
+        m.fd_flags = (uint8_t)(BLF_FD_EDL | ((r.flags & CAPTURE_BRS) ? BLF_FD_BRS : 0));
+        m.valid_bytes = len;
+        std::memcpy(m.data, r.data, len);
+        h.object_type = BLF_CAN_FD_MESSAGE;
+        h.object_size = (uint32_t)(sizeof(h) + sizeof(m));
+        container_.resize(at + sizeof(h) + sizeof(m));
+        std::memcpy(&container_[at + sizeof(h)], &m, sizeof(m));
+    } else {
+        BlfCanMessage m;
+        m.channel = (uint16_t)(r.channel + 1);
+        m.flags = (uint8_t)(flags | ((r.flags & CAPTURE_RTR) ? BLF_REMOTE : 0));
+        m.dlc = len;
+        m.id = id;
+        std::memcpy(m.data, r.data, sizeof(m.data));
+        if (r.flags & CAPTURE_RTR) std::memset(m.data, 0, sizeof(m.data));
+        h.object_type = BLF_CAN_MESSAGE;
+        h.object_size = (uint32_t)(sizeof(h) + sizeof(m));
+        container_.resize(at + sizeof(h) + sizeof(m));
+        std::memcpy(&container_[at + sizeof(h)], &m, sizeof(m));
+    }
+    // Both payloads are multiples of four: no padding inside containers
+    std::memcpy(&container_[at], &h, sizeof(h));
+    ++objects_;
+    last_offset_ns_ = offset_ns;
+    if (container_.size() >= opt_.container_bytes) return write_container();
+    return true;
+}
+
+bool BlfWriter::write_container() {
+    if (container_.empty()) return true;
+    const uint8_t* payload = container_.data();
+    size_t payload_len = container_.size();
+    uint16_t method = BLF_NO_COMPRESSION;
+#ifdef SLCANX_HAVE_ZLIB
+    if (deflater_) {
+        size_t n = deflater_->compress(container_.data(), container_.size(), compressed_.data(), compressed_.size());
+        if (n > 0) {
+            payload = compressed_.data();
+            payload_len = n;
+            method = BLF_ZLIB_DEFLATE;
+        }
+    }
+#endif
+    BlfObjectHeader h;
+    std::memcpy(h.signature, "LOBJ", 4);
+    h.header_size = 16;
+    h.header_version = 1;
+    h.object_size = (uint32_t)(16 + sizeof(BlfContainerHeader) + payload_len);
+    h.object_type = BLF_LOG_CONTAINER;
+    BlfContainerHeader c;
+    std::memset(&c, 0, sizeof(c));
+    c.compression = method;
+    c.uncompressed_size = (uint32_t)container_.size();
+    static const uint8_t zeros[4] = {};
+    bool ok = put(&h, 16) && put(&c, sizeof(c)) && put(payload, payload_len) &&
+              put(zeros, blf_padding(h.object_size));
+    uncompressed_ += 16 + sizeof(BlfContainerHeader) + container_.size();
+    container_.clear();
+    return ok;
+}
+
+void BlfWriter::write_header() {
+    BlfFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.signature, "LOGG", 4);
+    h.header_size = sizeof(BlfFileHeader);
+    h.application_id = 5;
+    h.binlog_major = 2;
+    h.binlog_minor = 6;
+    h.binlog_build = 8;
+    h.binlog_patch = 1;
+    h.file_size = stats().bytes;
+    h.uncompressed_size = uncompressed_;
+    h.object_count = (uint32_t)objects_;
+    to_systemtime(start_ns_, h.start_time);
+    to_systemtime(start_ns_ + last_offset_ns_, h.stop_time);
+    if (std::fseek(file_, 0, SEEK_SET) == 0) {
+        std::fwrite(&h, 1, sizeof(h), file_);
+        std::fseek(file_, 0, SEEK_END);
+    }
+}
+
+void BlfWriter::end() {
+    write_container();
+    write_header();
+}
+
+// ================= CandumpWriter =================
+
+CandumpWriter::CandumpWriter(const std::string& path, const LogOptions& options) : LogWriter(path, options) {
+    start();
+}
+
+CandumpWriter::~CandumpWriter() {
+    close();
+}
+
+bool CandumpWriter::append(const CaptureRecord& r, uint64_t offset_ns) {
+    char line[256];
+    char* p = line;
+    uint64_t t = start_ns_ + offset_ns;
+    *p++ = '(';
+    p = put_dec(p, t / 1000000000ull);
+    *p++ = '.';
+    p = put_micros(p, (uint32_t)(t / 1000 % 1000000));
+    p = put_str(p, ") can");
+    p = put_dec(p, r.channel);
+    *p++ = ' ';
+    p = put_hex(p, r.id, (r.flags & CAPTURE_EXT) ? 8 : 3);
+    *p++ = '#';
+    uint8_t len = r.len > CanFrame::MAX_LEN ? (uint8_t)CanFrame::MAX_LEN : r.len;
+    if (r.flags & CAPTURE_RTR) {
+        *p++ = 'R';
+        if (len > 0 && len <= 8) *p++ = (char)('0' + len);
+    } else {
+        if (r.flags & CAPTURE_FD) {
+            *p++ = '#';
+            *p++ = (r.flags & CAPTURE_BRS) ? '1' : '0';
+        } else if (len > 8) {
+            len = 8;
+        }
+        for (uint8_t i = 0; i < len; ++i) {
+            *p++ = HEX_UPPER[r.data[i] >> 4];
+            *p++ = HEX_UPPER[r.data[i] & 0xF];
+        }
+    }
+    *p++ = '\n';
+    return put(line, (size_t)(p - line));
+}
+
+std::unique_ptr<LogWriter> open_log_writer(const std::string& path, const LogOptions& options) {
+    if (ends_with(path, ".asc")) return std::make_unique<AscWriter>(path, options);
+    if (ends_with(path, ".blf")) return std::make_unique<BlfWriter>(path, options);
+    if (ends_with(path, ".log")) return std::make_unique<CandumpWriter>(path, options);
+    throw std::runtime_error("Unknown log format: " + path);
+}
+
+// ================= Readers =================
+
+// Reads a text file line by line; lines longer than the buffer are skipped.
+class TextLogReader : public LogReader {
+public:
+    explicit TextLogReader(const std::string& path) {
+        file_ = std::fopen(path.c_str(), "r");
+        if (!file_) throw std::runtime_error("Failed to open " + path);
+    }
+
+    ~TextLogReader() override {
+        if (file_) std::fclose(file_);
+    }
+
+    bool next(CaptureRecord& out) override {
+        while (std::fgets(line_, sizeof(line_), file_)) {
+            size_t len = std::strlen(line_);
+            if (len > 0 && line_[len - 1] != '\n' && !std::feof(file_)) {
+                // Longer than any valid line: skip the rest of it
+                int c;
+                while ((c = std::fgetc(file_)) != EOF && c != '\n') {
+                }
+                ++skipped_;
+                continue;
+            }
+            if (parse(line_, out)) return true;
+        }
+        return false;
+    }
+
+    void rewind() override { std::rewind(file_); }
+
+protected:
+    // True if the line was a frame. Counts the lines it rejects.
+    virtual bool parse(const char* line, CaptureRecord& out) = 0;
+
+    static CaptureRecord blank() {
+        CaptureRecord r;
+        std::memset(&r, 0, sizeof(r));
+        return r;
+    }
+
+    std::FILE* file_ = nullptr;
+    char line_[1024];
+};
+
+// candump -l / -L format: "(1436509052.249713) can0 123#DEADBEEF", with
+// "123##<flags><data>" for CAN FD and "123#R" / "123#R<dlc>" for remote
+// frames. 8-digit IDs are extended.
+class CandumpReader : public TextLogReader {
+public:
+    CandumpReader(const std::string& path, const std::map<std::string, int>& interfaces)
+        : TextLogReader(path), interfaces_(interfaces) {}
+
+protected:
+    bool parse(const char* p, CaptureRecord& out) override {
+        if (*p == '\n' || *p == '\r' || *p == '\0') return false; // Blank lines are not worth counting
+        if (!parse_frame(p, out)) {
+            ++skipped_;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool parse_frame(const char* p, CaptureRecord& out) {
+        // (seconds.fraction)
+        while (*p == ' ') ++p;
+        if (*p++ != '(') return false;
+        uint64_t sec = 0, frac = 0;
+        int digits = 0;
+        for (; *p >= '0' && *p <= '9'; ++p) sec = sec * 10 + (uint64_t)(*p - '0');
+        if (*p++ != '.') return false;
+        for (; *p >= '0' && *p <= '9'; ++p) {
+            if (digits < 9) {
+                frac = frac * 10 + (uint64_t)(*p - '0');
+                ++digits;
+            }
+        }
+        if (*p++ != ')' || digits == 0) return false;
+        for (; digits < 9; ++digits) frac *= 10;
+
+        // interface
+        while (*p == ' ') ++p;
+        const char* name = p;
+        while (*p && *p != ' ') ++p;
+        if (p == name) return false;
+        iface_.assign(name, (size_t)(p - name));
+        int channel = channel_of(iface_);
+        if (channel < 0 || channel > 255) return false;
+
+        // id#data
+        while (*p == ' ') ++p;
+        CaptureRecord r = blank();
+        r.channel = (uint8_t)channel;
+        r.timestamp_ns = sec * 1000000000ull + frac;
+        int id_digits = 0;
+        for (; *p != '#'; ++p, ++id_digits) {
+            uint8_t v = hex_digit(*p);
+            if (v > 15 || id_digits == 8) return false;
+            r.id = r.id << 4 | v;
+        }
+        if (id_digits != 3 && id_digits != 8) return false;
+        if (id_digits == 8) r.flags |= CAPTURE_EXT;
+        ++p;
+        size_t max = 8;
+        if (*p == '#') {
+            uint8_t flags = hex_digit(p[1]);
+            if (flags > 15) return false;
+            r.flags |= CAPTURE_FD;
+            if (flags & 0x01) r.flags |= CAPTURE_BRS;
+            max = CanFrame::MAX_LEN;
+            p += 2;
+        } else if (*p == 'R' || *p == 'r') {
+            r.flags |= CAPTURE_RTR;
+            ++p;
+            if (*p >= '0' && *p <= '8') r.len = (uint8_t)(*p++ - '0');
+            if (*p && *p != ' ' && *p != '\n' && *p != '\r') return false;
+            out = r;
+            return true;
+        }
+        size_t n = 0;
+        while (*p && *p != ' ' && *p != '\n' && *p != '\r') {
+            if (*p == '.') { // candump -x style byte separators
+                ++p;
+                continue;
+            }
+            uint8_t hi = hex_digit(p[0]);
+            uint8_t lo = hi > 15 ? 0xFF : hex_digit(p[1]);
+            if (lo > 15 || n == max) return false;
+            r.data[n++] = (uint8_t)(hi << 4 | lo);
+            p += 2;
+        }
+        if ((r.flags & CAPTURE_FD) && dlc_to_len(len_to_dlc(n)) != n) return false;
+        r.len = (uint8_t)n;
+        out = r;
+        return true;
+    }
+
+    int channel_of(const std::string& name) const {
+        auto it = interfaces_.find(name);
+        if (it != interfaces_.end()) return it->second;
+        size_t i = name.size();
+        while (i > 0 && name[i - 1] >= '0' && name[i - 1] <= '9') --i;
+        if (i == name.size()) return 0;
+        return std::atoi(name.c_str() + i);
+    }
+
+    std::map<std::string, int> interfaces_;
+    std::string iface_;
+};
+
+// Vector ASC. Classic lines "<t> <ch> <id>[x] Rx|Tx d|r <dlc> <data>",
+// FD lines "<t> CANFD <ch> Rx|Tx <id>[x] [name] <brs> <esi> <dlc> <len> <data>
+// ... <flags> ...". Other events are ignored; lines that name a channel but
+// are no frame (error frames, statistics) are counted as skipped.
+class AscReader : public TextLogReader {
+public:
+    explicit AscReader(const std::string& path) : TextLogReader(path) {}
+
+    void rewind() override {
+        TextLogReader::rewind();
+        last_ns_ = 0;
+    }
+
+protected:
+    bool parse(const char* p, CaptureRecord& out) override {
+        const char* tok;
+        size_t len;
+        if (!token(p, tok, len)) return false;
+        if (!(*tok >= '0' && *tok <= '9')) {
+            header(tok, len, p);
+            return false;
+        }
+        uint64_t t;
+        if (!parse_time(tok, len, t)) return false;
+        if (relative_) t += last_ns_;
+        last_ns_ = t;
+
+        if (!token(p, tok, len)) return false;
+        CaptureRecord r = blank();
+        r.timestamp_ns = start_ns_ + t;
+        bool ok;
+        if (len == 5 && std::memcmp(tok, "CANFD", 5) == 0) {
+            ok = parse_fd(p, r);
+        } else if (parse_uint(tok, len, 10, r.id) && r.id >= 1 && r.id <= 256) {
+            r.channel = (uint8_t)(r.id - 1);
+            r.id = 0;
+            ok = parse_classic(p, r);
+        } else {
+            return false; // An event without a channel
+        }
+        if (!ok) {
+            ++skipped_;
+            return false;
+        }
+        out = r;
+        return true;
+    }
+
+private:
+    static bool token(const char*& p, const char*& tok, size_t& len) {
+        while (*p == ' ' || *p == '\t') ++p;
+        tok = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') ++p;
+        len = (size_t)(p - tok);
+        return len > 0;
+    }
+
+    static bool is(const char* tok, size_t len, const char* word) {
+        return std::strlen(word) == len && std::memcmp(tok, word, len) == 0;
+    }
+
+    static bool parse_uint(const char* tok, size_t len, int base, uint32_t& v) {
+        if (len == 0 || len > 10) return false;
+        uint64_t x = 0;
+        for (size_t i = 0; i < len; ++i) {
+            uint8_t d = hex_digit(tok[i]);
+            if (d >= base) return false;
+            x = x * (uint64_t)base + d;
+        }
+        if (x > UINT32_MAX) return false;
+        v = (uint32_t)x;
+        return true;
+    }
+
+    static bool parse_time(const char* tok, size_t len, uint64_t& ns) {
+        uint64_t sec = 0, frac = 0;
+        size_t i = 0;
+        for (; i < len && tok[i] >= '0' && tok[i] <= '9'; ++i) sec = sec * 10 + (uint64_t)(tok[i] - '0');
+        int digits = 0;
+        if (i < len && tok[i] == '.') {
+            for (++i; i < len && tok[i] >= '0' && tok[i] <= '9'; ++i) {
+                if (digits < 9) {
+                    frac = frac * 10 + (uint64_t)(tok[i] - '0');
+                    ++digits;
+                }
+            }
+        }
+        if (i != len) return false;
+        for (; digits < 9; ++digits) frac *= 10;
+        ns = sec * 1000000000ull + frac;
+        return true;
+    }
+
+    bool parse_id(const char* tok, size_t len, CaptureRecord& r) const {
+        if (len > 1 && (tok[len - 1] == 'x' || tok[len - 1] == 'X')) {
+            r.flags |= CAPTURE_EXT;
+            --len;
+        }
+        return parse_uint(tok, len, base_, r.id);
+    }
+
+    bool parse_dir(const char* tok, size_t len, CaptureRecord& r) const {
+        if (is(tok, len, "Tx")) {
+            r.flags |= CAPTURE_TX;
+            return true;
+        }
+        return is(tok, len, "Rx") || is(tok, len, "TxRq");
+    }
+
+    bool parse_data(const char*& p, CaptureRecord& r, size_t n) const {
+        const char* tok;
+        size_t len;
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t v;
+            if (!token(p, tok, len) || !parse_uint(tok, len, base_, v) || v > 0xFF) return false;
+            r.data[i] = (uint8_t)v;
+        }
+        r.len = (uint8_t)n;
+        return true;
+    }
+
+    bool parse_classic(const char* p, CaptureRecord& r) const {
+        const char* tok;
+        size_t len;
+        uint32_t dlc = 0;
+        if (!token(p, tok, len) || !parse_id(tok, len, r)) return false;
+        if (!token(p, tok, len) || !parse_dir(tok, len, r)) return false;
+        if (!token(p, tok, len)) return false;
+        if (is(tok, len, "r")) {
+            r.flags |= CAPTURE_RTR;
+            const char* q = p;
+            if (token(q, tok, len) && parse_uint(tok, len, 16, dlc) && dlc <= 8) r.len = (uint8_t)dlc;
+            return true;
+        }
+        if (!is(tok, len, "d")) return false;
+        if (!token(p, tok, len) || !parse_uint(tok, len, 16, dlc) || dlc > 15) return false;
+        return parse_data(p, r, dlc > 8 ? 8 : dlc);
+    }
+
+    bool parse_fd(const char* p, CaptureRecord& r) const {
+        const char* tok;
+        size_t len;
+        uint32_t channel, v, dlc, n;
+        if (!token(p, tok, len) || !parse_uint(tok, len, 10, channel) || channel < 1 || channel > 256) return false;
+        r.channel = (uint8_t)(channel - 1);
+        if (!token(p, tok, len) || !parse_dir(tok, len, r)) return false;
+        if (!token(p, tok, len) || !parse_id(tok, len, r)) return false;
+        // Optional symbolic name, then BRS and ESI as single digits
+        if (!token(p, tok, len)) return false;
+        if (!(len == 1 && (*tok == '0' || *tok == '1')) && !token(p, tok, len)) return false;
+        if (!(len == 1 && (*tok == '0' || *tok == '1'))) return false;
+        bool brs = *tok == '1';
+        if (!token(p, tok, len) || !(len == 1 && (*tok == '0' || *tok == '1'))) return false;
+        if (!token(p, tok, len) || !parse_uint(tok, len, 16, dlc) || dlc > 15) return false;
+        if (!token(p, tok, len) || !parse_uint(tok, len, 10, n) || n > CanFrame::MAX_LEN) return false;
+        if (!parse_data(p, r, n)) return false;
+        // Duration, length, flags: EDL tells FD from classic frames on an FD channel
+        bool fd = true;
+        if (token(p, tok, len) && token(p, tok, len) && token(p, tok, len) && parse_uint(tok, len, 16, v)) {
+            fd = (v & 0x1000) != 0;
+        }
+        if (fd) {
+            r.flags |= CAPTURE_FD;
+            if (brs) r.flags |= CAPTURE_BRS;
+        } else if (n > 8) {
+            return false;
+        }
+        (void)dlc;
+        return true;
+    }
+
+    // "date ...", "base hex|dec  timestamps absolute|relative"
+    void header(const char* tok, size_t len, const char* p) {
+        if (is(tok, len, "date")) {
+            start_ns_ = parse_date(p);
+        } else if (is(tok, len, "base")) {
+            if (!token(p, tok, len)) return;
+            base_ = is(tok, len, "dec") ? 10 : 16;
+            if (token(p, tok, len) && is(tok, len, "timestamps") && token(p, tok, len)) {
+                relative_ = is(tok, len, "relative");
+            }
+        } else if (is(tok, len, "Begin") && start_ns_ == 0) {
+            if (token(p, tok, len) && is(tok, len, "Triggerblock")) start_ns_ = parse_date(p);
+        }
+    }
+
+    // "Thu Oct 16 10:22:33.123 am 2026" or the 24-hour form without am/pm
+    static uint64_t parse_date(const char* p) {
+        const char* tok;
+        size_t len;
+        struct tm tm;
+        std::memset(&tm, 0, sizeof(tm));
+        if (!token(p, tok, len)) return 0; // Weekday
+        if (!token(p, tok, len) || len != 3) return 0;
+        tm.tm_mon = -1;
+        for (int i = 0; i < 12; ++i) {
+            if (std::memcmp(tok, MONTHS[i], 3) == 0) tm.tm_mon = i;
+        }
+        if (tm.tm_mon < 0) return 0;
+        uint32_t v;
+        if (!token(p, tok, len) || !parse_uint(tok, len, 10, v)) return 0;
+        tm.tm_mday = (int)v;
+        if (!token(p, tok, len)) return 0;
+        unsigned h = 0, m = 0, s = 0, ms = 0;
+        int n = std::sscanf(std::string(tok, len).c_str(), "%u:%u:%u.%u", &h, &m, &s, &ms);
+        if (n < 3) return 0;
+        // Milliseconds: the first three fraction digits
+        const char* dot = static_cast<const char*>(std::memchr(tok, '.', len));
+        if (dot) {
+            ms = 0;
+            int digits = 0;
+            for (const char* q = dot + 1; q < tok + len && *q >= '0' && *q <= '9' && digits < 3; ++q, ++digits) {
+                ms = ms * 10 + (unsigned)(*q - '0');
+            }
+            for (; digits < 3; ++digits) ms *= 10;
+        }
+        if (!token(p, tok, len)) return 0;
+        if (is(tok, len, "am") || is(tok, len, "pm")) {
+            h %= 12;
+            if (*tok == 'p') h += 12;
+            if (!token(p, tok, len)) return 0;
+        }
+        if (!parse_uint(tok, len, 10, v) || v < 1970) return 0;
+        tm.tm_year = (int)v - 1900;
+        tm.tm_hour = (int)h;
+        tm.tm_min = (int)m;
+        tm.tm_sec = (int)s;
+        return from_local_time(tm, ms);
+    }
+
+    int base_ = 16;
+    bool relative_ = false;
+    uint64_t start_ns_ = 0;
+    uint64_t last_ns_ = 0;
+};
+
+// BLF: top-level objects, most of them log containers. Container payloads
+// are inflated into one buffer from which the objects are parsed; an object
+// cut at the end of a container is completed by the next one.
+class BlfReader : public LogReader {
+public:
+    explicit BlfReader(const std::string& path) {
+        file_ = std::fopen(path.c_str(), "rb");
+        if (!file_) throw std::runtime_error("Failed to open " + path);
+        BlfFileHeader h;
+        if (std::fread(&h, 1, 72, file_) != 72 || std::memcmp(h.signature, "LOGG", 4) != 0 || h.header_size < 72) {
+            std::fclose(file_);
+            throw std::runtime_error("Not a BLF file: " + path);
+        }
+        header_size_ = h.header_size;
+        start_ns_ = from_systemtime(h.start_time);
+        rewind();
+    }
+
+    ~BlfReader() override {
+        if (file_) std::fclose(file_);
+    }
+
+    void rewind() override {
+        std::fseek(file_, (long)header_size_, SEEK_SET);
+        data_.clear();
+        pos_ = 0;
+        eof_ = false;
+    }
+
+    bool next(CaptureRecord& out) override {
+        for (;;) {
+            if (parse(out)) return true;
+            if (eof_ || !load()) {
+                eof_ = true;
+                return false;
+            }
+        }
+    }
+
+private:
+    // Read the next top-level object into data_. False at the end.
+    bool load() {
+        // Drop what has been parsed
+        size_t drop = std::min(pos_, data_.size());
+        data_.erase(data_.begin(), data_.begin() + (std::ptrdiff_t)drop);
+        pos_ -= drop;
+
+        BlfObjectHeader h;
+        if (std::fread(&h, 1, 16, file_) != 16) return false;
+        if (std::memcmp(h.signature, "LOBJ", 4) != 0 || h.object_size < 16 || h.object_size > (64u << 20)) {
+            ++skipped_; // Lost sync, or cut off by a crash
+            return false;
+        }
+        size_t body = h.object_size - 16 + blf_padding(h.object_size);
+        raw_.resize(body);
+        size_t got = std::fread(raw_.data(), 1, body, file_);
+        if (got < h.object_size - 16) return false;
+
+        if (h.object_type != BLF_LOG_CONTAINER) {
+            // A bare object: parsed like container contents
+            size_t at = data_.size();
+            data_.resize(at + 16 + body);
+            std::memcpy(&data_[at], &h, 16);
+            std::memcpy(&data_[at + 16], raw_.data(), body);
+            return true;
+        }
+        if (h.object_size < 16 + sizeof(BlfContainerHeader)) return true;
+        BlfContainerHeader c;
+        std::memcpy(&c, raw_.data(), sizeof(c));
+        const uint8_t* payload = raw_.data() + sizeof(c);
+        size_t payload_len = h.object_size - 16 - sizeof(c);
+        if (c.compression == BLF_NO_COMPRESSION) {
+            data_.insert(data_.end(), payload, payload + payload_len);
+        } else if (c.compression == BLF_ZLIB_DEFLATE) {
+#ifdef SLCANX_HAVE_ZLIB
+            size_t at = data_.size();
+            data_.resize(at + c.uncompressed_size);
+            uLongf out_len = c.uncompressed_size;
+            if (uncompress(data_.data() + at, &out_len, payload, (uLong)payload_len) != Z_OK) {
+                data_.resize(at);
+                ++skipped_;
+                return true;
+            }
+            data_.resize(at + out_len);
+#else
+            throw std::runtime_error("BLF file is zlib-compressed; slcanx was built without zlib");
+#endif
+        } else {
+            ++skipped_;
+        }
+        return true;
+    }
+
+    // Next CAN frame from data_. False when more data is needed.
+    bool parse(CaptureRecord& out) {
+        for (;;) {
+            if (pos_ + 16 > data_.size()) return false;
+            const uint8_t* p = data_.data() + pos_;
+            if (std::memcmp(p, "LOBJ", 4) != 0) {
+                // Resynchronise on the next signature
+                const uint8_t* end = data_.data() + data_.size();
+                const uint8_t* q = std::search(p + 1, end, "LOBJ", "LOBJ" + 4);
+                pos_ = q == end ? data_.size() - 3 : (size_t)(q - data_.data());
+                continue;
+            }
+            BlfObjectHeader h;
+            std::memcpy(&h, p, 16);
+            if (h.header_size < 16 || h.object_size < h.header_size) {
+                pos_ += 4;
+                ++skipped_;
+                continue;
+            }
+            if (pos_ + h.object_size > data_.size()) return false;
+            size_t next = pos_ + h.object_size;
+            if (h.object_type != BLF_CAN_FD_MESSAGE_64) next += blf_padding(h.object_size);
+            bool ok = decode(p, h, out);
+            pos_ = next;
+            if (ok) return true;
+            ++skipped_;
+        }
+    }
+
+    bool decode(const uint8_t* p, BlfObjectHeader& h, CaptureRecord& out) const {
+        if (h.header_size < 32) return false;
+        std::memcpy(&h, p, 32);
+        const uint8_t* body = p + h.header_size;
+        size_t body_len = h.object_size - h.header_size;
+        CaptureRecord r;
+        std::memset(&r, 0, sizeof(r));
+        r.timestamp_ns = start_ns_ + (h.flags == BLF_TIME_TEN_MICS ? h.timestamp * 10000 : h.timestamp);
+
+        uint32_t id;
+        if (h.object_type == BLF_CAN_MESSAGE || h.object_type == BLF_CAN_MESSAGE2) {
+            BlfCanMessage m;
+            if (body_len < sizeof(m)) return false;
+            std::memcpy(&m, body, sizeof(m));
+            if (m.channel < 1 || m.channel > 256) return false;
+            r.channel = (uint8_t)(m.channel - 1);
+            if (m.flags & BLF_DIR_TX) r.flags |= CAPTURE_TX;
+            if (m.flags & BLF_REMOTE) r.flags |= CAPTURE_RTR;
+            r.len = m.dlc > 8 ? 8 : m.dlc;
+            if (!(m.flags & BLF_REMOTE)) std::memcpy(r.data, m.data, r.len);
+            id = m.id;
+        } else if (h.object_type == BLF_CAN_FD_MESSAGE) {
+            BlfCanFdMessage m;
+            if (body_len < sizeof(m)) return false;
+            std::memcpy(&m, body, sizeof(m));
+            if (m.channel < 1 || m.channel > 256) return false;
+            r.channel = (uint8_t)(m.channel - 1);
+            if (m.flags & BLF_DIR_TX) r.flags |= CAPTURE_TX;
+            if (m.fd_flags & BLF_FD_EDL) {
+                r.flags |= CAPTURE_FD;
+                if (m.fd_flags & BLF_FD_BRS) r.flags |= CAPTURE_BRS;
+                r.len = m.valid_bytes > CanFrame::MAX_LEN ? (uint8_t)CanFrame::MAX_LEN : m.valid_bytes;
+            } else {
+                if (m.flags & BLF_REMOTE) r.flags |= CAPTURE_RTR;
+                r.len = m.dlc > 8 ? 8 : m.dlc;
+            }
+            if (!(r.flags & CAPTURE_RTR)) std::memcpy(r.data, m.data, r.len);
+            id = m.id;
+        } else if (h.object_type == BLF_CAN_FD_MESSAGE_64) {
+            BlfCanFdMessage64 m;
+            if (body_len < sizeof(m)) return false;
+            std::memcpy(&m, body, sizeof(m));
+            if (m.channel < 1) return false;
+            r.channel = (uint8_t)(m.channel - 1);
+            if (m.dir) r.flags |= CAPTURE_TX;
+            if (m.flags & BLF_FD64_EDL) {
+                r.flags |= CAPTURE_FD;
+                if (m.flags & BLF_FD64_BRS) r.flags |= CAPTURE_BRS;
+            } else if (m.flags & BLF_FD64_REMOTE) {
+                r.flags |= CAPTURE_RTR;
+            }
+            r.len = (uint8_t)std::min<size_t>(m.valid_bytes, CanFrame::MAX_LEN);
+            if (r.flags & CAPTURE_RTR) {
+                r.len = (uint8_t)std::min<size_t>(dlc_to_len(m.dlc), 8);
+            } else {
+                // Data may be shorter than valid_bytes; the rest reads as zero
+                size_t avail = body_len - sizeof(m);
+                if (m.ext_data_offset != 0 && m.ext_data_offset >= h.header_size + sizeof(m)) {
+                    avail = std::min<size_t>(avail, m.ext_data_offset - h.header_size - sizeof(m));
+                }
+                std::memcpy(r.data, body + sizeof(m), std::min<size_t>(avail, r.len));
+            }
+            id = m.id;
+        } else {
+            return false;
+        }
+        if (id & BLF_EXT_ID) r.flags |= CAPTURE_EXT;
+        r.id = id & ~BLF_EXT_ID;
+        out = r;
+        return true;
+    }
+
+    std::FILE* file_ = nullptr;
+    uint32_t header_size_ = 0;
+    uint64_t start_ns_ = 0;
+    std::vector<uint8_t> raw_;   // Current top-level object
+    std::vector<uint8_t> data_;  // Inflated objects not parsed yet
+    size_t pos_ = 0;
+    bool eof_ = false;
+};
+
+class CaptureLogReader : public LogReader {
+public:
+    CaptureLogReader(const std::string& path, const std::string& prefix) : path_(path), prefix_(prefix) {
+        rewind();
+    }
+
+    bool next(CaptureRecord& out) override {
+        const CaptureRecord* r = reader_->next();
+        if (!r) return false;
+        out = *r;
+        return true;
+    }
+
+    void rewind() override {
+        reader_.reset();
+        reader_ = std::make_unique<CaptureReader>(path_, prefix_);
+    }
+
+private:
+    std::string path_;
+    std::string prefix_;
+    std::unique_ptr<CaptureReader> reader_;
+};
+
+std::unique_ptr<LogReader> open_log(const std::string& path, const LogReaderOptions& options) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) < 0) throw std::runtime_error("Failed to open " + path);
+    if (S_ISDIR(st.st_mode)) return std::make_unique<CaptureLogReader>(path, options.capture_prefix);
+
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) throw std::runtime_error("Failed to open " + path);
+    char head[64] = {};
+    size_t n = std::fread(head, 1, sizeof(head) - 1, f);
+    std::fclose(f);
+    if (n >= 8 && std::memcmp(head, "SLCXCAP", 8) == 0) {
+        return std::make_unique<CaptureLogReader>(path, options.capture_prefix);
+    }
+    if (n >= 4 && std::memcmp(head, "LOGG", 4) == 0) return std::make_unique<BlfReader>(path);
+    if (ends_with(path, ".asc") || std::strncmp(head, "date ", 5) == 0 || std::strncmp(head, "base ", 5) == 0) {
+        return std::make_unique<AscReader>(path);
+    }
+    return std::make_unique<CandumpReader>(path, options.interfaces);
+}
+
+} // namespace slcanx
@@ -0,0 +1,150 @@
+#include "slcanx_metrics.hpp"
+#include <sstream>
+
+namespace slcanx {
+
+// ================= Histogram =================
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot s;
+    s.counts.resize(BUCKETS);
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        s.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        s.count += s.counts[i];
+    }
+    s.sum = sum_.load(std::memory_order_relaxed);
+    s.max = max_.load(std::memory_order_relaxed);
+    return s;
+}
+
+uint64_t HistogramSnapshot::quantile(double q) const {
+    if (count == 0) return 0;
+    if (q < 0) q = 0;
+    if (q > 1) q = 1;
+    uint64_t rank = (uint64_t)(q * (double)count + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t high = i + 1 < Histogram::BUCKETS ? Histogram::bucket_low(i + 1) - 1 : max;
+            return high < max ? high : max;
+        }
+    }
+    return max;
+}
+
+// ================= Text export =================
+
+static void counter(std::ostringstream& out, const std::string& name, const char* help) {
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n";
+}
+
+static void gauge(std::ostringstream& out, const std::string& name, const char* help) {
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name << " gauge\n";
+}
+
+template <typename Get>
+static void per_channel(std::ostringstream& out, const MetricsSnapshot& m, const std::string& name,
+                        const char* help, bool is_counter, Get get) {
+    if (is_counter) {
+        counter(out, name, help);
+    } else {
+        gauge(out, name, help);
+    }
+    for (size_t ch = 0; ch < m.channels.size(); ++ch) {
+        out << name << "{channel=\"" << ch << "\"} " << (uint64_t)get(m.channels[ch]) << "\n";
+    }
+}
+
+static void summary(std::ostringstream& out, const std::string& name, const char* help,
+                    const HistogramSnapshot& h) {
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name << " summary\n";
+    const struct {
+        const char* label;
+        double q;
+    } quantiles[] = {{"0.5", 0.5}, {"0.9", 0.9}, {"0.99", 0.99}, {"0.999", 0.999}};
+    for (const auto& q : quantiles) {
+        out << name << "{quantile=\"" << q.label << "\"} " << h.quantile(q.q) << "\n";
+    }
+    out << name << "_sum " << h.sum << "\n" << name << "_count " << h.count << "\n";
+}
+
+std::string format_metrics(const MetricsSnapshot& m, const std::string& prefix) {
+    std::ostringstream out;
+    const std::string p = prefix + "_";
+
+    per_channel(out, m, p + "rx_frames_total", "Frames delivered", true,
+                [](const ChannelMetrics& c) { return c.rx_frames; });
+    per_channel(out, m, p + "rx_bytes_total", "Payload bytes delivered", true,
+                [](const ChannelMetrics& c) { return c.rx_bytes; });
+    per_channel(out, m, p + "rx_filtered_total", "Frames rejected by the acceptance filter", true,
+                [](const ChannelMetrics& c) { return c.rx_filtered; });
+    per_channel(out, m, p + "rx_dropped_total", "Frames lost to a full RX queue", true,
+                [](const ChannelMetrics& c) { return c.rx_dropped; });
+    per_channel(out, m, p + "rx_queue_depth", "Frames waiting in the RX queue", false,
+                [](const ChannelMetrics& c) { return c.rx_queue_depth; });
+    per_channel(out, m, p + "tx_frames_total", "Frames written to the serial port", true,
+                [](const ChannelMetrics& c) { return c.tx_frames; });
+    per_channel(out, m, p + "tx_bytes_total", "Payload bytes written to the serial port", true,
+                [](const ChannelMetrics& c) { return c.tx_bytes; });
+    per_channel(out, m, p + "parse_errors_total", "Frame lines that did not decode", true,
+                [](const ChannelMetrics& c) { return c.parse_errors; });
+    per_channel(out, m, p + "status_lines_total", "Firmware status lines", true,
+                [](const ChannelMetrics& c) { return c.status_lines; });
+    per_channel(out, m, p + "fw_rx_overflow_total", "Status lines flagging a full CAN RX buffer", true,
+                [](const ChannelMetrics& c) { return c.fw_rx_overflow; });
+    per_channel(out, m, p + "fw_tx_full_total", "Status lines flagging a full CAN TX FIFO", true,
+                [](const ChannelMetrics& c) { return c.fw_tx_full; });
+    per_channel(out, m, p + "fw_usb_overflow_total", "Status lines flagging a full USB IN buffer", true,
+                [](const ChannelMetrics& c) { return c.fw_usb_overflow; });
+    per_channel(out, m, p + "bus_state", "0 active, 1 warning, 2 passive, 3 bus-off", false,
+                [](const ChannelMetrics& c) { return c.bus_state; });
+    per_channel(out, m, p + "tx_error_count", "CAN transmit error counter", false,
+                [](const ChannelMetrics& c) { return c.tx_error_count; });
+    per_channel(out, m, p + "rx_error_count", "CAN receive error counter", false,
+                [](const ChannelMetrics& c) { return c.rx_error_count; });
+
+    const struct {
+        const char* name;
+        const char* help;
+        uint64_t value;
+    } counters[] = {
+        {"serial_reads_total", "Serial reads that returned data", m.reads},
+        {"serial_read_bytes_total", "Bytes read from the serial port", m.read_bytes},
+        {"serial_read_errors_total", "Serial reads that failed with a port error or hang-up", m.read_errors},
+        {"line_overflows_total", "Lines dropped for missing their terminator", m.line_overflows},
+        {"unknown_lines_total", "Lines that were neither frames, status nor awaited replies", m.unknown_lines},
+        {"serial_writes_total", "Serial writes", m.tx.writes},
+        {"serial_write_bytes_total", "Bytes written to the serial port", m.tx.bytes},
+        {"serial_write_errors_total", "Failed serial writes", m.write_errors},
+        {"tx_rejected_total", "try_send calls refused for a full TX ring", m.tx_rejected},
+        {"tx_blocked_total", "send calls that waited for TX ring space", m.tx_blocked},
+    };
+    for (const auto& c : counters) {
+        counter(out, p + c.name, c.help);
+        out << p << c.name << " " << c.value << "\n";
+    }
+
+    const std::string flush = p + "flush_total";
+    counter(out, flush, "Serial writes by the reason they were issued");
+    out << flush << "{reason=\"idle\"} " << m.tx.flush_idle << "\n"
+        << flush << "{reason=\"full\"} " << m.tx.flush_full << "\n"
+        << flush << "{reason=\"window\"} " << m.tx.flush_window << "\n"
+        << flush << "{reason=\"explicit\"} " << m.tx.flush_explicit << "\n";
+
+    gauge(out, p + "tx_ring_used_bytes", "Bytes queued in the TX ring");
+    out << p << "tx_ring_used_bytes " << m.tx_ring_used << "\n";
+    gauge(out, p + "tx_ring_peak_bytes", "Highest TX ring fill seen by the writer");
+    out << p << "tx_ring_peak_bytes " << m.tx_ring_peak << "\n";
+    gauge(out, p + "tx_ring_capacity_bytes", "TX ring size");
+    out << p << "tx_ring_capacity_bytes " << m.tx_ring_capacity << "\n";
+
+    summary(out, p + "tx_latency_ns", "send() to serial write completion", m.tx_latency_ns);
+    summary(out, p + "write_bytes", "Bytes per serial write", m.write_bytes);
+    summary(out, p + "read_chunk_bytes", "Bytes per serial read", m.read_chunk_bytes);
+    summary(out, p + "callback_ns", "RX callback duration", m.callback_ns);
+    return out.str();
+}
+
+} // namespace slcanx
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace slcanx {
+
+// Open a tty for SLCANX in raw, non-blocking mode (termios raw, no flow
+// control, ASYNC_LOW_LATENCY, DTR asserted). "ttyACM0" means "/dev/ttyACM0".
+// Returns the fd; throws std::runtime_error on failure. POSIX backend only.
+int open_tty(const std::string& port, uint32_t baudrate);
+
+} // namespace slcanx
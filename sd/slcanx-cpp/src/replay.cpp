@@ -0,0 +1,176 @@
+#include "slcanx_replay.hpp"
+#include "slcanx_log.hpp"
+#include <cerrno>
+#include <stdexcept>
+#include <time.h>
+
+namespace slcanx {
+
+// ================= Clock =================
+
+// steady_clock is CLOCK_MONOTONIC on Linux, the clock slept on below.
+static uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ================= ReplayEngine =================
+
+ReplayEngine::ReplayEngine(Slcanx& bus, const std::string& path, const ReplayOptions& options)
+    : bus_(bus), opt_(options) {
+    if (!opt_.max_speed && !(opt_.speed >= 0.1 && opt_.speed <= 10.0)) {
+        throw std::runtime_error("Replay speed must be within 0.1 .. 10");
+    }
+    LogReaderOptions log;
+    log.interfaces = opt_.interfaces;
+    log.capture_prefix = opt_.capture_prefix;
+    source_ = open_log(path, log);
+    batch_.reserve(256);
+    sending_.reserve(256);
+    thread_ = std::thread(&ReplayEngine::run, this);
+}
+
+ReplayEngine::~ReplayEngine() {
+    stop();
+    if (thread_.joinable()) thread_.join();
+}
+
+void ReplayEngine::stop() {
+    running_ = false;
+}
+
+void ReplayEngine::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return done_; });
+}
+
+bool ReplayEngine::wait_for(std::chrono::nanoseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, timeout, [this] { return done_; });
+}
+
+ReplayStats ReplayEngine::stats() const {
+    ReplayStats st;
+    st.frames = frames_.load(std::memory_order_relaxed);
+    st.batches = batches_.load(std::memory_order_relaxed);
+    st.skipped = skipped_.load(std::memory_order_relaxed);
+    st.loops = loops_.load(std::memory_order_relaxed);
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) {
+        st.channel_frames[ch] = channel_frames_[ch].load(std::memory_order_relaxed);
+    }
+    st.lateness_ns = lateness_.snapshot();
+    st.interval_error_ns = interval_error_.snapshot();
+    std::lock_guard<std::mutex> lock(mutex_);
+    st.done = done_;
+    return st;
+}
+
+static void bump(std::atomic<uint64_t>& c, uint64_t n = 1) {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// Sleep to `deadline` - spin on CLOCK_MONOTONIC in slices short enough to
+// notice stop(), then busy-wait the rest.
+static void wait_until(uint64_t deadline, uint64_t spin_ns, const std::atomic<bool>& running) {
+    constexpr uint64_t SLICE_NS = 100000000;
+    for (;;) {
+        uint64_t now = now_ns();
+        if (now >= deadline || !running) return;
+        if (deadline - now <= spin_ns) break;
+        uint64_t wake = deadline - spin_ns;
+        if (wake - now > SLICE_NS) wake = now + SLICE_NS;
+        // Absolute deadline: oversleeping one frame does not shift the next one
+        struct timespec ts;
+        ts.tv_sec = (time_t)(wake / 1000000000ull);
+        ts.tv_nsec = (long)(wake % 1000000000ull);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        }
+    }
+    while (now_ns() < deadline) {
+    }
+}
+
+void ReplayEngine::send() {
+    sending_.clear();
+    for (const Pending& p : batch_) sending_.push_back(p.item);
+    bus_.send_batch(sending_);
+    if (opt_.flush) bus_.flush();
+    uint64_t t = now_ns();
+
+    if (!opt_.max_speed) {
+        for (const Pending& p : batch_) lateness_.record(t > p.deadline_ns ? t - p.deadline_ns : 0);
+        uint64_t deadline = batch_.front().deadline_ns;
+        if (last_sent_ns_ != 0) {
+            int64_t intended = (int64_t)(deadline - last_deadline_ns_);
+            int64_t achieved = (int64_t)(t - last_sent_ns_);
+            interval_error_.record((uint64_t)(achieved > intended ? achieved - intended : intended - achieved));
+        }
+        last_deadline_ns_ = deadline;
+    }
+    last_sent_ns_ = t;
+
+    for (const ChannelFrame& f : sending_) bump(channel_frames_[f.channel]);
+    bump(frames_, sending_.size());
+    bump(batches_);
+    batch_.clear();
+}
+
+void ReplayEngine::run() {
+    constexpr size_t MAX_BATCH = 256;
+    const double scale = opt_.max_speed ? 0.0 : 1.0 / opt_.speed;
+    const uint64_t spin_ns = (uint64_t)opt_.spin.count() * 1000;
+    uint64_t base = now_ns();
+
+    for (uint32_t pass = 0; running_; ++pass) {
+        if (pass > 0) source_->rewind();
+        bool first = true;
+        uint64_t t0 = 0;
+        uint64_t last = base;
+        uint64_t skipped = source_->skipped();
+        CaptureRecord record;
+        while (running_ && source_->next(record)) {
+            uint32_t channel = record.channel;
+            int mapped = -1;
+            if (opt_.channel_map.empty()) {
+                if (channel < NUM_CHANNELS) mapped = (int)channel;
+            } else if (channel < opt_.channel_map.size()) {
+                mapped = opt_.channel_map[channel];
+            }
+            if (mapped < 0 || mapped >= NUM_CHANNELS) {
+                bump(skipped_);
+                continue;
+            }
+            CanFrame frame = record.frame();
+            if (first) {
+                t0 = frame.timestamp_ns;
+                first = false;
+            }
+            // Never earlier than the frame before: replay keeps capture order
+            uint64_t deadline = last;
+            if (!opt_.max_speed && frame.timestamp_ns > t0) {
+                deadline = base + (uint64_t)((double)(frame.timestamp_ns - t0) * scale);
+                if (deadline < last) deadline = last;
+            }
+            last = deadline;
+
+            // Frames due already join the batch; the next future one sends it
+            if (!batch_.empty() && (deadline > now_ns() || batch_.size() == MAX_BATCH)) send();
+            if (batch_.empty() && !opt_.max_speed) wait_until(deadline, spin_ns, running_);
+            frame.timestamp_ns = 0;
+            batch_.push_back({deadline, ChannelFrame{(uint8_t)mapped, frame}});
+        }
+        if (!batch_.empty() && running_) send();
+        batch_.clear();
+        bump(skipped_, source_->skipped() - skipped);
+        if (!running_) break;
+        bump(loops_);
+        if (opt_.loops != 0 && pass + 1 >= opt_.loops) break;
+        base = (opt_.max_speed ? now_ns() : last) + (uint64_t)opt_.loop_gap.count() * 1000;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_ = true;
+    cv_.notify_all();
+}
+
+} // namespace slcanx
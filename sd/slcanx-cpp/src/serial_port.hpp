@@ -0,0 +1,38 @@
+#pragma once
+
+#include "slcanx.hpp"
+#include <string>
+#include <memory>
+#include <cstdint>
+
+namespace slcanx {
+
+// Platform serial backend. One translation unit per backend
+// (serial_win32.cpp / serial_posix.cpp), picked by SLCANX_SERIAL_BACKEND.
+class Slcanx::SerialPort {
+public:
+    SerialPort(const std::string& port, uint32_t baudrate);
+    ~SerialPort();
+
+    // Blocks until data is available, the port is cancelled, `timeout_ms`
+    // passes (-1 = no limit) or an error occurs.
+    // Returns bytes read, 0 on timeout/cancel, -1 on error.
+    int read(uint8_t* buf, int max_len, int timeout_ms = -1);
+    bool write(const uint8_t* buf, int len);
+
+    // Wake up a reader blocked in read().
+    void cancel();
+
+    // OS handle for an external poller (SlcanxOptions::external_drive),
+    // -1 if the backend has none.
+    int fd() const;
+
+    // Current time in ns on the requested clock, for RX timestamps.
+    static uint64_t now_ns(TimestampClock clock);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace slcanx
@@ -0,0 +1,207 @@
+#include "serial_port.hpp"
+#include "posix_tty.hpp"
+#include <stdexcept>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+
+namespace slcanx {
+
+// ================= SerialPort Implementation (POSIX) =================
+
+static speed_t look_up_speed(uint32_t baudrate) {
+    switch (baudrate) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+#ifdef B460800
+        case 460800: return B460800;
+#endif
+#ifdef B921600
+        case 921600: return B921600;
+#endif
+#ifdef B1000000
+        case 1000000: return B1000000;
+#endif
+#ifdef B2000000
+        case 2000000: return B2000000;
+#endif
+#ifdef B4000000
+        case 4000000: return B4000000;
+#endif
+    }
+    // USB CDC ignores the line rate anyway
+    return B115200;
+}
+
+struct Slcanx::SerialPort::Impl {
+    int fd = -1;
+    int epfd = -1;
+    int wakefd = -1;
+
+    ~Impl() {
+        if (wakefd >= 0) ::close(wakefd);
+        if (epfd >= 0) ::close(epfd);
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+int open_tty(const std::string& port, uint32_t baudrate) {
+    // Accept both "/dev/ttyACM0" and "ttyACM0"
+    std::string path = port.rfind("/", 0) == 0 ? port : "/dev/" + port;
+    int fd = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open serial port");
+    }
+
+    struct termios tios;
+    if (tcgetattr(fd, &tios) < 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to get comm state");
+    }
+    cfmakeraw(&tios);
+    tios.c_cflag |= CLOCAL | CREAD;
+    tios.c_cflag &= ~CRTSCTS;
+    tios.c_iflag &= ~(IXON | IXOFF);
+    tios.c_cc[VMIN] = 0;
+    tios.c_cc[VTIME] = 0;
+    cfsetispeed(&tios, look_up_speed(baudrate));
+    cfsetospeed(&tios, look_up_speed(baudrate));
+    if (tcsetattr(fd, TCSANOW, &tios) < 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to set comm state");
+    }
+    tcflush(fd, TCIOFLUSH);
+
+#ifdef __linux__
+    // Same as slcandx: without ASYNC_LOW_LATENCY the tty layer may defer
+    // pushing received bytes to a workqueue. Not every driver supports it.
+    struct serial_struct ss;
+    if (ioctl(fd, TIOCGSERIAL, &ss) == 0) {
+        ss.flags |= ASYNC_LOW_LATENCY;
+        ioctl(fd, TIOCSSERIAL, &ss);
+    }
+#endif
+
+    // Important for CDC, see DTR_CONTROL_ENABLE on Windows
+    int dtr = TIOCM_DTR;
+    ioctl(fd, TIOCMBIS, &dtr);
+    return fd;
+}
+
+Slcanx::SerialPort::SerialPort(const std::string& port, uint32_t baudrate)
+    : impl_(std::make_unique<Impl>()) {
+    impl_->fd = open_tty(port, baudrate);
+    int fd = impl_->fd;
+
+    impl_->epfd = epoll_create1(EPOLL_CLOEXEC);
+    impl_->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (impl_->epfd < 0 || impl_->wakefd < 0) {
+        throw std::runtime_error("Failed to create epoll instance");
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(impl_->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        throw std::runtime_error("Failed to register serial port");
+    }
+    ev.data.fd = impl_->wakefd;
+    if (epoll_ctl(impl_->epfd, EPOLL_CTL_ADD, impl_->wakefd, &ev) < 0) {
+        throw std::runtime_error("Failed to register wake event");
+    }
+}
+
+Slcanx::SerialPort::~SerialPort() = default;
+
+int Slcanx::SerialPort::read(uint8_t* buf, int max_len, int timeout_ms) {
+    for (;;) {
+        ssize_t n = ::read(impl_->fd, buf, max_len);
+        if (n > 0) return (int)n;
+        // With VMIN = VTIME = 0 an idle tty reads 0 rather than EAGAIN; a
+        // hang-up shows up as EIO here or as EPOLLHUP below
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+        if (timeout_ms == 0) return 0; // Polled from outside, nothing to wait for
+
+        // Nothing pending: sleep in the kernel until the tty has data
+        struct epoll_event evs[2];
+        int nev = epoll_wait(impl_->epfd, evs, 2, timeout_ms);
+        if (nev < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (nev == 0) return 0;
+        bool readable = false;
+        for (int i = 0; i < nev; ++i) {
+            if (evs[i].data.fd == impl_->wakefd) {
+                uint64_t v;
+                ssize_t r = ::read(impl_->wakefd, &v, sizeof(v));
+                (void)r;
+                return 0;
+            }
+            if (evs[i].events & (EPOLLERR | EPOLLHUP)) return -1;
+            readable = true;
+        }
+        if (!readable) return 0;
+    }
+}
+
+bool Slcanx::SerialPort::write(const uint8_t* buf, int len) {
+    while (len > 0) {
+        ssize_t n = ::write(impl_->fd, buf, len);
+        if (n > 0) {
+            buf += n;
+            len -= (int)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // TX queue full (e.g. hardware flow control): wait for room
+            struct pollfd pfd = { impl_->fd, POLLOUT, 0 };
+            int r = poll(&pfd, 1, 10 + len);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false; // error or write timeout
+            if (pfd.revents & (POLLERR | POLLHUP)) return false;
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+void Slcanx::SerialPort::cancel() {
+    uint64_t one = 1;
+    ssize_t r = ::write(impl_->wakefd, &one, sizeof(one));
+    (void)r;
+}
+
+int Slcanx::SerialPort::fd() const {
+    return impl_->fd;
+}
+
+uint64_t Slcanx::SerialPort::now_ns(TimestampClock clock) {
+    clockid_t id = CLOCK_MONOTONIC;
+#ifdef CLOCK_TAI
+    if (clock == TimestampClock::Tai) id = CLOCK_TAI;
+#else
+    (void)clock;
+#endif
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+} // namespace slcanx
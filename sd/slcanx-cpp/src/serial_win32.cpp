@@ -0,0 +1,89 @@
+#include "serial_port.hpp"
+#include <stdexcept>
+#include <chrono>
+#include <windows.h>
+
+namespace slcanx {
+
+// ================= SerialPort Implementation (Windows) =================
+
+struct Slcanx::SerialPort::Impl {
+    HANDLE hComm = INVALID_HANDLE_VALUE;
+};
+
+Slcanx::SerialPort::SerialPort(const std::string& port, uint32_t baudrate)
+    : impl_(std::make_unique<Impl>()) {
+    std::string portName = "\\\\.\\" + port;
+    HANDLE hComm = CreateFileA(portName.c_str(),
+        GENERIC_READ | GENERIC_WRITE,
+        0, NULL, OPEN_EXISTING, 0, NULL);
+
+    if (hComm == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open serial port");
+    }
+
+    DCB dcbSerialParams = { 0 };
+    dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
+    if (!GetCommState(hComm, &dcbSerialParams)) {
+        CloseHandle(hComm);
+        throw std::runtime_error("Failed to get comm state");
+    }
+
+    dcbSerialParams.BaudRate = baudrate;
+    dcbSerialParams.ByteSize = 8;
+    dcbSerialParams.StopBits = ONESTOPBIT;
+    dcbSerialParams.Parity = NOPARITY;
+    dcbSerialParams.fDtrControl = DTR_CONTROL_ENABLE; // Important for CDC
+
+    if (!SetCommState(hComm, &dcbSerialParams)) {
+        CloseHandle(hComm);
+        throw std::runtime_error("Failed to set comm state");
+    }
+
+    COMMTIMEOUTS timeouts = { 0 };
+    timeouts.ReadIntervalTimeout = 1;
+    timeouts.ReadTotalTimeoutConstant = 1;
+    timeouts.ReadTotalTimeoutMultiplier = 1;
+    timeouts.WriteTotalTimeoutConstant = 10;
+    timeouts.WriteTotalTimeoutMultiplier = 1;
+    SetCommTimeouts(hComm, &timeouts);
+
+    impl_->hComm = hComm;
+}
+
+Slcanx::SerialPort::~SerialPort() {
+    if (impl_->hComm != INVALID_HANDLE_VALUE) {
+        CloseHandle(impl_->hComm);
+    }
+}
+
+int Slcanx::SerialPort::read(uint8_t* buf, int max_len, int) {
+    // ReadFile itself blocks for up to the COMMTIMEOUTS above, which is
+    // shorter than any timeout the caller asks for.
+    DWORD bytesRead;
+    if (ReadFile(impl_->hComm, buf, max_len, &bytesRead, NULL)) {
+        return bytesRead;
+    }
+    return -1;
+}
+
+bool Slcanx::SerialPort::write(const uint8_t* buf, int len) {
+    DWORD bytesWritten;
+    return WriteFile(impl_->hComm, buf, len, &bytesWritten, NULL) != 0;
+}
+
+void Slcanx::SerialPort::cancel() {
+    // Reads time out on their own (COMMTIMEOUTS), nothing to wake.
+}
+
+int Slcanx::SerialPort::fd() const {
+    return -1; // A HANDLE cannot go into a poll set
+}
+
+uint64_t Slcanx::SerialPort::now_ns(TimestampClock) {
+    // No TAI clock on Windows; steady_clock is QueryPerformanceCounter
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace slcanx
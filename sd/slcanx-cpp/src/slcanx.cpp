@@ -1,162 +1,434 @@
 #include "slcanx.hpp"
+#include "slcanx_capture.hpp"
+#include "slcanx_codec.hpp"
+#include "slcanx_filter.hpp"
+#include "slcanx_metrics.hpp"
+#include "slcanx_queue.hpp"
+#include "serial_port.hpp"
 #include <iostream>
-#include <sstream>
-#include <iomanip>
-#include <windows.h>
 #include <chrono>
+#include <cstring>
+#include <list>
+#include <stdexcept>
+#include <utility>
 
 namespace slcanx {
 
 // ================= CanFrame Implementation =================
 
-CanFrame CanFrame::new_std(uint32_t id, const std::vector<uint8_t>& data) {
+void CanFrame::set_payload(span<const uint8_t> bytes) {
+    len = (uint8_t)(bytes.size() < MAX_LEN ? bytes.size() : MAX_LEN);
+    std::memcpy(data.data(), bytes.data(), len);
+}
+
+CanFrame CanFrame::new_std(uint32_t id, span<const uint8_t> data) {
     CanFrame f;
     f.id = id;
-    f.data = data;
+    f.set_payload(data);
     f.ext = false;
     return f;
 }
 
-CanFrame CanFrame::new_ext(uint32_t id, const std::vector<uint8_t>& data) {
+CanFrame CanFrame::new_ext(uint32_t id, span<const uint8_t> data) {
     CanFrame f;
     f.id = id;
-    f.data = data;
+    f.set_payload(data);
     f.ext = true;
     return f;
 }
 
-CanFrame CanFrame::new_fd(uint32_t id, const std::vector<uint8_t>& data, bool brs) {
+CanFrame CanFrame::new_fd(uint32_t id, span<const uint8_t> data, bool brs) {
     CanFrame f;
     f.id = id;
-    f.data = data;
+    f.set_payload(data);
     f.ext = false; // Assuming std ID for simplicity, user can change
     f.fd = true;
     f.brs = brs;
     return f;
 }
 
-static uint8_t len_to_dlc(size_t len) {
-    if (len <= 8) return (uint8_t)len;
-    if (len <= 12) return 9;
-    if (len <= 16) return 10;
-    if (len <= 20) return 11;
-    if (len <= 24) return 12;
-    if (len <= 32) return 13;
-    if (len <= 48) return 14;
-    return 15;
+// ================= Slcanx Implementation =================
+
+Slcanx::Slcanx(const std::string& port, uint32_t baudrate, uint32_t group_window_us)
+    : Slcanx(port, SlcanxOptions{baudrate, group_window_us}) {
+}
+
+struct Slcanx::RxChannel {
+    RxQueue queue;
+    std::atomic<bool> waiting{false}; // A recv() is parked on cv
+    std::atomic<uint64_t> filtered{0}; // Written by the read thread only
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    RxChannel(size_t depth, RxOverflowPolicy policy) : queue(depth, policy) {}
+};
+
+// Written by the write thread only, read by tx_stats()
+struct Slcanx::TxCounters {
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> flush_idle{0};
+    std::atomic<uint64_t> flush_full{0};
+    std::atomic<uint64_t> flush_window{0};
+    std::atomic<uint64_t> flush_explicit{0};
+
+    static void bump(std::atomic<uint64_t>& c, uint64_t n = 1) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+// Outstanding query() calls, oldest first.
+struct Slcanx::QueryTable {
+    struct Pending {
+        uint8_t channel;
+        char cmd;
+        std::chrono::steady_clock::time_point deadline;
+        std::promise<std::string> promise;
+    };
+    std::mutex mutex;
+    std::list<Pending> pending;
+    std::atomic<size_t> count{0}; // Lets the read thread skip the lock when idle
+};
+
+// Active filter bank per channel. A replaced bank is retired and freed by
+// the read thread between two reads, when it can no longer be in use.
+struct Slcanx::FilterTable {
+    std::atomic<const FilterBank*> active[NUM_CHANNELS] = {};
+    std::mutex mutex;
+    std::vector<const FilterBank*> retired;
+    std::atomic<bool> has_retired{false};
+
+    ~FilterTable() {
+        for (auto& a : active) delete a.load();
+        for (const FilterBank* f : retired) delete f;
+    }
+};
+
+// Parse state of the read side (read thread or drive_read()).
+struct Slcanx::Reader {
+    uint8_t buf[4096];
+    LineParser lines;
+    // Frames of one read; the shortest frame line is 6 bytes plus '\r'
+    std::vector<ChannelFrame> batch;
+
+    Reader() { batch.reserve(sizeof(buf) / 7 + 2); }
+};
+
+// Coalescing state of the write side (write thread or drive_write()).
+struct Slcanx::Writer {
+    using clock = std::chrono::steady_clock;
+
+    bool throughput = false;
+    size_t target = 0;                 // Bytes worth one write
+    std::chrono::nanoseconds max_window{0};
+    double rate = 0.0;                 // EWMA of claimed bytes/ns
+    uint64_t last_claimed = 0;
+    clock::time_point last_sample;
+    bool in_window = false;            // drive_write(): waiting until deadline
+    clock::time_point deadline;
+    // Sized for a full ring, so draining never reallocates.
+    std::vector<uint8_t> chunk;
+};
+
+static uint64_t steady_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-static size_t dlc_to_len(uint8_t dlc) {
-    static const size_t map[] = {0,1,2,3,4,5,6,7,8,12,16,20,24,32,48,64};
-    if (dlc < 16) return map[dlc];
-    return 64;
+static uint8_t hex_digit(uint8_t c) {
+    if (c >= '0' && c <= '9') return (uint8_t)(c - '0');
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') return (uint8_t)(c - 'a' + 10);
+    return 0xFF;
 }
 
-// ================= SerialPort Implementation (Windows) =================
+// Counters behind snapshot(). Apart from the TX ring ones, every field has
+// one writing thread and is bumped with a relaxed load/store pair. Each
+// channel's read-thread and write-thread counters sit on their own cache
+// lines.
+struct Slcanx::Metrics {
+    struct Channel {
+        // Read thread
+        alignas(64) std::atomic<uint64_t> rx_frames{0};
+        std::atomic<uint64_t> rx_bytes{0};
+        std::atomic<uint64_t> parse_errors{0};
+        std::atomic<uint64_t> status_lines{0};
+        std::atomic<uint64_t> fw_rx_overflow{0};
+        std::atomic<uint64_t> fw_tx_full{0};
+        std::atomic<uint64_t> fw_usb_overflow{0};
+        std::atomic<uint32_t> status{0}; // Last status line: state, flags, TEC, REC
 
-class Slcanx::SerialPort {
-public:
-    HANDLE hComm;
+        // Write thread
+        alignas(64) std::atomic<uint64_t> tx_frames{0};
+        std::atomic<uint64_t> tx_bytes{0};
+    };
+    Channel channels[NUM_CHANNELS];
 
-    SerialPort(const std::string& port, uint32_t baudrate) {
-        std::string portName = "\\\\.\\" + port;
-        hComm = CreateFileA(portName.c_str(),
-            GENERIC_READ | GENERIC_WRITE,
-            0, NULL, OPEN_EXISTING, 0, NULL);
+    // Read thread
+    alignas(64) std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> read_bytes{0};
+    std::atomic<uint64_t> read_errors{0};
+    std::atomic<uint64_t> line_overflows{0};
+    std::atomic<uint64_t> unknown_lines{0};
+    uint32_t callbacks = 0;
+    Histogram read_chunk_bytes;
+    Histogram callback_ns;
 
-        if (hComm == INVALID_HANDLE_VALUE) {
-            throw std::runtime_error("Failed to open serial port");
-        }
+    // Write thread
+    alignas(64) std::atomic<uint64_t> write_errors{0};
+    std::atomic<uint64_t> tx_ring_peak{0};
+    Histogram write_bytes;
+    Histogram tx_latency_ns;
 
-        DCB dcbSerialParams = { 0 };
-        dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
-        if (!GetCommState(hComm, &dcbSerialParams)) {
-            CloseHandle(hComm);
-            throw std::runtime_error("Failed to get comm state");
-        }
+    // Senders. One record per serial write carries its enqueue time: the
+    // writer arms the probe, the next sender to see it stamps its record.
+    alignas(64) std::atomic<bool> probe_armed{true};
+    std::atomic<uint64_t> probe_end{0}; // Ring position past the stamped record
+    std::atomic<uint64_t> probe_ns{0};
+    std::atomic<uint64_t> tx_rejected{0};
+    std::atomic<uint64_t> tx_blocked{0};
 
-        dcbSerialParams.BaudRate = baudrate;
-        dcbSerialParams.ByteSize = 8;
-        dcbSerialParams.StopBits = ONESTOPBIT;
-        dcbSerialParams.Parity = NOPARITY;
-        dcbSerialParams.fDtrControl = DTR_CONTROL_ENABLE; // Important for CDC
+    static void bump(std::atomic<uint64_t>& c, uint64_t n = 1) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
 
-        if (!SetCommState(hComm, &dcbSerialParams)) {
-            CloseHandle(hComm);
-            throw std::runtime_error("Failed to set comm state");
+    // Claim ring space, counting refusals and waits.
+    TxRing::Claim claim(TxRing& ring, size_t len, bool wait, const std::atomic<bool>& running) {
+        TxRing::Claim c = ring.claim(len);
+        if (c) return c;
+        if (!wait) {
+            tx_rejected.fetch_add(1, std::memory_order_relaxed);
+            return c;
+        }
+        tx_blocked.fetch_add(1, std::memory_order_relaxed);
+        while (!(c = ring.claim(len))) {
+            if (!running) return c;
+            std::this_thread::yield();
         }
+        return c;
+    }
 
-        COMMTIMEOUTS timeouts = { 0 };
-        timeouts.ReadIntervalTimeout = 1;
-        timeouts.ReadTotalTimeoutConstant = 1;
-        timeouts.ReadTotalTimeoutMultiplier = 1;
-        timeouts.WriteTotalTimeoutConstant = 10;
-        timeouts.WriteTotalTimeoutMultiplier = 1;
-        SetCommTimeouts(hComm, &timeouts);
+    // Sender side, before commit(), so the writer sees the stamp with the record.
+    void probe(const TxRing::Claim& c) {
+        if (!probe_armed.load(std::memory_order_relaxed)) return;
+        if (!probe_armed.exchange(false, std::memory_order_relaxed)) return;
+        probe_ns.store(steady_ns(), std::memory_order_relaxed);
+        probe_end.store(c.end, std::memory_order_release);
     }
 
-    ~SerialPort() {
-        if (hComm != INVALID_HANDLE_VALUE) {
-            CloseHandle(hComm);
-        }
+    // Writer side, after a write that covered ring positions up to `drained`.
+    void probe_written(uint64_t drained) {
+        uint64_t end = probe_end.load(std::memory_order_acquire);
+        if (end == 0 || end > drained) return;
+        uint64_t t = probe_ns.load(std::memory_order_relaxed);
+        uint64_t now = steady_ns();
+        tx_latency_ns.record(now > t ? now - t : 0);
+        probe_end.store(0, std::memory_order_relaxed);
+        probe_armed.store(true, std::memory_order_release);
     }
 
-    int read(uint8_t* buf, int max_len) {
-        DWORD bytesRead;
-        if (ReadFile(hComm, buf, max_len, &bytesRead, NULL)) {
-            return bytesRead;
+    // Count the frame lines of one TX ring record.
+    void count_tx(const uint8_t* p, size_t len) {
+        const uint8_t* end = p + len;
+        while (p < end) {
+            const uint8_t* cr = static_cast<const uint8_t*>(std::memchr(p, '\r', (size_t)(end - p)));
+            if (!cr) break;
+            size_t n = (size_t)(cr - p);
+            if (n >= 6 && p[0] >= '0' && p[0] < '0' + NUM_CHANNELS) {
+                size_t dlc_pos = 0;
+                switch (p[1]) {
+                    case 't': case 'r': case 'd': case 'b': dlc_pos = 5; break;
+                    case 'T': case 'R': case 'D': case 'B': dlc_pos = 10; break;
+                }
+                if (dlc_pos && dlc_pos < n) {
+                    Channel& c = channels[p[0] - '0'];
+                    bump(c.tx_frames);
+                    uint8_t dlc = hex_digit(p[dlc_pos]);
+                    if (p[1] != 'r' && p[1] != 'R' && dlc < 16) bump(c.tx_bytes, dlc_to_len(dlc));
+                }
+            }
+            p = cr + 1;
         }
-        return -1;
     }
 
-    bool write(const uint8_t* buf, int len) {
-        DWORD bytesWritten;
-        return WriteFile(hComm, buf, len, &bytesWritten, NULL) != 0;
+    // "Eslffttss" after the channel digit: bus state, last protocol error,
+    // firmware flags, TX and RX error counters. False if malformed.
+    bool status_line(Channel& c, const uint8_t* p, size_t len) {
+        if (len != 9 || p[0] != 'E') return false;
+        uint8_t v[8];
+        for (int i = 0; i < 8; ++i) {
+            v[i] = hex_digit(p[1 + i]);
+            if (v[i] > 15) return false;
+        }
+        uint8_t flags = (uint8_t)(v[2] << 4 | v[3]);
+        bump(c.status_lines);
+        if (flags & 0x01) bump(c.fw_rx_overflow);
+        if (flags & 0x04) bump(c.fw_tx_full);
+        if (flags & 0x08) bump(c.fw_usb_overflow);
+        c.status.store((uint32_t)v[0] << 24 | (uint32_t)flags << 16 | (uint32_t)(v[4] << 4 | v[5]) << 8 |
+                       (uint32_t)(v[6] << 4 | v[7]), std::memory_order_relaxed);
+        return true;
     }
 };
 
-// ================= Slcanx Implementation =================
+Slcanx::Slcanx(const std::string& port, const SlcanxOptions& options)
+    : group_window_us_(options.group_window_us),
+      tx_coalesce_(options.tx_coalesce),
+      usb_packet_bytes_(options.usb_packet_bytes ? options.usb_packet_bytes : 512),
+      rx_clock_(options.rx_clock),
+      external_drive_(options.external_drive) {
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) {
+        bitrate_[ch].store(500000, std::memory_order_relaxed);
+        data_bitrate_[ch].store(0, std::memory_order_relaxed);
+    }
+    tx_ring_ = std::make_unique<TxRing>(options.tx_ring_bytes);
+    tx_counters_ = std::make_unique<TxCounters>();
+    reader_ = std::make_unique<Reader>();
+    writer_ = std::make_unique<Writer>();
+    Writer& w = *writer_;
+    // Coalescing: the writer estimates the arrival rate (EWMA of bytes/ns,
+    // sampled from the ring's claim position, so senders pay nothing) and
+    // waits only as long as it takes to fill the target, capped by the window.
+    // If even the full window would not fill it, the link is effectively idle:
+    // latency-first writes at once, throughput-first still waits the window.
+    w.throughput = tx_coalesce_ == TxCoalesce::ThroughputFirst;
+    w.target = w.throughput ? usb_packet_bytes_ * 8 : usb_packet_bytes_;
+    w.max_window = std::chrono::microseconds(group_window_us_) * (w.throughput ? 4 : 1);
+    w.last_claimed = tx_ring_->claimed();
+    w.last_sample = Writer::clock::now();
+    w.chunk.reserve(tx_ring_->capacity());
+    queries_ = std::make_unique<QueryTable>();
+    filters_ = std::make_unique<FilterTable>();
+    metrics_ = std::make_unique<Metrics>();
+    for (auto& rx : rx_channels_) {
+        rx = std::make_unique<RxChannel>(options.rx_queue_depth, options.rx_overflow);
+    }
+    serial_ = std::make_unique<SerialPort>(port, options.baudrate);
+    if (external_drive_) return;
 
-Slcanx::Slcanx(const std::string& port, uint32_t baudrate, uint32_t group_window_us)
-    : group_window_us_(group_window_us) {
-    serial_ = std::make_unique<SerialPort>(port, baudrate);
-    
     read_thread_ = std::thread(&Slcanx::read_loop, this);
     write_thread_ = std::thread(&Slcanx::write_loop, this);
 }
 
 Slcanx::~Slcanx() {
     running_ = false;
-    write_cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        write_cv_.notify_all();
+        flush_cv_.notify_all();
+    }
+    for (auto& rx : rx_channels_) {
+        std::lock_guard<std::mutex> lock(rx->mutex);
+        rx->cv.notify_all();
+    }
+    serial_->cancel();
     if (read_thread_.joinable()) read_thread_.join();
     if (write_thread_.joinable()) write_thread_.join();
+
+    for (auto& q : queries_->pending) {
+        q.promise.set_exception(std::make_exception_ptr(std::runtime_error("Slcanx closed")));
+    }
+}
+
+void Slcanx::set_capture(CaptureSink* writer, uint8_t channel_base) {
+    capture_base_.store(channel_base, std::memory_order_relaxed);
+    capture_.store(writer, std::memory_order_release);
 }
 
 void Slcanx::set_rx_callback(RxCallback cb) {
     std::lock_guard<std::mutex> lock(rx_mutex_);
     rx_callback_ = cb;
+    has_rx_callback_.store((bool)rx_callback_, std::memory_order_release);
 }
 
-bool Slcanx::send_cmd(uint8_t channel, const std::string& cmd) {
-    std::string line = std::to_string(channel) + cmd + "\r";
+size_t Slcanx::recv(uint8_t channel, span<CanFrame> frames, std::chrono::nanoseconds timeout) {
+    if (channel >= NUM_CHANNELS || frames.empty()) return 0;
+    RxChannel& rx = *rx_channels_[channel];
+
+    size_t n = rx.queue.pop(frames.data(), frames.size());
+    if (n > 0 || timeout <= std::chrono::nanoseconds::zero()) return n;
+
     {
-        std::lock_guard<std::mutex> lock(write_mutex_);
-        const uint8_t* ptr = reinterpret_cast<const uint8_t*>(line.c_str());
-        write_buffer_.insert(write_buffer_.end(), ptr, ptr + line.size());
+        std::unique_lock<std::mutex> lock(rx.mutex);
+        rx.waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto ready = [&] { return !rx.queue.empty() || !running_; };
+        if (timeout == std::chrono::nanoseconds::max()) {
+            rx.cv.wait(lock, ready);
+        } else {
+            rx.cv.wait_for(lock, timeout, ready);
+        }
+        rx.waiting.store(false, std::memory_order_relaxed);
     }
-    write_cv_.notify_one();
-    return true;
+    return rx.queue.pop(frames.data(), frames.size());
 }
 
-bool Slcanx::open_channel(uint8_t channel) {
-    return send_cmd(channel, "O");
+RxQueueStats Slcanx::rx_stats(uint8_t channel) const {
+    RxQueueStats st;
+    if (channel >= NUM_CHANNELS) return st;
+    const RxQueue& q = rx_channels_[channel]->queue;
+    st.received = q.pushed();
+    st.dropped = q.dropped();
+    st.filtered = rx_channels_[channel]->filtered.load(std::memory_order_relaxed);
+    st.depth = q.size();
+    st.capacity = q.capacity();
+    return st;
 }
 
-bool Slcanx::close_channel(uint8_t channel) {
-    return send_cmd(channel, "C");
+void Slcanx::set_filter(uint8_t channel, const FilterBank& bank) {
+    if (channel >= NUM_CHANNELS) return;
+    FilterBank* compiled = new FilterBank(bank);
+    compiled->compile();
+    install_filter(channel, compiled);
 }
 
-bool Slcanx::set_bitrate(uint8_t channel, uint32_t bitrate) {
+void Slcanx::clear_filter(uint8_t channel) {
+    if (channel >= NUM_CHANNELS) return;
+    install_filter(channel, nullptr);
+}
+
+void Slcanx::install_filter(uint8_t channel, const FilterBank* bank) {
+    FilterTable& t = *filters_;
+    const FilterBank* old = t.active[channel].exchange(bank, std::memory_order_acq_rel);
+    if (!old) return;
+    std::lock_guard<std::mutex> lock(t.mutex);
+    t.retired.push_back(old);
+    t.has_retired.store(true, std::memory_order_release);
+}
+
+void Slcanx::reclaim_filters() {
+    // Read thread, between reads: no bank loaded earlier is still in use
+    FilterTable& t = *filters_;
+    if (!t.has_retired.load(std::memory_order_acquire)) return;
+    std::lock_guard<std::mutex> lock(t.mutex);
+    for (const FilterBank* f : t.retired) delete f;
+    t.retired.clear();
+    t.has_retired.store(false, std::memory_order_relaxed);
+}
+
+void Slcanx::wake_writer() {
+    // Pairs with the fence in write_loop: either the writer sees the new
+    // record before parking, or we see writer_waiting_ and notify it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writer_waiting_.load(std::memory_order_relaxed)) {
+        if (external_drive_) {
+            // Only the sender that un-parks the writer wakes the loop
+            if (writer_waiting_.exchange(false, std::memory_order_relaxed)) wake_loop();
+            return;
+        }
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        write_cv_.notify_one();
+    }
+}
+
+void Slcanx::wake_loop() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (wakeup_) wakeup_();
+}
+
+// ================= Commands =================
+
+static std::string bitrate_cmd(uint32_t bitrate) {
     // Simple mapping
     int idx = -1;
     switch(bitrate) {
@@ -170,18 +442,76 @@ bool Slcanx::set_bitrate(uint8_t channel, uint32_t bitrate) {
         case 800000: idx = 7; break;
         case 1000000: idx = 8; break;
     }
-    if (idx >= 0) return send_cmd(channel, "S" + std::to_string(idx));
-    return send_cmd(channel, "y" + std::to_string(bitrate));
+    if (idx >= 0) return "S" + std::to_string(idx);
+    return "y" + std::to_string(bitrate);
 }
 
-bool Slcanx::set_data_bitrate(uint8_t channel, uint32_t bitrate) {
+// Empty if the device has no setting for this data bitrate.
+static std::string data_bitrate_cmd(uint32_t bitrate) {
     if (bitrate % 1000000 == 0) {
         int idx = bitrate / 1000000;
-        if (idx >= 1 && idx <= 15) {
-            return send_cmd(channel, "Y" + std::to_string(idx));
-        }
+        if (idx >= 1 && idx <= 15) return "Y" + std::to_string(idx);
     }
-    return false;
+    return std::string();
+}
+
+static void append_line(std::string& out, uint8_t channel, const std::string& cmd) {
+    out += (char)('0' + channel);
+    out += cmd;
+    out += '\r';
+}
+
+bool Slcanx::submit(const uint8_t* lines, size_t len) {
+    // One claim, so the lines reach the device in a single write
+    if (len > tx_ring_->max_claim()) return false;
+    return enqueue_line(lines, len, true);
+}
+
+bool Slcanx::submit(const std::string& lines) {
+    return submit(reinterpret_cast<const uint8_t*>(lines.data()), lines.size());
+}
+
+bool Slcanx::send_encoded(span<const uint8_t> lines) {
+    const uint8_t* p = lines.data();
+    size_t left = lines.size();
+    const size_t max_claim = tx_ring_->max_claim();
+    while (left > max_claim) {
+        // Split oversized input at the last line end that fits
+        size_t n = max_claim;
+        while (n > 0 && p[n - 1] != '\r') --n;
+        if (n == 0) return false;
+        if (!submit(p, n)) return false;
+        p += n;
+        left -= n;
+    }
+    return left == 0 || submit(p, left);
+}
+
+bool Slcanx::send_cmd(uint8_t channel, const std::string& cmd) {
+    if (channel >= NUM_CHANNELS) return false;
+    std::string line;
+    append_line(line, channel, cmd);
+    return submit(line);
+}
+
+bool Slcanx::open_channel(uint8_t channel) {
+    return send_cmd(channel, "O");
+}
+
+bool Slcanx::close_channel(uint8_t channel) {
+    return send_cmd(channel, "C");
+}
+
+bool Slcanx::set_bitrate(uint8_t channel, uint32_t bitrate) {
+    if (channel < NUM_CHANNELS) bitrate_[channel].store(bitrate, std::memory_order_relaxed);
+    return send_cmd(channel, bitrate_cmd(bitrate));
+}
+
+bool Slcanx::set_data_bitrate(uint8_t channel, uint32_t bitrate) {
+    std::string cmd = data_bitrate_cmd(bitrate);
+    if (cmd.empty()) return false;
+    if (channel < NUM_CHANNELS) data_bitrate_[channel].store(bitrate, std::memory_order_relaxed);
+    return send_cmd(channel, cmd);
 }
 
 bool Slcanx::set_sample_point(uint8_t channel, double nominal_percent, double data_percent) {
@@ -194,150 +524,635 @@ bool Slcanx::set_sample_point(uint8_t channel, double nominal_percent, double da
     return true;
 }
 
-bool Slcanx::send(uint8_t channel, const CanFrame& frame) {
-    std::stringstream ss;
-    ss << (int)channel;
-    
-    char cmd;
-    if (frame.fd) {
-        if (frame.brs) cmd = frame.ext ? 'B' : 'b';
-        else cmd = frame.ext ? 'D' : 'd';
+std::future<std::string> Slcanx::add_query(uint8_t channel, char cmd, std::chrono::milliseconds timeout) {
+    QueryTable& t = *queries_;
+    std::lock_guard<std::mutex> lock(t.mutex);
+    t.pending.push_back({channel, cmd, std::chrono::steady_clock::now() + timeout, {}});
+    t.count.fetch_add(1, std::memory_order_relaxed);
+    return t.pending.back().promise.get_future();
+}
+
+std::future<std::string> Slcanx::query(uint8_t channel, char cmd, std::chrono::milliseconds timeout) {
+    if (channel >= NUM_CHANNELS) throw std::runtime_error("Invalid channel");
+    // Registered before sending, so a fast reply always finds its query
+    std::future<std::string> f = add_query(channel, cmd, timeout);
+    // Let the read thread pick up the new deadline
+    if (external_drive_) {
+        wake_loop();
     } else {
-        if (frame.rtr) cmd = frame.ext ? 'R' : 'r';
-        else cmd = frame.ext ? 'T' : 't';
+        serial_->cancel();
     }
-    ss << cmd;
-
-    ss << std::hex << std::uppercase;
-    if (frame.ext) ss << std::setw(8) << std::setfill('0') << frame.id;
-    else ss << std::setw(3) << std::setfill('0') << frame.id;
+    send_cmd(channel, std::string(1, cmd));
+    return f;
+}
 
-    ss << (int)len_to_dlc(frame.data.size());
+std::vector<ChannelStatus> Slcanx::configure(span<const ChannelConfig> channels,
+                                             std::chrono::milliseconds timeout) {
+    std::string lines;
+    std::vector<std::future<std::string>> nominal, data;
+    std::vector<ChannelStatus> result(channels.size());
 
-    if (!frame.rtr) {
-        for (uint8_t b : frame.data) {
-            ss << std::setw(2) << std::setfill('0') << (int)b;
+    for (size_t i = 0; i < channels.size(); ++i) {
+        const ChannelConfig& c = channels[i];
+        if (c.channel >= NUM_CHANNELS) throw std::runtime_error("Invalid channel");
+        result[i].channel = c.channel;
+        append_line(lines, c.channel, "C");
+        if (c.bitrate) {
+            bitrate_[c.channel].store(c.bitrate, std::memory_order_relaxed);
+            append_line(lines, c.channel, bitrate_cmd(c.bitrate));
+        }
+        if (c.data_bitrate) {
+            std::string cmd = data_bitrate_cmd(c.data_bitrate);
+            if (cmd.empty()) throw std::runtime_error("Unsupported data bitrate");
+            data_bitrate_[c.channel].store(c.data_bitrate, std::memory_order_relaxed);
+            append_line(lines, c.channel, cmd);
+        }
+        if (c.sample_point > 0) {
+            append_line(lines, c.channel, "p" + std::to_string((int)(c.sample_point * 10)));
+        }
+        if (c.data_sample_point > 0) {
+            append_line(lines, c.channel, "P" + std::to_string((int)(c.data_sample_point * 10)));
+        }
+        append_line(lines, c.channel, c.listen_only ? "L" : "L0");
+        if (c.open) append_line(lines, c.channel, "O");
+    }
+    // Read-backs go in the same write, after every setting
+    for (const ChannelConfig& c : channels) {
+        append_line(lines, c.channel, "q");
+        nominal.push_back(add_query(c.channel, 'q', timeout));
+        if (c.data_bitrate) {
+            append_line(lines, c.channel, "Q");
+            data.push_back(add_query(c.channel, 'Q', timeout));
         }
     }
-    ss << "\r";
+    if (external_drive_) {
+        wake_loop();
+    } else {
+        serial_->cancel();
+    }
+    if (!submit(lines)) throw std::runtime_error("Failed to queue configuration");
 
-    std::string line = ss.str();
-    {
-        std::lock_guard<std::mutex> lock(write_mutex_);
-        const uint8_t* ptr = reinterpret_cast<const uint8_t*>(line.c_str());
-        write_buffer_.insert(write_buffer_.end(), ptr, ptr + line.size());
+    for (size_t i = 0, d = 0; i < channels.size(); ++i) {
+        result[i].nominal = nominal[i].get();
+        if (channels[i].data_bitrate) result[i].data = data[d++].get();
     }
-    write_cv_.notify_one();
+    return result;
+}
+
+bool Slcanx::handle_reply(const uint8_t* line, size_t len) {
+    // "<letter>payload", optionally prefixed with the channel digit
+    int channel = -1;
+    if (len >= 2 && line[0] >= '0' && line[0] <= '3') {
+        channel = line[0] - '0';
+        ++line;
+        --len;
+    }
+    if (len == 0) return false;
+
+    QueryTable& t = *queries_;
+    std::lock_guard<std::mutex> lock(t.mutex);
+    for (auto it = t.pending.begin(); it != t.pending.end(); ++it) {
+        if (it->cmd != (char)line[0]) continue;
+        if (channel >= 0 && it->channel != channel) continue;
+        it->promise.set_value(std::string(reinterpret_cast<const char*>(line + 1), len - 1));
+        t.pending.erase(it);
+        t.count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+int Slcanx::expire_queries() {
+    QueryTable& t = *queries_;
+    if (t.count.load(std::memory_order_relaxed) == 0) return -1;
+
+    auto now = std::chrono::steady_clock::now();
+    auto next = std::chrono::steady_clock::time_point::max();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    for (auto it = t.pending.begin(); it != t.pending.end();) {
+        if (it->deadline <= now) {
+            it->promise.set_exception(std::make_exception_ptr(std::runtime_error("Query timed out")));
+            it = t.pending.erase(it);
+            t.count.fetch_sub(1, std::memory_order_relaxed);
+        } else {
+            if (it->deadline < next) next = it->deadline;
+            ++it;
+        }
+    }
+    if (t.pending.empty()) return -1;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count();
+    return (int)ms + 1;
+}
+
+bool Slcanx::enqueue_frame(uint8_t channel, const CanFrame& frame, bool wait) {
+    if (channel >= NUM_CHANNELS) return false;
+    // Reserve the exact line length and encode straight into the ring
+    size_t n = encoded_size(frame);
+    TxRing::Claim c = metrics_->claim(*tx_ring_, n, wait, running_);
+    if (!c) return false;
+    encode_frame(channel, frame, c.data);
+    metrics_->probe(c);
+    tx_ring_->commit(c);
+    wake_writer();
+    return true;
+}
+
+bool Slcanx::send(uint8_t channel, const CanFrame& frame) {
+    return enqueue_frame(channel, frame, true);
+}
+
+bool Slcanx::try_send(uint8_t channel, const CanFrame& frame) {
+    return enqueue_frame(channel, frame, false);
+}
+
+bool Slcanx::enqueue_line(const uint8_t* line, size_t len, bool wait) {
+    TxRing::Claim c = metrics_->claim(*tx_ring_, len, wait, running_);
+    if (!c) return false;
+    std::memcpy(c.data, line, len);
+    metrics_->probe(c);
+    tx_ring_->commit(c);
+    wake_writer();
     return true;
 }
 
+bool Slcanx::enqueue_prepared(const PreparedFrame& frame, bool wait) {
+    TxRing::Claim c = metrics_->claim(*tx_ring_, frame.size(), wait, running_);
+    if (!c) return false;
+    frame.copy_to(c.data);
+    metrics_->probe(c);
+    tx_ring_->commit(c);
+    wake_writer();
+    return true;
+}
+
+bool Slcanx::send(const PreparedFrame& frame) {
+    return enqueue_prepared(frame, true);
+}
+
+bool Slcanx::try_send(const PreparedFrame& frame) {
+    return enqueue_prepared(frame, false);
+}
+
+template <typename At>
+size_t Slcanx::enqueue_batch(size_t count, At at, bool wait) {
+    // at(i) -> std::pair<uint8_t channel, const CanFrame&>
+    // The first frame for a channel the device lacks ends the batch
+    for (size_t i = 0; i < count; ++i) {
+        if (at(i).first >= NUM_CHANNELS) {
+            count = i;
+            break;
+        }
+    }
+    const size_t max_claim = tx_ring_->max_claim();
+    size_t done = 0;
+    while (done < count) {
+        // Take as many frames as one claim can hold
+        size_t end = done;
+        size_t bytes = 0;
+        while (end < count) {
+            size_t n = encoded_size(at(end).second);
+            if (bytes + n > max_claim) break;
+            bytes += n;
+            ++end;
+        }
+
+        TxRing::Claim c;
+        bool blocked = false;
+        while (!(c = tx_ring_->claim(bytes))) {
+            if (!running_) return done;
+            if (!wait) {
+                // Shrink to what fits; give up once even one frame does not
+                if (end - done == 1) {
+                    metrics_->tx_rejected.fetch_add(1, std::memory_order_relaxed);
+                    return done;
+                }
+                end = done + (end - done) / 2;
+                bytes = 0;
+                for (size_t i = done; i < end; ++i) bytes += encoded_size(at(i).second);
+                continue;
+            }
+            if (!blocked) {
+                blocked = true;
+                metrics_->tx_blocked.fetch_add(1, std::memory_order_relaxed);
+            }
+            wake_writer(); // Earlier claims of this batch must drain first
+            std::this_thread::yield();
+        }
+
+        uint8_t* p = c.data;
+        for (size_t i = done; i < end; ++i) {
+            auto item = at(i);
+            p += encode_frame(item.first, item.second, p);
+        }
+        metrics_->probe(c);
+        tx_ring_->commit(c);
+        done = end;
+    }
+    if (done > 0) wake_writer();
+    return done;
+}
+
+size_t Slcanx::send_batch(uint8_t channel, span<const CanFrame> frames) {
+    return enqueue_batch(frames.size(), [&](size_t i) {
+        return std::pair<uint8_t, const CanFrame&>(channel, frames[i]);
+    }, true);
+}
+
+size_t Slcanx::send_batch(span<const ChannelFrame> frames) {
+    return enqueue_batch(frames.size(), [&](size_t i) {
+        return std::pair<uint8_t, const CanFrame&>(frames[i].channel, frames[i].frame);
+    }, true);
+}
+
+size_t Slcanx::try_send_batch(uint8_t channel, span<const CanFrame> frames) {
+    return enqueue_batch(frames.size(), [&](size_t i) {
+        return std::pair<uint8_t, const CanFrame&>(channel, frames[i]);
+    }, false);
+}
+
+size_t Slcanx::try_send_batch(span<const ChannelFrame> frames) {
+    return enqueue_batch(frames.size(), [&](size_t i) {
+        return std::pair<uint8_t, const CanFrame&>(frames[i].channel, frames[i].frame);
+    }, false);
+}
+
+void Slcanx::flush() {
+    uint64_t target = tx_ring_->claimed();
+    if (tx_written_.load(std::memory_order_acquire) >= target) return;
+
+    std::unique_lock<std::mutex> lock(write_mutex_);
+    flush_requested_.store(true, std::memory_order_relaxed);
+    flush_waiters_.fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the fence after tx_written_ in write_loop
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (external_drive_) {
+        if (wakeup_) wakeup_();
+    } else {
+        write_cv_.notify_one();
+    }
+    flush_cv_.wait(lock, [&] {
+        return tx_written_.load(std::memory_order_acquire) >= target || !running_;
+    });
+    flush_waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+TxStats Slcanx::tx_stats() const {
+    TxStats st;
+    st.writes = tx_counters_->writes.load(std::memory_order_relaxed);
+    st.bytes = tx_counters_->bytes.load(std::memory_order_relaxed);
+    st.flush_idle = tx_counters_->flush_idle.load(std::memory_order_relaxed);
+    st.flush_full = tx_counters_->flush_full.load(std::memory_order_relaxed);
+    st.flush_window = tx_counters_->flush_window.load(std::memory_order_relaxed);
+    st.flush_explicit = tx_counters_->flush_explicit.load(std::memory_order_relaxed);
+    return st;
+}
+
+MetricsSnapshot Slcanx::snapshot() const {
+    const Metrics& m = *metrics_;
+    MetricsSnapshot s;
+    s.timestamp_ns = steady_ns();
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) {
+        const Metrics::Channel& c = m.channels[ch];
+        ChannelMetrics& out = s.channels[ch];
+        RxQueueStats rx = rx_stats(ch);
+        out.rx_frames = c.rx_frames.load(std::memory_order_relaxed);
+        out.rx_bytes = c.rx_bytes.load(std::memory_order_relaxed);
+        out.rx_filtered = rx.filtered;
+        out.rx_dropped = rx.dropped;
+        out.rx_queue_depth = rx.depth;
+        out.tx_frames = c.tx_frames.load(std::memory_order_relaxed);
+        out.tx_bytes = c.tx_bytes.load(std::memory_order_relaxed);
+        out.parse_errors = c.parse_errors.load(std::memory_order_relaxed);
+        out.status_lines = c.status_lines.load(std::memory_order_relaxed);
+        out.fw_rx_overflow = c.fw_rx_overflow.load(std::memory_order_relaxed);
+        out.fw_tx_full = c.fw_tx_full.load(std::memory_order_relaxed);
+        out.fw_usb_overflow = c.fw_usb_overflow.load(std::memory_order_relaxed);
+        uint32_t status = c.status.load(std::memory_order_relaxed);
+        out.bus_state = (uint8_t)(status >> 24);
+        out.fw_flags = (uint8_t)(status >> 16);
+        out.tx_error_count = (uint8_t)(status >> 8);
+        out.rx_error_count = (uint8_t)status;
+    }
+
+    s.reads = m.reads.load(std::memory_order_relaxed);
+    s.read_bytes = m.read_bytes.load(std::memory_order_relaxed);
+    s.read_errors = m.read_errors.load(std::memory_order_relaxed);
+    s.line_overflows = m.line_overflows.load(std::memory_order_relaxed);
+    s.unknown_lines = m.unknown_lines.load(std::memory_order_relaxed);
+
+    s.tx = tx_stats();
+    s.tx_rejected = m.tx_rejected.load(std::memory_order_relaxed);
+    s.tx_blocked = m.tx_blocked.load(std::memory_order_relaxed);
+    s.write_errors = m.write_errors.load(std::memory_order_relaxed);
+    s.tx_ring_used = tx_ring_->used();
+    s.tx_ring_peak = (size_t)m.tx_ring_peak.load(std::memory_order_relaxed);
+    s.tx_ring_capacity = tx_ring_->capacity();
+
+    s.tx_latency_ns = m.tx_latency_ns.snapshot();
+    s.write_bytes = m.write_bytes.snapshot();
+    s.read_chunk_bytes = m.read_chunk_bytes.snapshot();
+    s.callback_ns = m.callback_ns.snapshot();
+    return s;
+}
+
 void Slcanx::write_loop() {
     while (running_) {
-        std::vector<uint8_t> chunk;
-        {
+        if (!tx_ring_->readable() && !flush_requested_.load(std::memory_order_relaxed)) {
             std::unique_lock<std::mutex> lock(write_mutex_);
-            write_cv_.wait(lock, [this] { return !write_buffer_.empty() || !running_; });
-            
-            if (!running_) break;
-
-            // Grouping logic:
-            // If we have data, wait a bit to see if more comes, unless buffer is already large
-            if (write_buffer_.size() < 1024 && group_window_us_ > 0) {
-                lock.unlock();
-                std::this_thread::sleep_for(std::chrono::microseconds(group_window_us_));
-                lock.lock();
-            }
+            writer_waiting_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            write_cv_.wait(lock, [this] {
+                return tx_ring_->readable() || flush_requested_.load(std::memory_order_relaxed) || !running_;
+            });
+            writer_waiting_.store(false, std::memory_order_relaxed);
+        }
+        if (!running_) break;
+
+        std::atomic<uint64_t>* reason;
+        std::chrono::nanoseconds window = tx_window(reason);
+        if (!reason) {
+            std::unique_lock<std::mutex> lock(write_mutex_);
+            write_cv_.wait_for(lock, window, [this] {
+                return flush_requested_.load(std::memory_order_relaxed) || !running_;
+            });
+            reason = tx_window_reason();
+        }
+        tx_write(reason);
+    }
+}
 
-            // Swap buffer
-            chunk.swap(write_buffer_);
+int64_t Slcanx::drive_write() {
+    Writer& w = *writer_;
+    if (!running_) return -1;
+    writer_waiting_.store(false, std::memory_order_relaxed);
+
+    if (w.in_window) {
+        Writer::clock::time_point now = Writer::clock::now();
+        if (now < w.deadline && !flush_requested_.load(std::memory_order_relaxed)) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(w.deadline - now).count();
+        }
+        w.in_window = false;
+        tx_write(tx_window_reason());
+    } else if (tx_ring_->readable() || flush_requested_.load(std::memory_order_relaxed)) {
+        std::atomic<uint64_t>* reason;
+        std::chrono::nanoseconds window = tx_window(reason);
+        if (!reason) {
+            w.in_window = true;
+            w.deadline = Writer::clock::now() + window;
+            return window.count();
         }
+        tx_write(reason);
+    }
+
+    // Park with the same handshake as write_loop: either we see the next
+    // record here, or its sender sees writer_waiting_ and fires the wakeup.
+    writer_waiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (tx_ring_->readable() || flush_requested_.load(std::memory_order_relaxed)) {
+        writer_waiting_.store(false, std::memory_order_relaxed);
+        return 0;
+    }
+    return -1;
+}
 
-        if (!chunk.empty()) {
-            serial_->write(chunk.data(), chunk.size());
+std::chrono::nanoseconds Slcanx::tx_window(std::atomic<uint64_t>*& reason) {
+    constexpr double kAlpha = 0.25;
+    Writer& w = *writer_;
+    TxCounters& counters = *tx_counters_;
+
+    Writer::clock::time_point now = Writer::clock::now();
+    uint64_t claimed = tx_ring_->claimed();
+    double elapsed = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(now - w.last_sample).count();
+    if (elapsed > 0) {
+        w.rate += kAlpha * ((double)(claimed - w.last_claimed) / elapsed - w.rate);
+    }
+    w.last_claimed = claimed;
+    w.last_sample = now;
+
+    // reason stays null when the caller has to wait out the window first
+    reason = &counters.flush_idle;
+    size_t pending = tx_ring_->used();
+    if (flush_requested_.load(std::memory_order_relaxed)) {
+        reason = &counters.flush_explicit;
+    } else if (pending >= w.target) {
+        reason = &counters.flush_full;
+    } else if (w.max_window.count() > 0) {
+        std::chrono::nanoseconds window = w.max_window;
+        if (w.rate > 0) {
+            double fill_ns = (double)(w.target - pending) / w.rate;
+            if (fill_ns < (double)w.max_window.count()) {
+                window = std::chrono::nanoseconds((int64_t)fill_ns);
+            }
+        }
+        if (window < w.max_window || w.throughput) {
+            reason = nullptr;
+            return window;
         }
     }
+    return std::chrono::nanoseconds::zero();
 }
 
-void Slcanx::read_loop() {
-    uint8_t buf[1024];
-    std::string line_buf;
+std::atomic<uint64_t>* Slcanx::tx_window_reason() {
+    TxCounters& counters = *tx_counters_;
+    if (flush_requested_.load(std::memory_order_relaxed)) return &counters.flush_explicit;
+    return tx_ring_->used() >= writer_->target ? &counters.flush_full : &counters.flush_window;
+}
+
+void Slcanx::tx_write(std::atomic<uint64_t>* reason) {
+    std::vector<uint8_t>& chunk = writer_->chunk;
+    TxCounters& counters = *tx_counters_;
+    Metrics& metrics = *metrics_;
+    flush_requested_.store(false, std::memory_order_relaxed);
 
+    size_t used = tx_ring_->used();
+    if (used > metrics.tx_ring_peak.load(std::memory_order_relaxed)) {
+        metrics.tx_ring_peak.store(used, std::memory_order_relaxed);
+    }
+    tx_ring_->drain([&chunk, &metrics](const uint8_t* data, size_t len) {
+        chunk.insert(chunk.end(), data, data + len);
+        metrics.count_tx(data, len);
+    });
+    uint64_t drained = tx_ring_->drained();
+
+    if (!chunk.empty()) {
+        if (!serial_->write(chunk.data(), chunk.size())) Metrics::bump(metrics.write_errors);
+        TxCounters::bump(*reason);
+        TxCounters::bump(counters.writes);
+        TxCounters::bump(counters.bytes, chunk.size());
+        metrics.write_bytes.record(chunk.size());
+        metrics.probe_written(drained);
+        chunk.clear();
+    }
+
+    tx_written_.store(drained, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (flush_waiters_.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        flush_cv_.notify_all();
+    }
+}
+
+void Slcanx::read_loop() {
     while (running_) {
-        int n = serial_->read(buf, sizeof(buf));
-        if (n > 0) {
-            for (int i = 0; i < n; ++i) {
-                if (buf[i] == '\r') {
-                    parse_line(line_buf);
-                    line_buf.clear();
-                } else {
-                    line_buf += (char)buf[i];
-                }
-            }
-        } else {
+        reclaim_filters();
+        if (read_step(expire_queries()) < 0) {
+            // Port error: back off instead of spinning. Idle reads block
+            // inside the backend, so there is no sleep on the data path.
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
     }
 }
 
-void Slcanx::parse_line(const std::string& line) {
-    if (line.empty()) return;
+int Slcanx::drive_read(bool readable) {
+    reclaim_filters();
+    // A short read means the tty is drained; the cap keeps one busy device
+    // from starving the others on the same loop.
+    for (int i = 0; readable && i < 16; ++i) {
+        if (read_step(0) < (int)sizeof(reader_->buf)) break;
+    }
+    return expire_queries();
+}
+
+int Slcanx::read_step(int timeout_ms) {
+    Reader& r = *reader_;
+    Metrics& metrics = *metrics_;
+    int n = serial_->read(r.buf, sizeof(r.buf), timeout_ms);
+    if (n > 0) {
+        uint64_t now = SerialPort::now_ns(rx_clock_);
+        Metrics::bump(metrics.reads);
+        Metrics::bump(metrics.read_bytes, (uint64_t)n);
+        metrics.read_chunk_bytes.record((uint64_t)n);
+        r.batch.clear();
+        r.lines.feed(r.buf, (size_t)n, [this, &r](const uint8_t* line, size_t len) {
+            parse_line(line, len, r.batch);
+        });
+        metrics.line_overflows.store(r.lines.overflows(), std::memory_order_relaxed);
+        stamp_batch(r.batch, now);
+        for (const ChannelFrame& item : r.batch) {
+            deliver(item.channel, item.frame);
+        }
+    } else if (n < 0) {
+        // Only port errors and hang-ups; an idle poll or timeout returns 0
+        Metrics::bump(metrics.read_errors);
+    }
+    return n;
+}
+
+int Slcanx::io_handle() const {
+    return serial_->fd();
+}
+
+void Slcanx::set_wakeup(std::function<void()> fn) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    wakeup_ = std::move(fn);
+}
+
+void Slcanx::parse_line(const uint8_t* line, size_t len, std::vector<ChannelFrame>& batch) {
+    FrameHeader h;
+    if (!decode_header(line, len, h)) {
+        other_line(line, len);
+        return;
+    }
+
+    // Filter on the ID before touching the payload digits
+    const FilterBank* bank = filters_->active[h.channel].load(std::memory_order_acquire);
+    if (bank && !bank->accepts(h)) {
+        std::atomic<uint64_t>& n = rx_channels_[h.channel]->filtered;
+        n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    batch.emplace_back();
+    ChannelFrame& item = batch.back();
+    item.channel = h.channel;
+    if (!decode_payload(line, h, item.frame)) {
+        batch.pop_back();
+        Metrics::bump(metrics_->channels[h.channel].parse_errors);
+    }
+}
 
+void Slcanx::other_line(const uint8_t* line, size_t len) {
+    // Same channel rule as decode_header(): no digit means channel 0
     uint8_t channel = 0;
-    int idx = 0;
-    if (line[0] >= '0' && line[0] <= '3') {
-        channel = line[0] - '0';
-        idx++;
-    }
-
-    if (idx >= line.size()) return;
-    char cmd = line[idx];
-
-    if (cmd == 't' || cmd == 'T' || cmd == 'r' || cmd == 'R' || 
-        cmd == 'd' || cmd == 'D' || cmd == 'b' || cmd == 'B') {
-        
-        bool is_ext = (cmd == 'T' || cmd == 'R' || cmd == 'D' || cmd == 'B');
-        bool is_fd = (cmd == 'd' || cmd == 'D' || cmd == 'b' || cmd == 'B');
-        bool is_brs = (cmd == 'b' || cmd == 'B');
-        bool is_rtr = (cmd == 'r' || cmd == 'R');
-
-        int id_len = is_ext ? 8 : 3;
-        if (line.size() < idx + 1 + id_len + 1) return;
-
-        try {
-            std::string id_str = line.substr(idx + 1, id_len);
-            uint32_t id = std::stoul(id_str, nullptr, 16);
-
-            char dlc_char = line[idx + 1 + id_len];
-            uint8_t dlc_val = std::stoul(std::string(1, dlc_char), nullptr, 16);
-            size_t len = dlc_to_len(dlc_val);
-
-            std::vector<uint8_t> data;
-            if (!is_rtr) {
-                std::string data_str = line.substr(idx + 1 + id_len + 1);
-                for (size_t i = 0; i < data_str.size(); i += 2) {
-                    if (i + 1 < data_str.size()) {
-                        data.push_back((uint8_t)std::stoul(data_str.substr(i, 2), nullptr, 16));
-                    }
-                }
-            }
+    size_t i = 0;
+    if (len > 0 && line[0] >= '0' && line[0] < '0' + NUM_CHANNELS) {
+        channel = (uint8_t)(line[0] - '0');
+        i = 1;
+    }
+    Metrics::Channel& c = metrics_->channels[channel];
+    if (i < len) {
+        switch (line[i]) {
+            case 't': case 'T': case 'r': case 'R':
+            case 'd': case 'D': case 'b': case 'B':
+                Metrics::bump(c.parse_errors);
+                return;
+            case 'E':
+                if (metrics_->status_line(c, line + i, len - i)) return;
+                break;
+        }
+    }
+    if (queries_->count.load(std::memory_order_relaxed) > 0 && handle_reply(line, len)) return;
+    Metrics::bump(metrics_->unknown_lines);
+}
 
-            CanFrame frame;
-            frame.id = id;
-            frame.data = data;
-            frame.ext = is_ext;
-            frame.rtr = is_rtr;
-            frame.fd = is_fd;
-            frame.brs = is_brs;
+void Slcanx::stamp_batch(std::vector<ChannelFrame>& batch, uint64_t now_ns) {
+    // The last frame of each channel in this read arrived by `now_ns`; each
+    // earlier one finished at least one bus frame time before its successor.
+    uint64_t t[NUM_CHANNELS];
+    uint32_t nominal[NUM_CHANNELS], data[NUM_CHANNELS];
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) {
+        t[ch] = now_ns;
+        nominal[ch] = bitrate_[ch].load(std::memory_order_relaxed);
+        data[ch] = data_bitrate_[ch].load(std::memory_order_relaxed);
+        if (data[ch] == 0) data[ch] = nominal[ch];
+    }
+    for (size_t i = batch.size(); i-- > 0;) {
+        ChannelFrame& item = batch[i];
+        uint8_t ch = item.channel;
+        item.frame.timestamp_ns = t[ch];
+        uint64_t d = frame_duration_ns(item.frame, nominal[ch], data[ch]);
+        t[ch] = t[ch] > d ? t[ch] - d : 0;
+    }
+    // Never step back behind what the previous read already reported
+    for (ChannelFrame& item : batch) {
+        uint64_t& last = last_rx_ts_[item.channel];
+        if (item.frame.timestamp_ns < last) item.frame.timestamp_ns = last;
+        last = item.frame.timestamp_ns;
+    }
+}
+
+void Slcanx::deliver(uint8_t channel, const CanFrame& frame) {
+    if (channel >= NUM_CHANNELS) return;
+    Metrics& m = *metrics_;
+    Metrics::bump(m.channels[channel].rx_frames);
+    if (!frame.rtr) Metrics::bump(m.channels[channel].rx_bytes, frame.len);
+    if (CaptureSink* cap = capture_.load(std::memory_order_acquire)) {
+        cap->write((uint8_t)(capture_base_.load(std::memory_order_relaxed) + channel), frame);
+    }
 
-            std::lock_guard<std::mutex> lock(rx_mutex_);
-            if (rx_callback_) {
+    if (has_rx_callback_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(rx_mutex_);
+        if (rx_callback_) {
+            // Timing every call would cost two clock reads per frame
+            if (++m.callbacks % 16 != 0) {
+                rx_callback_(channel, frame);
+            } else {
+                uint64_t t0 = steady_ns();
                 rx_callback_(channel, frame);
+                m.callback_ns.record(steady_ns() - t0);
             }
-
-        } catch (...) {
-            // Parse error
+            return;
         }
     }
+
+    RxChannel& rx = *rx_channels_[channel];
+    rx.queue.push(frame);
+    // Same handshake as wake_writer(): only notify a parked recv()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (rx.waiting.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(rx.mutex);
+        rx.cv.notify_one();
+    }
 }
 
 } // namespace slcanx
@@ -0,0 +1,699 @@
+#include "emulator.hpp"
+#include "slcanx_codec.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdexcept>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace slcanx {
+namespace emu {
+
+static uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static const uint32_t NOMINAL_RATES[] = {10000, 20000, 50000, 100000, 125000, 250000, 500000, 800000, 1000000};
+static const uint32_t DATA_RATES[] = {0,        1000000,  2000000,  3000000,  4000000,  5000000,
+                                      6000000,  7000000,  8000000,  9000000,  10000000, 11000000,
+                                      12000000, 13000000, 14000000, 16000000};
+
+// Bits lost to one error frame: 6 flag + up to 6 echoed + 8 delimiter
+static const uint32_t ERROR_FRAME_BITS = 20;
+
+struct Emulator::Channel {
+    ChannelLoad load;
+    bool open = false;
+    bool listen_only = false;
+    uint32_t bitrate = 500000;
+    uint32_t data_bitrate = 2000000;
+    uint32_t sample_point = 800;      // Permille
+    uint32_t data_sample_point = 750;
+
+    // Bus
+    uint64_t bus_free = 0;  // The bus is idle from here on
+    uint64_t busy_ns = 0;
+    double next_due = 0;    // Next generated frame wants the bus at this time
+    uint32_t seq = 0;
+    std::deque<uint64_t> tx_fifo; // Completion times of queued host frames
+
+    // Error state
+    uint16_t tec = 0;
+    uint16_t rec = 0;
+    uint8_t state = 0;
+    uint8_t reported_state = 0;
+    uint8_t last_error = 0;
+    uint8_t flags = 0;         // Firmware flags since the last report
+    uint8_t reply_flags = 0;   // Firmware flags since the last F reply
+    std::string codes;         // Legacy e codes since the last report
+    bool dirty = false;
+    uint64_t last_report = 0;
+    uint32_t pending_errors = 0;
+    BusError pending_kind = BusError::Stuff;
+    uint32_t usb_drops = 0;
+};
+
+// ================= Wire timing =================
+
+namespace {
+
+// Unstuffed bit stream, MSB first.
+struct Bits {
+    uint8_t v[1 + 11 + 2 + 18 + 9 + 8 * CanFrame::MAX_LEN + 16];
+    uint32_t n = 0;
+
+    void put(uint32_t value, int count) {
+        for (int i = count - 1; i >= 0; --i) v[n++] = (uint8_t)((value >> i) & 1);
+    }
+};
+
+// Dynamic stuff bits over bits[0..end): one after every five equal bits,
+// counting the stuff bits themselves. `split` collects those inserted before
+// bit index `at`; a stuff bit after the very last bit counts unless
+// `trailing` is false.
+uint32_t stuff_bits(const Bits& b, uint32_t end, uint32_t at, uint32_t& split, bool trailing) {
+    uint32_t stuff = 0;
+    int last = -1;
+    int run = 0;
+    split = 0;
+    for (uint32_t i = 0; i < end; ++i) {
+        if (i == at) split = stuff;
+        if (b.v[i] == last) {
+            ++run;
+        } else {
+            last = b.v[i];
+            run = 1;
+        }
+        if (run == 5) {
+            if (i + 1 == end && !trailing) break;
+            ++stuff;
+            last ^= 1;
+            run = 1;
+        }
+    }
+    if (at >= end) split = stuff;
+    return stuff;
+}
+
+uint16_t crc15(const Bits& b) {
+    uint16_t crc = 0;
+    for (uint32_t i = 0; i < b.n; ++i) {
+        bool next = b.v[i] ^ ((crc >> 14) & 1);
+        crc = (uint16_t)((crc << 1) & 0x7FFF);
+        if (next) crc ^= 0x4599;
+    }
+    return crc;
+}
+
+} // namespace
+
+void Emulator::wire_bits(const CanFrame& frame, uint32_t& nominal_bits, uint32_t& data_bits) {
+    // CRC delimiter, ACK slot + delimiter, EOF, interframe space
+    const uint32_t TAIL = 1 + 2 + 7 + 3;
+    uint8_t dlc = frame.fd ? len_to_dlc(frame.len) : (uint8_t)std::min<size_t>(frame.len, 8);
+    size_t payload = frame.rtr ? 0 : (frame.fd ? dlc_to_len(dlc) : dlc);
+
+    Bits b;
+    b.put(0, 1); // SOF
+    if (frame.ext) {
+        b.put((frame.id >> 18) & 0x7FF, 11);
+        b.put(1, 1); // SRR
+        b.put(1, 1); // IDE
+        b.put(frame.id & 0x3FFFF, 18);
+    } else {
+        b.put(frame.id & 0x7FF, 11);
+    }
+
+    if (!frame.fd) {
+        b.put(frame.rtr ? 1 : 0, 1);
+        b.put(0, 2); // IDE r0, or r1 r0 for extended frames
+        b.put(dlc, 4);
+        for (size_t i = 0; i < payload; ++i) b.put(frame.data[i], 8);
+        b.put(crc15(b), 15);
+        uint32_t split;
+        nominal_bits = b.n + stuff_bits(b, b.n, b.n, split, true) + TAIL;
+        data_bits = 0;
+        return;
+    }
+
+    b.put(0, frame.ext ? 1 : 2); // RRS, plus IDE for base frames
+    b.put(1, 1);                 // FDF
+    b.put(0, 1);                 // res
+    b.put(frame.brs ? 1 : 0, 1);
+    uint32_t switch_at = b.n; // Data phase starts after BRS
+    b.put(0, 1);              // ESI
+    b.put(dlc, 4);
+    for (size_t i = 0; i < payload; ++i) b.put(frame.data[i], 8);
+
+    // The CRC field has fixed stuff bits only, so its contents do not matter:
+    // stuff count (4) and CRC, one fixed stuff bit ahead of every 4 bits.
+    uint32_t crc_bits = 4 + (payload <= 16 ? 17 : 21);
+    uint32_t crc_field = crc_bits + (crc_bits + 3) / 4;
+
+    uint32_t arb_stuff;
+    uint32_t stuff = stuff_bits(b, b.n, switch_at, arb_stuff, false);
+    uint32_t arbitration = switch_at + arb_stuff;
+    uint32_t data = b.n - switch_at + (stuff - arb_stuff) + crc_field;
+    if (frame.brs) {
+        nominal_bits = arbitration + TAIL;
+        data_bits = data;
+    } else {
+        nominal_bits = arbitration + data + TAIL;
+        data_bits = 0;
+    }
+}
+
+uint64_t Emulator::wire_ns(const CanFrame& frame, uint32_t bitrate, uint32_t data_bitrate) {
+    if (bitrate == 0) return 0;
+    uint32_t nominal, data;
+    wire_bits(frame, nominal, data);
+    if (data_bitrate == 0) {
+        nominal += data;
+        data = 0;
+    }
+    uint64_t ns = (uint64_t)nominal * 1000000000ull / bitrate;
+    if (data) ns += (uint64_t)data * 1000000000ull / data_bitrate;
+    return ns;
+}
+
+// ================= Setup =================
+
+Emulator::Emulator(const EmulatorOptions& options) : opt_(options), channels_(NUM_CHANNELS) {
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) channels_[ch].load = opt_.load[ch];
+    if (opt_.tick_us == 0) opt_.tick_us = 1;
+
+    master_ = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_ < 0) throw std::runtime_error(std::string("posix_openpt: ") + strerror(errno));
+    const char* name = nullptr;
+    if (grantpt(master_) != 0 || unlockpt(master_) != 0 || !(name = ptsname(master_))) {
+        close(master_);
+        throw std::runtime_error(std::string("Failed to unlock pty: ") + strerror(errno));
+    }
+    tty_ = name;
+
+    // Raw slave held open: no echo of our own output, and the master never
+    // sees a hangup between client sessions
+    slave_ = open(tty_.c_str(), O_RDWR | O_NOCTTY);
+    termios tio;
+    if (slave_ < 0 || tcgetattr(slave_, &tio) != 0) {
+        if (slave_ >= 0) close(slave_);
+        close(master_);
+        throw std::runtime_error("Failed to open " + tty_);
+    }
+    cfmakeraw(&tio);
+    tcsetattr(slave_, TCSANOW, &tio);
+    fcntl(master_, F_SETFL, fcntl(master_, F_GETFL) | O_NONBLOCK);
+
+    if (!opt_.link.empty()) {
+        unlink(opt_.link.c_str());
+        if (symlink(tty_.c_str(), opt_.link.c_str()) != 0) {
+            close(slave_);
+            close(master_);
+            throw std::runtime_error("Failed to link " + opt_.link + ": " + strerror(errno));
+        }
+    }
+
+    out_.reserve(opt_.usb_buffer_bytes + 256);
+    start_ns_ = monotonic_ns();
+    fw_last_ns_ = start_ns_;
+    thread_ = std::thread(&Emulator::run, this);
+    has_cpu_clock_ = pthread_getcpuclockid(thread_.native_handle(), &cpu_clock_) == 0;
+}
+
+Emulator::~Emulator() {
+    running_ = false;
+    if (thread_.joinable()) thread_.join();
+    if (!opt_.link.empty()) unlink(opt_.link.c_str());
+    close(slave_);
+    close(master_);
+}
+
+void Emulator::set_load(uint8_t channel, const ChannelLoad& load) {
+    if (channel >= NUM_CHANNELS) throw std::runtime_error("Invalid channel");
+    std::lock_guard<std::mutex> lock(mutex_);
+    channels_[channel].load = load;
+    channels_[channel].next_due = 0;
+}
+
+void Emulator::inject_errors(uint8_t channel, uint32_t count, BusError kind) {
+    if (channel >= NUM_CHANNELS) throw std::runtime_error("Invalid channel");
+    std::lock_guard<std::mutex> lock(mutex_);
+    channels_[channel].pending_errors += count;
+    channels_[channel].pending_kind = kind;
+}
+
+void Emulator::inject_usb_overflow(uint8_t channel, uint32_t frames) {
+    if (channel >= NUM_CHANNELS) throw std::runtime_error("Invalid channel");
+    std::lock_guard<std::mutex> lock(mutex_);
+    channels_[channel].usb_drops += frames;
+}
+
+EmulatorStats Emulator::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    EmulatorStats s = counters_;
+    s.elapsed_ns = monotonic_ns() - start_ns_;
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) {
+        const Channel& c = channels_[ch];
+        ChannelCounters& o = s.channels[ch];
+        o.open = c.open;
+        o.state = c.state;
+        o.tec = c.tec;
+        o.rec = c.rec;
+        o.bitrate = c.bitrate;
+        o.data_bitrate = c.data_bitrate;
+        o.bus_load = s.elapsed_ns ? std::min(1.0, (double)c.busy_ns / (double)s.elapsed_ns) : 0.0;
+    }
+    s.tx_latency_ns = tx_latency_.snapshot();
+    timespec ts;
+    if (has_cpu_clock_ && clock_gettime(cpu_clock_, &ts) == 0) {
+        s.cpu_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    }
+    return s;
+}
+
+// ================= Device loop =================
+
+void Emulator::run() {
+    const uint64_t tick_ns = (uint64_t)opt_.tick_us * 1000;
+    uint8_t buf[4096];
+    LineParser parser;
+    uint64_t next_tick = monotonic_ns();
+
+    while (running_.load(std::memory_order_relaxed)) {
+        uint64_t now = monotonic_ns();
+        if (now >= next_tick) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tick(now);
+            flush_out();
+            next_tick += tick_ns;
+            if (next_tick <= now) next_tick = now + tick_ns; // Fell behind: skip, don't burst
+        }
+
+        pollfd pfd = {master_, POLLIN, 0};
+        uint64_t wait = next_tick > now ? next_tick - now : 0;
+        timespec ts = {(time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull)};
+        if (ppoll(&pfd, 1, &ts, nullptr) <= 0 || !(pfd.revents & POLLIN)) continue;
+
+        ssize_t n;
+        while ((n = read(master_, buf, sizeof(buf))) > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            uint64_t t = monotonic_ns();
+            counters_.bytes_in += (uint64_t)n;
+            parser.feed(buf, (size_t)n, [&](const uint8_t* line, size_t len) { handle_line(line, len, t); });
+        }
+    }
+}
+
+static uint8_t error_state(uint16_t tec, uint16_t rec) {
+    if (tec > 255) return 3;
+    if (tec >= 128 || rec >= 128) return 2;
+    if (tec >= 96 || rec >= 96) return 1;
+    return 0;
+}
+
+void Emulator::tick(uint64_t now) {
+    if (opt_.fw_max_fps > 0) {
+        // Token bucket, 1 ms of burst (at least one USB packet's worth)
+        double cap = std::max(64.0, opt_.fw_max_fps / 1000.0);
+        fw_budget_ = std::min(cap, fw_budget_ + (double)(now - fw_last_ns_) * opt_.fw_max_fps / 1e9);
+        fw_last_ns_ = now;
+    }
+
+    static const char LEGACY[] = {0, 's', 'f', 'a', 'B', 'b', 'c'};
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) {
+        Channel& c = channels_[ch];
+        uint32_t burst = std::min<uint32_t>(c.pending_errors, 64);
+        if (burst && c.open && c.state != 3) {
+            ChannelCounters& cc = counters_.channels[ch];
+            bool tx_side = c.pending_kind == BusError::Ack || c.pending_kind == BusError::Bit0 ||
+                           c.pending_kind == BusError::Bit1;
+            for (uint32_t i = 0; i < burst && c.state != 3; ++i) {
+                if (tx_side) {
+                    c.tec = (uint16_t)std::min(c.tec + 8, 256);
+                } else {
+                    c.rec = (uint16_t)std::min(c.rec + 1, 255);
+                }
+                c.state = error_state(c.tec, c.rec);
+                c.bus_free = std::max(c.bus_free, now) + (uint64_t)ERROR_FRAME_BITS * 1000000000ull / c.bitrate;
+                if (c.codes.size() < 8) c.codes += LEGACY[(int)c.pending_kind];
+                ++cc.bus_errors;
+            }
+            c.last_error = (uint8_t)c.pending_kind;
+            c.dirty = true;
+            if (c.state == 3) c.tx_fifo.clear();
+        }
+        c.pending_errors -= burst;
+    }
+
+    // Rotate who goes first, so a tight firmware budget is shared fairly
+    for (uint8_t i = 0; i < NUM_CHANNELS; ++i) generate((uint8_t)((first_ + i) % NUM_CHANNELS), now);
+    first_ = (uint8_t)((first_ + 1) % NUM_CHANNELS);
+
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) report(ch, now, false);
+}
+
+void Emulator::generate(uint8_t ch, uint64_t now) {
+    Channel& c = channels_[ch];
+    const ChannelLoad& l = c.load;
+    if (!c.open || c.state == 3 || (!l.saturate && l.fps <= 0)) return;
+    if (c.next_due == 0) c.next_due = (double)now;
+    const double interval = l.saturate ? 0.0 : 1e9 / l.fps;
+    ChannelCounters& cc = counters_.channels[ch];
+
+    CanFrame f;
+    f.ext = l.kind == 'T' || l.kind == 'R' || l.kind == 'D' || l.kind == 'B';
+    f.rtr = l.kind == 'r' || l.kind == 'R';
+    f.fd = l.kind == 'd' || l.kind == 'D' || l.kind == 'b' || l.kind == 'B';
+    f.brs = l.kind == 'b' || l.kind == 'B';
+    f.len = f.fd ? (uint8_t)dlc_to_len(len_to_dlc(l.len)) : (uint8_t)std::min<uint8_t>(l.len, 8);
+    const uint32_t id_mask = f.ext ? 0x1FFFFFFF : 0x7FF;
+    const uint32_t id_count = l.id_count ? l.id_count : 1;
+
+    // Bounded so a rate the bus cannot carry (or no bus timing at all)
+    // never stalls the loop
+    for (int budget = 65536; budget > 0; --budget) {
+        uint64_t start = (uint64_t)c.next_due;
+        if (opt_.bus_timing && start < c.bus_free) start = c.bus_free;
+        if (start > now) break;
+
+        f.id = (l.id + c.seq % id_count) & id_mask;
+        size_t pos = 0;
+        if (opt_.stamp && f.len >= 8 && !f.rtr) {
+            for (int i = 0; i < 8; ++i) f.data[i] = (uint8_t)(start >> (8 * i));
+            pos = 8;
+        }
+        for (int i = 0; i < 4 && pos + i < f.len; ++i) f.data[pos + i] = (uint8_t)(c.seq >> (8 * i));
+        ++c.seq;
+
+        uint64_t done = start;
+        if (opt_.bus_timing) {
+            uint32_t nominal_bits, data_bits;
+            wire_bits(f, nominal_bits, data_bits);
+            done += (uint64_t)nominal_bits * 1000000000ull / c.bitrate;
+            if (data_bits) done += (uint64_t)data_bits * 1000000000ull / (c.data_bitrate ? c.data_bitrate : c.bitrate);
+            if (done > now) {
+                --c.seq; // Still on the wire; try again next tick
+                break;
+            }
+            c.busy_ns += done - start;
+            c.bus_free = done;
+        }
+        c.next_due += interval;
+        if (c.next_due < (double)done) c.next_due = (double)done; // Offered load beyond the bus
+
+        if (c.rec > 0) --c.rec;
+        if (c.state != 0 && error_state(c.tec, c.rec) != c.state) {
+            c.state = error_state(c.tec, c.rec);
+            c.dirty = true;
+        }
+
+        if (opt_.fw_max_fps > 0) {
+            if (fw_budget_ < 1.0) {
+                ++cc.rx_fw_dropped;
+                c.flags |= FW_RX_OVERFLOW;
+                c.reply_flags |= FW_RX_OVERFLOW;
+                if (c.codes.empty() || c.codes.back() != 'o') c.codes += 'o';
+                c.dirty = true;
+                continue;
+            }
+            fw_budget_ -= 1.0;
+        }
+
+        uint8_t line[MAX_LINE_LEN];
+        size_t len = encode_frame(ch, f, line);
+        if (c.usb_drops > 0 || !queue_line(line, len)) {
+            if (c.usb_drops > 0) --c.usb_drops;
+            ++cc.rx_usb_dropped;
+            c.flags |= FW_USB_OVERFLOW;
+            c.reply_flags |= FW_USB_OVERFLOW;
+            if (c.codes.empty() || c.codes.back() != 'o') c.codes += 'o';
+            c.dirty = true;
+            continue;
+        }
+        ++cc.rx_sent;
+    }
+}
+
+void Emulator::report(uint8_t ch, uint64_t now, bool force) {
+    Channel& c = channels_[ch];
+    bool state_changed = c.state != c.reported_state;
+    if (!c.dirty && !state_changed) return;
+    if (!force && !state_changed && now - c.last_report < (uint64_t)opt_.status_interval_ms * 1000000) return;
+
+    char line[32];
+    int n = 0;
+    switch (opt_.status) {
+    case StatusFormat::None:
+        break;
+    case StatusFormat::E:
+        n = snprintf(line, sizeof(line), "%cE%u%u%02X%02X%02X\r", '0' + ch, c.state, c.last_error, c.flags,
+                     std::min<unsigned>(c.tec, 255), std::min<unsigned>(c.rec, 255));
+        break;
+    case StatusFormat::e:
+        if (c.codes.empty()) break;
+        n = snprintf(line, sizeof(line), "%ce%u%s\r", '0' + ch, (unsigned)c.codes.size(), c.codes.c_str());
+        break;
+    case StatusFormat::s:
+        if (!state_changed) break;
+        n = snprintf(line, sizeof(line), "%cs%c%03u%03u\r", '0' + ch, "awpb"[c.state], std::min<unsigned>(c.rec, 999),
+                     std::min<unsigned>(c.tec, 999));
+        break;
+    }
+    if (n > 0 && queue_line(reinterpret_cast<const uint8_t*>(line), (size_t)n)) ++counters_.channels[ch].status_lines;
+
+    c.flags = 0;
+    c.last_error = 0;
+    c.codes.clear();
+    c.dirty = false;
+    c.reported_state = c.state;
+    c.last_report = now;
+}
+
+// ================= Host lines =================
+
+void Emulator::handle_line(const uint8_t* line, size_t len, uint64_t now) {
+    uint8_t ch = 0;
+    const uint8_t* cmd = line;
+    size_t n = len;
+    if (n >= 2 && cmd[0] >= '0' && cmd[0] < '0' + NUM_CHANNELS) {
+        ch = (uint8_t)(cmd[0] - '0');
+        ++cmd;
+        --n;
+    }
+    if (n == 0) return;
+
+    switch (cmd[0]) {
+    case 't':
+    case 'T':
+    case 'r':
+    case 'R':
+    case 'd':
+    case 'D':
+    case 'b':
+    case 'B': {
+        uint8_t frame_ch;
+        CanFrame frame;
+        if (decode_frame(line, len, frame_ch, frame)) {
+            handle_frame(frame_ch, frame, now);
+        } else {
+            ++counters_.bad_lines;
+        }
+        return;
+    }
+    default:
+        ++counters_.commands;
+        handle_command(ch, cmd, n);
+    }
+}
+
+void Emulator::handle_frame(uint8_t ch, const CanFrame& frame, uint64_t now) {
+    Channel& c = channels_[ch];
+    ChannelCounters& cc = counters_.channels[ch];
+    if (!c.open || c.listen_only || c.state == 3) {
+        ++cc.tx_dropped;
+        return;
+    }
+
+    if (opt_.stamp && frame.len >= 8 && !frame.rtr) {
+        uint64_t sent = 0;
+        for (int i = 0; i < 8; ++i) sent |= (uint64_t)frame.data[i] << (8 * i);
+        if (sent && sent <= now && now - sent < 60000000000ull) tx_latency_.record(now - sent);
+    }
+
+    while (!c.tx_fifo.empty() && c.tx_fifo.front() <= now) c.tx_fifo.pop_front();
+    if (c.tx_fifo.size() >= opt_.tx_fifo_depth) {
+        ++cc.tx_dropped;
+        c.flags |= FW_TX_FULL;
+        c.reply_flags |= FW_TX_FULL;
+        if (c.codes.empty() || c.codes.back() != 'O') c.codes += 'O';
+        c.dirty = true;
+        return;
+    }
+
+    uint64_t done = now;
+    if (opt_.bus_timing) {
+        uint64_t start = std::max(now, c.bus_free);
+        done = start + wire_ns(frame, c.bitrate, c.data_bitrate);
+        c.busy_ns += done - start;
+        c.bus_free = done;
+    }
+    c.tx_fifo.push_back(done);
+    ++cc.tx_frames;
+
+    if (c.tec > 0) --c.tec;
+    if (c.state != 0 && error_state(c.tec, c.rec) != c.state) {
+        c.state = error_state(c.tec, c.rec);
+        c.dirty = true;
+    }
+}
+
+static bool parse_uint(const uint8_t* p, size_t n, uint32_t& out, int base = 10) {
+    if (n == 0 || n > 10) return false;
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; ++i) {
+        int d;
+        if (p[i] >= '0' && p[i] <= '9') {
+            d = p[i] - '0';
+        } else if (base == 16 && p[i] >= 'A' && p[i] <= 'F') {
+            d = p[i] - 'A' + 10;
+        } else if (base == 16 && p[i] >= 'a' && p[i] <= 'f') {
+            d = p[i] - 'a' + 10;
+        } else {
+            return false;
+        }
+        v = v * (uint64_t)base + (uint64_t)d;
+    }
+    if (v > 0xFFFFFFFFull) return false;
+    out = (uint32_t)v;
+    return true;
+}
+
+// "CLK_PRE_SEG1_SEG2_SJW_TDC" (clock in MHz) to bitrate and sample point.
+static bool parse_timing(const uint8_t* p, size_t n, uint32_t& bitrate, uint32_t& sample_point) {
+    uint32_t v[6];
+    size_t count = 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= n && count < 6; ++i) {
+        if (i == n || p[i] == '_') {
+            if (!parse_uint(p + start, i - start, v[count++])) return false;
+            start = i + 1;
+        }
+    }
+    if (count < 4) return false;
+    uint32_t tq = 1 + v[2] + v[3];
+    if (v[0] == 0 || v[1] == 0) return false;
+    uint32_t rate = (uint32_t)((uint64_t)v[0] * 1000000ull / ((uint64_t)v[1] * tq));
+    if (rate == 0) return false;
+    bitrate = rate;
+    sample_point = (1 + v[2]) * 1000 / tq;
+    return true;
+}
+
+void Emulator::handle_command(uint8_t ch, const uint8_t* cmd, size_t n) {
+    Channel& c = channels_[ch];
+    const uint8_t* arg = cmd + 1;
+    const size_t arg_len = n - 1;
+    uint32_t v = 0;
+    char line[64];
+
+    switch (cmd[0]) {
+    case 'O':
+        if (!c.open) {
+            c.open = true;
+            c.next_due = 0;
+        }
+        break;
+    case 'C':
+        // Closing also takes the controller out of bus-off
+        c.open = false;
+        c.tx_fifo.clear();
+        c.tec = c.rec = 0;
+        c.state = 0;
+        c.pending_errors = 0;
+        break;
+    case 'L':
+        c.listen_only = !(arg_len == 1 && arg[0] == '0');
+        break;
+    case 'S':
+        if (arg_len == 1 && arg[0] >= '0' && arg[0] <= '8') c.bitrate = NOMINAL_RATES[arg[0] - '0'];
+        break;
+    case 'y':
+        if (parse_uint(arg, arg_len, v) && v > 0) c.bitrate = v;
+        break;
+    case 'Y':
+        // One hex digit as in the firmware table; the SDK sends decimal
+        // indices, which agree below 10
+        if (arg_len == 1 ? parse_uint(arg, 1, v, 16) : parse_uint(arg, arg_len, v)) {
+            if (v < sizeof(DATA_RATES) / sizeof(DATA_RATES[0])) c.data_bitrate = DATA_RATES[v];
+        }
+        break;
+    case 'p':
+        if (parse_uint(arg, arg_len, v) && v > 0 && v < 1000) c.sample_point = v;
+        break;
+    case 'P':
+        if (parse_uint(arg, arg_len, v) && v > 0 && v < 1000) c.data_sample_point = v;
+        break;
+    case 'a':
+        parse_timing(arg, arg_len, c.bitrate, c.sample_point);
+        break;
+    case 'A':
+        parse_timing(arg, arg_len, c.data_bitrate, c.data_sample_point);
+        break;
+    case 'q':
+        snprintf(line, sizeof(line), "q%u_%u", c.bitrate, c.sample_point);
+        reply(line);
+        break;
+    case 'Q':
+        snprintf(line, sizeof(line), "Q%u_%u", c.data_bitrate, c.data_sample_point);
+        reply(line);
+        break;
+    case 'N':
+        reply("N" + opt_.version + "_" + opt_.uid);
+        break;
+    case 'F':
+        snprintf(line, sizeof(line), "F%02X", c.reply_flags);
+        c.reply_flags = 0;
+        reply(line);
+        break;
+    default:
+        // s<btr> (legacy BTR) and anything else: accepted, ignored
+        break;
+    }
+}
+
+// ================= USB IN =================
+
+bool Emulator::queue_line(const uint8_t* line, size_t len) {
+    if (out_.size() + len > opt_.usb_buffer_bytes) return false;
+    out_.insert(out_.end(), line, line + len);
+    return true;
+}
+
+void Emulator::reply(const std::string& line) {
+    // Replies bypass the buffer limit; they are rare and must not be lost
+    out_.insert(out_.end(), line.begin(), line.end());
+    out_.push_back('\r');
+}
+
+void Emulator::flush_out() {
+    size_t done = 0;
+    while (done < out_.size()) {
+        ssize_t n = write(master_, out_.data() + done, out_.size() - done);
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    counters_.bytes_out += done;
+    out_.erase(out_.begin(), out_.begin() + (ptrdiff_t)done);
+}
+
+} // namespace emu
+} // namespace slcanx
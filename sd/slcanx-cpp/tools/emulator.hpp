@@ -0,0 +1,170 @@
+#pragma once
+
+// SLCANX firmware emulator on a pseudo-terminal (Linux).
+//
+// Speaks the device's multi-channel SLCAN dialect on the slave side of a pty,
+// so the SDK, slcandx + slcanx.ko or any other client can run without the
+// hardware:
+//
+//   commands  [0-3] O C L L0 S0-8 y Y p P a A q Q N F (no prefix = channel 0)
+//   frames    t T r R d D b B in both directions
+//   status    E (Eslffttss), e (e<n><codes>) or s (s<state><rec><tec>) lines
+//
+// Each channel has its own bus: received frames are generated at a target
+// rate and can never beat the wire time of the frame (exact stuff bits at the
+// configured nominal and data bitrates), and frames sent by the host occupy
+// the same bus through a bounded TX FIFO. Lines leave through a bounded USB IN
+// buffer; what does not fit is dropped and flagged like the firmware does.
+//
+//   slcanx::emu::EmulatorOptions opt;
+//   opt.load[0].fps = 30000;
+//   slcanx::emu::Emulator emu(opt);
+//   slcanx::Slcanx bus(emu.tty());
+
+#include "slcanx.hpp"
+#include "slcanx_metrics.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+namespace slcanx {
+namespace emu {
+
+// Received-traffic generator for one channel. Frames are only generated
+// while the channel is open and not bus-off.
+struct ChannelLoad {
+    double fps = 0;         // Target frames/s (0 = none)
+    bool saturate = false;  // Back-to-back at wire speed, ignoring fps
+    char kind = 't';        // t T r R d D b B
+    uint8_t len = 8;        // Payload length (DLC for r/R)
+    uint32_t id = 0x100;    // First ID
+    uint32_t id_count = 1;  // IDs cycle through id .. id + id_count - 1
+};
+
+enum class StatusFormat {
+    None,
+    E, // <ch>Eslffttss: state, last error, firmware flags, TEC, REC (hex)
+    e, // <ch>e<n><codes>: legacy error codes (a b B c f o O s)
+    s  // <ch>s<a|w|p|b><rec><tec>: state changes, counters in decimal
+};
+
+// Firmware flag bits in E lines and F replies.
+constexpr uint8_t FW_RX_OVERFLOW = 0x01;  // CAN RX buffer full
+constexpr uint8_t FW_TX_FULL = 0x04;      // CAN TX FIFO full
+constexpr uint8_t FW_USB_OVERFLOW = 0x08; // USB IN buffer full
+
+// Protocol error kinds for inject_errors(), codes as in E lines.
+enum class BusError : uint8_t { Stuff = 1, Form = 2, Ack = 3, Bit1 = 4, Bit0 = 5, Crc = 6 };
+
+struct EmulatorOptions {
+    std::array<ChannelLoad, NUM_CHANNELS> load{};
+    bool bus_timing = true;             // Pace frames by their wire time
+    bool stamp = false;                 // Payload bytes 0..7: CLOCK_MONOTONIC ns at send
+    uint32_t tick_us = 125;             // USB microframe: lines are written once per tick
+    size_t usb_buffer_bytes = 16384;    // USB IN buffer
+    double fw_max_fps = 0;              // Firmware RX budget over all channels (0 = unlimited)
+    size_t tx_fifo_depth = 32;          // Frames per channel TX FIFO
+    StatusFormat status = StatusFormat::E;
+    uint32_t status_interval_ms = 100;  // Shortest gap between status lines of a channel
+    std::string uid = "454D55000000000000000001";
+    std::string version = "1.6";
+    std::string link;                   // Optional symlink to the pty slave
+};
+
+struct ChannelCounters {
+    uint64_t rx_sent = 0;         // Frames written towards the host
+    uint64_t rx_fw_dropped = 0;   // Over fw_max_fps
+    uint64_t rx_usb_dropped = 0;  // USB IN buffer full (or injected)
+    uint64_t tx_frames = 0;       // Frames from the host put on the bus
+    uint64_t tx_dropped = 0;      // Closed, listen-only, bus-off or TX FIFO full
+    uint64_t status_lines = 0;
+    uint64_t bus_errors = 0;      // Injected protocol errors
+    bool open = false;
+    uint8_t state = 0;            // 0 active, 1 warning, 2 passive, 3 bus-off
+    uint16_t tec = 0;
+    uint16_t rec = 0;
+    uint32_t bitrate = 0;
+    uint32_t data_bitrate = 0;
+    double bus_load = 0;          // Share of time the bus was busy since start
+};
+
+struct EmulatorStats {
+    std::array<ChannelCounters, NUM_CHANNELS> channels{};
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    uint64_t commands = 0;
+    uint64_t bad_lines = 0;        // Lines from the host that did not parse
+    uint64_t elapsed_ns = 0;
+    uint64_t cpu_ns = 0;           // CPU time of the device thread
+    HistogramSnapshot tx_latency_ns; // Host stamp to emulator receipt (stamped TX frames)
+};
+
+class Emulator {
+public:
+    // Opens the pty and starts the device thread. Throws std::runtime_error.
+    explicit Emulator(const EmulatorOptions& options = EmulatorOptions());
+    ~Emulator();
+    Emulator(const Emulator&) = delete;
+    Emulator& operator=(const Emulator&) = delete;
+
+    // Path of the pty slave, e.g. /dev/pts/3.
+    const std::string& tty() const { return tty_; }
+
+    void set_load(uint8_t channel, const ChannelLoad& load);
+
+    // `count` protocol errors on the next ticks, raising TEC (Ack, Bit0/1) or
+    // REC (others) by 8 / 1 each and walking the error state up to bus-off.
+    void inject_errors(uint8_t channel, uint32_t count, BusError kind = BusError::Stuff);
+
+    // Drop the next `frames` received frames of a channel as if the USB IN
+    // buffer had overflowed.
+    void inject_usb_overflow(uint8_t channel, uint32_t frames);
+
+    EmulatorStats stats() const;
+
+    // Wire time of a frame with exact stuff bits: nominal-rate and data-rate
+    // bits (data bits are 0 unless BRS is set and data_bitrate is non-zero).
+    static void wire_bits(const CanFrame& frame, uint32_t& nominal_bits, uint32_t& data_bits);
+    static uint64_t wire_ns(const CanFrame& frame, uint32_t bitrate, uint32_t data_bitrate);
+
+private:
+    struct Channel;
+
+    void run();
+    void tick(uint64_t now);
+    void handle_line(const uint8_t* line, size_t len, uint64_t now);
+    void handle_command(uint8_t ch, const uint8_t* cmd, size_t len);
+    void handle_frame(uint8_t ch, const CanFrame& frame, uint64_t now);
+    void generate(uint8_t ch, uint64_t now);
+    void report(uint8_t ch, uint64_t now, bool force);
+    bool queue_line(const uint8_t* line, size_t len);
+    void reply(const std::string& line);
+    void flush_out();
+
+    EmulatorOptions opt_;
+    std::string tty_;
+    int master_ = -1;
+    int slave_ = -1; // Held open so clients can reconnect
+    std::vector<uint8_t> out_; // USB IN buffer
+    std::vector<Channel> channels_;
+    uint64_t start_ns_ = 0;
+    double fw_budget_ = 0;
+    uint64_t fw_last_ns_ = 0;
+    uint8_t first_ = 0; // Channel generated first this tick
+    Histogram tx_latency_;
+
+    mutable std::mutex mutex_; // Guards everything above against the API
+    EmulatorStats counters_;
+    std::atomic<bool> running_{true};
+    std::thread thread_;
+    clockid_t cpu_clock_{};
+    bool has_cpu_clock_ = false;
+};
+
+} // namespace emu
+} // namespace slcanx
@@ -0,0 +1,117 @@
+// slcanx_convert: convert between captures, BLF, ASC and candump logs, and
+// export any of them to a column store.
+//
+//   ./slcanx_convert /data/run42 run42.blf
+//   ./slcanx_convert trace.blf trace.asc
+//   ./slcanx_convert candump-2025-12-04_115641.log /data/run43/
+//   ./slcanx_convert /data/run42 run42.slcol
+//
+// The input format is taken from the file contents, the output format from
+// the extension (.blf, .asc, .log, .slcol); anything else is a capture
+// directory. Both sides stream, so memory use does not depend on the file
+// size.
+
+#include "slcanx_column.hpp"
+#include "slcanx_log.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace slcanx;
+
+static void usage(const char* prg) {
+    std::fprintf(stderr,
+                 "Usage: %s [options] INPUT OUTPUT\n"
+                 "  --level N                   BLF zlib level 0..9 (default 1, 0 = stored)\n"
+                 "  --container KIB             BLF container size (default 128)\n"
+                 "  --iface NAME:CH             candump interface to channel, repeatable\n"
+                 "  --segment-mib N             Capture segment size (default 64)\n"
+                 "  --block N                   Column store frames per block (default 1024)\n"
+                 "  --memory-mib N              Column store open blocks (default 64)\n",
+                 prg);
+}
+
+static bool ends_with(const std::string& path, const char* ext) {
+    size_t n = std::string(ext).size();
+    return path.size() > n && path.compare(path.size() - n, n, ext) == 0;
+}
+
+static bool is_log_name(const std::string& path) {
+    return ends_with(path, ".blf") || ends_with(path, ".asc") || ends_with(path, ".log");
+}
+
+int main(int argc, char** argv) {
+    LogOptions log_opt;
+    LogReaderOptions read_opt;
+    CaptureOptions cap_opt;
+    ColumnOptions col_opt;
+    std::string in, out;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::runtime_error(a + " needs a value");
+                return argv[++i];
+            };
+            if (a == "--level") {
+                log_opt.compression_level = std::atoi(value().c_str());
+            } else if (a == "--container") {
+                log_opt.container_bytes = (size_t)std::atoi(value().c_str()) << 10;
+            } else if (a == "--iface") {
+                std::string v = value();
+                size_t colon = v.find(':');
+                if (colon == std::string::npos) throw std::runtime_error("--iface needs NAME:CH");
+                read_opt.interfaces[v.substr(0, colon)] = std::atoi(v.c_str() + colon + 1);
+            } else if (a == "--segment-mib") {
+                cap_opt.segment_bytes = (size_t)std::atoi(value().c_str()) << 20;
+            } else if (a == "--block") {
+                col_opt.block_records = (size_t)std::atoi(value().c_str());
+            } else if (a == "--memory-mib") {
+                col_opt.memory_bytes = (size_t)std::atoi(value().c_str()) << 20;
+            } else if (a == "-h" || a == "--help") {
+                usage(argv[0]);
+                return 0;
+            } else if (in.empty()) {
+                in = a;
+            } else if (out.empty()) {
+                out = a;
+            } else {
+                throw std::runtime_error("Unexpected argument " + a);
+            }
+        }
+        if (in.empty() || out.empty()) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        std::unique_ptr<LogReader> reader = open_log(in, read_opt);
+        std::unique_ptr<CaptureSink> sink;
+        if (is_log_name(out)) {
+            sink = open_log_writer(out, log_opt);
+        } else if (ends_with(out, ".slcol")) {
+            col_opt.path = out;
+            sink.reset(new ColumnWriter(col_opt));
+        } else {
+            cap_opt.directory = out;
+            sink.reset(new CaptureWriter(cap_opt));
+        }
+        uint64_t frames = 0;
+        CaptureRecord r;
+        while (reader->next(r)) {
+            sink->write_wait(r);
+            ++frames;
+        }
+        sink.reset(); // Writes out the rest and closes the file
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::printf("%s -> %s: %llu frames in %.2f s (%.0f frames/s), %llu lines/objects skipped\n", in.c_str(),
+                    out.c_str(), (unsigned long long)frames, s, s > 0 ? (double)frames / s : 0.0,
+                    (unsigned long long)reader->skipped());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "slcanx_convert: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,276 @@
+// slcanx_emu: SLCANX device emulator on a pseudo-terminal.
+//
+//   ./slcanx_emu --link /tmp/ttySLX --load all:30000 --stamp
+//   sudo ./slcandx -0o -1o ... /tmp/ttySLX     (or any SDK example)
+//
+// Prints the pty path on the first line of stdout, then runs until Ctrl-C or
+// --duration, and prints its counters (as JSON with --json).
+
+#include "emulator.hpp"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace slcanx;
+using namespace slcanx::emu;
+
+static volatile std::sig_atomic_t g_stop = 0;
+
+static void on_signal(int) { g_stop = 1; }
+
+static void usage(const char* prg) {
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  --link PATH                 Symlink to the pty slave\n"
+                 "  --load CH:FPS[:KIND[:LEN[:ID[:COUNT]]]]\n"
+                 "                              RX load; CH 0-3 or all, FPS a number or max\n"
+                 "                              (back to back), KIND t T r R d D b B\n"
+                 "  --no-bus-timing             Ignore wire time, pace by FPS alone\n"
+                 "  --stamp                     Stamp RX payloads, measure stamped TX frames\n"
+                 "  --tick-us N                 USB IN write period (default 125)\n"
+                 "  --usb-buffer BYTES          USB IN buffer (default 16384)\n"
+                 "  --fw-fps N                  Firmware RX budget, all channels (default none)\n"
+                 "  --tx-fifo N                 TX FIFO depth per channel (default 32)\n"
+                 "  --status E|e|s|none         Status line format (default E)\n"
+                 "  --status-interval MS        Minimum gap between status lines (default 100)\n"
+                 "  --error-burst CH:COUNT[:KIND[:PERIOD_MS]]\n"
+                 "                              KIND stuff form ack bit1 bit0 crc; repeats\n"
+                 "                              every PERIOD_MS if given\n"
+                 "  --usb-overflow CH:FRAMES[:PERIOD_MS]\n"
+                 "                              Drop frames as a USB IN overflow\n"
+                 "  --duration SEC              Stop after SEC seconds\n"
+                 "  --report SEC                Counters to stderr every SEC seconds\n"
+                 "  --json                      Final counters as JSON on stdout\n",
+                 prg);
+}
+
+static std::vector<std::string> split(const std::string& s) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (;;) {
+        size_t colon = s.find(':', start);
+        parts.push_back(s.substr(start, colon - start));
+        if (colon == std::string::npos) return parts;
+        start = colon + 1;
+    }
+}
+
+// Channel list for "0".."3" or "all"
+static std::vector<uint8_t> channels_of(const std::string& s) {
+    if (s == "all") return {0, 1, 2, 3};
+    int ch = std::atoi(s.c_str());
+    if (s.size() != 1 || ch < 0 || ch >= NUM_CHANNELS) throw std::runtime_error("Invalid channel: " + s);
+    return {(uint8_t)ch};
+}
+
+static BusError error_kind(const std::string& s) {
+    if (s == "stuff") return BusError::Stuff;
+    if (s == "form") return BusError::Form;
+    if (s == "ack") return BusError::Ack;
+    if (s == "bit1") return BusError::Bit1;
+    if (s == "bit0") return BusError::Bit0;
+    if (s == "crc") return BusError::Crc;
+    throw std::runtime_error("Unknown error kind: " + s);
+}
+
+// A repeating injection from the command line.
+struct Injection {
+    bool usb = false;
+    uint8_t channel = 0;
+    uint32_t count = 0;
+    BusError kind = BusError::Stuff;
+    uint32_t period_ms = 0;
+    std::chrono::steady_clock::time_point next;
+};
+
+static void print_text(const EmulatorStats& s) {
+    std::fprintf(stderr, "%.1fs in %llu B out %llu B commands %llu bad lines %llu\n", s.elapsed_ns / 1e9,
+                 (unsigned long long)s.bytes_in, (unsigned long long)s.bytes_out, (unsigned long long)s.commands,
+                 (unsigned long long)s.bad_lines);
+    const double secs = s.elapsed_ns ? s.elapsed_ns / 1e9 : 1.0;
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) {
+        const ChannelCounters& c = s.channels[ch];
+        std::fprintf(stderr,
+                     "  ch%u %s rx %llu (%.0f/s) fw_drop %llu usb_drop %llu | tx %llu (%.0f/s) tx_drop %llu | "
+                     "state %u tec %u rec %u errors %llu status %llu load %.1f%%\n",
+                     ch, c.open ? "open  " : "closed", (unsigned long long)c.rx_sent, c.rx_sent / secs,
+                     (unsigned long long)c.rx_fw_dropped, (unsigned long long)c.rx_usb_dropped,
+                     (unsigned long long)c.tx_frames, c.tx_frames / secs, (unsigned long long)c.tx_dropped, c.state,
+                     c.tec, c.rec, (unsigned long long)c.bus_errors, (unsigned long long)c.status_lines,
+                     c.bus_load * 100.0);
+    }
+    if (s.tx_latency_ns.count) {
+        std::fprintf(stderr, "  tx latency us p50 %.1f p99 %.1f p99.9 %.1f max %.1f (%llu)\n",
+                     s.tx_latency_ns.quantile(0.5) / 1e3, s.tx_latency_ns.quantile(0.99) / 1e3,
+                     s.tx_latency_ns.quantile(0.999) / 1e3, s.tx_latency_ns.max / 1e3,
+                     (unsigned long long)s.tx_latency_ns.count);
+    }
+}
+
+static void print_json(const EmulatorStats& s) {
+    std::printf("{\"elapsed_ns\": %llu, \"bytes_in\": %llu, \"bytes_out\": %llu, \"commands\": %llu, "
+                "\"bad_lines\": %llu, \"channels\": [",
+                (unsigned long long)s.elapsed_ns, (unsigned long long)s.bytes_in, (unsigned long long)s.bytes_out,
+                (unsigned long long)s.commands, (unsigned long long)s.bad_lines);
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) {
+        const ChannelCounters& c = s.channels[ch];
+        std::printf("%s{\"channel\": %u, \"open\": %s, \"bitrate\": %u, \"data_bitrate\": %u, \"rx_sent\": %llu, "
+                    "\"rx_fw_dropped\": %llu, \"rx_usb_dropped\": %llu, \"tx_frames\": %llu, \"tx_dropped\": %llu, "
+                    "\"bus_errors\": %llu, \"status_lines\": %llu, \"state\": %u, \"tec\": %u, \"rec\": %u, "
+                    "\"bus_load\": %.4f}",
+                    ch ? ", " : "", ch, c.open ? "true" : "false", c.bitrate, c.data_bitrate,
+                    (unsigned long long)c.rx_sent, (unsigned long long)c.rx_fw_dropped,
+                    (unsigned long long)c.rx_usb_dropped, (unsigned long long)c.tx_frames,
+                    (unsigned long long)c.tx_dropped, (unsigned long long)c.bus_errors,
+                    (unsigned long long)c.status_lines, c.state, c.tec, c.rec, c.bus_load);
+    }
+    const HistogramSnapshot& h = s.tx_latency_ns;
+    std::printf("], \"tx_latency_ns\": {\"count\": %llu, \"p50\": %llu, \"p99\": %llu, \"p999\": %llu, "
+                "\"max\": %llu}}\n",
+                (unsigned long long)h.count, (unsigned long long)h.quantile(0.5),
+                (unsigned long long)h.quantile(0.99), (unsigned long long)h.quantile(0.999),
+                (unsigned long long)h.max);
+}
+
+int main(int argc, char** argv) {
+    EmulatorOptions opt;
+    std::vector<Injection> injections;
+    double duration = 0;
+    double report = 0;
+    bool json = false;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::runtime_error(a + " needs a value");
+                return argv[++i];
+            };
+            if (a == "--link") {
+                opt.link = value();
+            } else if (a == "--load") {
+                std::vector<std::string> p = split(value());
+                if (p.size() < 2) throw std::runtime_error("--load CH:FPS[:KIND[:LEN[:ID[:COUNT]]]]");
+                for (uint8_t ch : channels_of(p[0])) {
+                    ChannelLoad& l = opt.load[ch];
+                    l.saturate = p[1] == "max";
+                    l.fps = l.saturate ? 0 : std::atof(p[1].c_str());
+                    if (p.size() > 2 && !p[2].empty()) l.kind = p[2][0];
+                    if (p.size() > 3) l.len = (uint8_t)std::atoi(p[3].c_str());
+                    if (p.size() > 4) l.id = (uint32_t)std::strtoul(p[4].c_str(), nullptr, 16);
+                    if (p.size() > 5) l.id_count = (uint32_t)std::atoi(p[5].c_str());
+                    if (std::string("tTrRdDbB").find(l.kind) == std::string::npos) {
+                        throw std::runtime_error(std::string("Unknown frame kind: ") + l.kind);
+                    }
+                }
+            } else if (a == "--no-bus-timing") {
+                opt.bus_timing = false;
+            } else if (a == "--stamp") {
+                opt.stamp = true;
+            } else if (a == "--tick-us") {
+                opt.tick_us = (uint32_t)std::atoi(value().c_str());
+            } else if (a == "--usb-buffer") {
+                opt.usb_buffer_bytes = (size_t)std::atol(value().c_str());
+            } else if (a == "--fw-fps") {
+                opt.fw_max_fps = std::atof(value().c_str());
+            } else if (a == "--tx-fifo") {
+                opt.tx_fifo_depth = (size_t)std::atoi(value().c_str());
+            } else if (a == "--status") {
+                std::string f = value();
+                if (f == "E") {
+                    opt.status = StatusFormat::E;
+                } else if (f == "e") {
+                    opt.status = StatusFormat::e;
+                } else if (f == "s") {
+                    opt.status = StatusFormat::s;
+                } else if (f == "none") {
+                    opt.status = StatusFormat::None;
+                } else {
+                    throw std::runtime_error("Unknown status format: " + f);
+                }
+            } else if (a == "--status-interval") {
+                opt.status_interval_ms = (uint32_t)std::atoi(value().c_str());
+            } else if (a == "--error-burst" || a == "--usb-overflow") {
+                bool usb = a == "--usb-overflow";
+                std::vector<std::string> p = split(value());
+                if (p.size() < 2) throw std::runtime_error(a + " CH:COUNT[...]");
+                for (uint8_t ch : channels_of(p[0])) {
+                    Injection in;
+                    in.usb = usb;
+                    in.channel = ch;
+                    in.count = (uint32_t)std::atoi(p[1].c_str());
+                    size_t period = usb ? 2 : 3;
+                    if (!usb && p.size() > 2) in.kind = error_kind(p[2]);
+                    if (p.size() > period) in.period_ms = (uint32_t)std::atoi(p[period].c_str());
+                    injections.push_back(in);
+                }
+            } else if (a == "--duration") {
+                duration = std::atof(value().c_str());
+            } else if (a == "--report") {
+                report = std::atof(value().c_str());
+            } else if (a == "--json") {
+                json = true;
+            } else {
+                usage(argv[0]);
+                return a == "-h" || a == "--help" ? 0 : 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    try {
+        Emulator emu(opt);
+        std::printf("%s\n", emu.tty().c_str());
+        std::fflush(stdout);
+
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        auto next_report = start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(report));
+        for (Injection& in : injections) in.next = start;
+
+        while (!g_stop) {
+            auto now = clock::now();
+            if (duration > 0 && now - start >= std::chrono::duration<double>(duration)) break;
+            for (Injection& in : injections) {
+                if (in.count == 0 || now < in.next) continue;
+                if (in.usb) {
+                    emu.inject_usb_overflow(in.channel, in.count);
+                } else {
+                    emu.inject_errors(in.channel, in.count, in.kind);
+                }
+                if (in.period_ms) {
+                    in.next += std::chrono::milliseconds(in.period_ms);
+                } else {
+                    in.count = 0;
+                }
+            }
+            if (report > 0 && now >= next_report) {
+                print_text(emu.stats());
+                next_report += std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(report));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        EmulatorStats s = emu.stats();
+        if (json) {
+            print_json(s);
+        } else {
+            print_text(s);
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,784 @@
+// slcanx_load: end-to-end throughput and latency at stepped offered loads.
+//
+// Paths:
+//   sdk      Slcanx on the pty of an in-process emulator (tools/emulator.hpp)
+//   kernel   slcandx + slcanx.ko on the emulator's pty, measured on SocketCAN
+//            (--attach runs the slcandx command, {tty} is the pty path)
+//   gateway  a gateway process between vcan interfaces (linux_training)
+//
+// Every frame carries CLOCK_MONOTONIC ns in payload bytes 0..7, stamped where
+// it enters the path (at start of frame on the emulated bus for RX) and
+// checked where it leaves. Per step the tool reports offered and achieved
+// frames/s, drop rate over the whole step, CPU per frame and latency
+// quantiles, and writes the run as JSON with --json.
+//
+//   ./slcanx_load --path sdk --steps 30000,60000,120000,150000 --json sdk.json
+//   ./slcanx_load --path kernel --can can0,can1,can2,can3
+//       --attach "slcandx -0o -0s8 -0Y8 -1o -1s8 -1Y8 -2o -2s8 -2Y8 -3o -3s8 -3Y8 {tty} can"
+//   ./slcanx_load --path gateway --in can0,can1,can2 --out can3 --spawn ./cangw_c_epoll
+
+#include "emulator.hpp"
+#include "slcanx_codec.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <functional>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <memory>
+#include <net/if.h>
+#include <signal.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace slcanx;
+
+static uint64_t now_ns(clockid_t clock = CLOCK_MONOTONIC) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void put_stamp(uint8_t* p, uint64_t t) {
+    for (int i = 0; i < 8; ++i) p[i] = (uint8_t)(t >> (8 * i));
+}
+
+static uint64_t get_stamp(const uint8_t* p) {
+    uint64_t t = 0;
+    for (int i = 0; i < 8; ++i) t |= (uint64_t)p[i] << (8 * i);
+    return t;
+}
+
+static void sleep_s(double s) { std::this_thread::sleep_for(std::chrono::duration<double>(s)); }
+
+static std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> parts;
+    std::stringstream in(s);
+    std::string item;
+    while (std::getline(in, item, sep)) {
+        if (!item.empty()) parts.push_back(item);
+    }
+    return parts;
+}
+
+// ================= CPU accounting =================
+
+// Busy time of all CPUs from /proc/stat, in ns.
+static uint64_t system_busy_ns() {
+    std::ifstream in("/proc/stat");
+    std::string cpu;
+    uint64_t v[10] = {};
+    in >> cpu;
+    for (uint64_t& x : v) in >> x;
+    uint64_t busy = v[0] + v[1] + v[2] + v[5] + v[6] + v[7]; // user nice system irq softirq steal
+    return busy * (1000000000ull / (uint64_t)sysconf(_SC_CLK_TCK));
+}
+
+// utime + stime of a process, in ns.
+static uint64_t process_cpu_ns(pid_t pid) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    std::getline(in, line);
+    size_t paren = line.rfind(')');
+    if (paren == std::string::npos) return 0;
+    std::istringstream fields(line.substr(paren + 2));
+    std::string f;
+    uint64_t utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && fields >> f; ++i) {
+        if (i == 14) utime = std::strtoull(f.c_str(), nullptr, 10);
+        if (i == 15) stime = std::strtoull(f.c_str(), nullptr, 10);
+    }
+    return (utime + stime) * (1000000000ull / (uint64_t)sysconf(_SC_CLK_TCK));
+}
+
+// ================= Frames =================
+
+struct FrameSpec {
+    char kind = 'b';
+    uint8_t len = 8;
+};
+
+static CanFrame make_frame(const FrameSpec& spec, uint32_t id) {
+    CanFrame f;
+    f.id = id;
+    f.ext = spec.kind == 'T' || spec.kind == 'D' || spec.kind == 'B';
+    f.fd = spec.kind == 'd' || spec.kind == 'D' || spec.kind == 'b' || spec.kind == 'B';
+    f.brs = spec.kind == 'b' || spec.kind == 'B';
+    f.len = std::max<uint8_t>(8, f.fd ? (uint8_t)dlc_to_len(len_to_dlc(spec.len)) : 8); // Room for the stamp
+    return f;
+}
+
+// Sends at a set rate from its own thread: sends owed since the rate was
+// set are issued every 50 us, so the rate holds on average even when one
+// wakeup comes late.
+class Pacer {
+public:
+    // send(seq) returns false when the path refused the frame
+    explicit Pacer(std::function<bool(uint64_t)> send) : send_(std::move(send)), thread_([this] { run(); }) {}
+
+    ~Pacer() {
+        running_ = false;
+        thread_.join();
+    }
+
+    void set_rate(double fps) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fps_ = fps;
+        since_ = now_ns();
+        issued_ = 0;
+    }
+
+    uint64_t sent() const { return sent_.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+private:
+    void run() {
+        uint64_t seq = 0;
+        while (running_.load(std::memory_order_relaxed)) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (fps_ > 0) {
+                    uint64_t due = (uint64_t)((double)(now_ns() - since_) * fps_ / 1e9);
+                    // At most 100 ms of backlog, so a stall does not end in a burst
+                    uint64_t cap = (uint64_t)(fps_ / 10) + 1;
+                    if (due > issued_ + cap) issued_ = due - cap;
+                    for (; issued_ < due; ++issued_) {
+                        if (send_(seq++)) {
+                            sent_.fetch_add(1, std::memory_order_relaxed);
+                        } else {
+                            rejected_.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                }
+            }
+            timespec ts = {0, 50000};
+            clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, nullptr);
+        }
+    }
+
+    std::function<bool(uint64_t)> send_;
+    std::mutex mutex_;
+    double fps_ = 0;
+    uint64_t since_ = 0;
+    uint64_t issued_ = 0;
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<bool> running_{true};
+    std::thread thread_;
+};
+
+// ================= SocketCAN =================
+
+static int open_can(const std::string& ifname, double wait_s) {
+    int s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (s < 0) throw std::runtime_error(std::string("socket(PF_CAN): ") + strerror(errno));
+    int on = 1;
+    int off = 0;
+    setsockopt(s, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &on, sizeof(on));
+    setsockopt(s, SOL_CAN_RAW, CAN_RAW_LOOPBACK, &off, sizeof(off));
+
+    // The interface may still be coming up (slcandx attaching)
+    ifreq ifr = {};
+    std::strncpy(ifr.ifr_name, ifname.c_str(), IFNAMSIZ - 1);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(wait_s);
+    while (ioctl(s, SIOCGIFINDEX, &ifr) < 0) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            close(s);
+            throw std::runtime_error("No CAN interface " + ifname);
+        }
+        sleep_s(0.1);
+    }
+    sockaddr_can addr = {};
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(s);
+        throw std::runtime_error("bind " + ifname + ": " + strerror(errno));
+    }
+    // Non-blocking: a full TX queue counts as rejected, and the sink can stop
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+    return s;
+}
+
+static bool can_write(int s, const CanFrame& f) {
+    canfd_frame cf = {};
+    cf.can_id = f.id | (f.ext ? CAN_EFF_FLAG : 0);
+    cf.len = f.len;
+    if (f.brs) cf.flags |= CANFD_BRS;
+    std::memcpy(cf.data, f.data.data(), f.len);
+    size_t mtu = f.fd ? CANFD_MTU : CAN_MTU;
+    return write(s, &cf, mtu) == (ssize_t)mtu;
+}
+
+// Receives stamped frames on a set of sockets from one thread.
+class CanSink {
+public:
+    explicit CanSink(const std::vector<int>& sockets) : sockets_(sockets) {
+        epfd_ = epoll_create1(0);
+        for (int s : sockets_) {
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.fd = s;
+            epoll_ctl(epfd_, EPOLL_CTL_ADD, s, &ev);
+        }
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~CanSink() {
+        running_ = false;
+        thread_.join();
+        close(epfd_);
+    }
+
+    uint64_t received() const { return received_.load(std::memory_order_relaxed); }
+    HistogramSnapshot latency() const { return latency_.snapshot(); }
+
+private:
+    void run() {
+        epoll_event events[8];
+        canfd_frame cf;
+        while (running_.load(std::memory_order_relaxed)) {
+            int n = epoll_wait(epfd_, events, 8, 100);
+            for (int i = 0; i < n; ++i) {
+                while (read(events[i].data.fd, &cf, sizeof(cf)) > 0) {
+                    uint64_t t = now_ns();
+                    uint64_t stamp = cf.len >= 8 ? get_stamp(cf.data) : 0;
+                    if (stamp && stamp <= t) latency_.record(t - stamp);
+                    received_.fetch_add(1, std::memory_order_relaxed);
+                    if (!running_.load(std::memory_order_relaxed)) break;
+                }
+            }
+        }
+    }
+
+    std::vector<int> sockets_;
+    int epfd_ = -1;
+    Histogram latency_;
+    std::atomic<uint64_t> received_{0};
+    std::atomic<bool> running_{true};
+    std::thread thread_;
+};
+
+// ================= Paths =================
+
+// Cumulative counters of a path.
+struct Sample {
+    uint64_t sent = 0;     // Frames that entered the path
+    uint64_t rejected = 0; // Refused at the entry (TX ring or socket full)
+    uint64_t received = 0; // Frames that came out
+    uint64_t cpu_ns = 0;   // CPU charged to the path under test
+    HistogramSnapshot latency;
+};
+
+struct Config {
+    std::string path = "sdk";
+    std::string direction = "rx";
+    uint8_t channels = NUM_CHANNELS;
+    FrameSpec frame;
+    uint32_t bitrate = 1000000;
+    uint32_t data_bitrate = 8000000;
+    bool bus_timing = false;
+    double fw_fps = 0;
+    std::vector<std::string> can;     // kernel: one interface per channel
+    std::vector<std::string> in, out; // gateway
+    std::string attach, detach, spawn;
+    pid_t pid = 0;
+};
+
+class Path {
+public:
+    virtual ~Path() = default;
+    virtual void set_rate(double fps) = 0;
+    virtual Sample sample() = 0;
+    virtual std::string cpu_scope() const = 0;
+};
+
+static emu::EmulatorOptions emulator_options(const Config& c) {
+    emu::EmulatorOptions o;
+    o.stamp = true;
+    o.bus_timing = c.bus_timing;
+    o.fw_max_fps = c.fw_fps;
+    for (emu::ChannelLoad& l : o.load) {
+        l.kind = c.frame.kind;
+        l.len = std::max<uint8_t>(8, c.frame.len);
+    }
+    return o;
+}
+
+static void set_emulator_rate(emu::Emulator& e, const Config& c, double fps) {
+    for (uint8_t ch = 0; ch < c.channels; ++ch) {
+        emu::ChannelLoad l;
+        l.kind = c.frame.kind;
+        l.len = std::max<uint8_t>(8, c.frame.len);
+        l.id = 0x100 + ch;
+        l.fps = fps / c.channels;
+        e.set_load(ch, l);
+    }
+}
+
+static void emulator_counts(const emu::EmulatorStats& s, uint64_t& generated, uint64_t& tx) {
+    generated = tx = 0;
+    for (const emu::ChannelCounters& c : s.channels) {
+        generated += c.rx_sent + c.rx_usb_dropped + c.rx_fw_dropped;
+        tx += c.tx_frames;
+    }
+}
+
+// Slcanx on the emulator's pty; CPU is this process minus the emulator thread.
+class SdkPath : public Path {
+public:
+    explicit SdkPath(const Config& c) : c_(c), emu_(emulator_options(c)), bus_(emu_.tty()) {
+        bus_.set_rx_callback([this](uint8_t, const CanFrame& f) {
+            uint64_t t = now_ns();
+            uint64_t stamp = f.len >= 8 ? get_stamp(f.data.data()) : 0;
+            if (stamp && stamp <= t) latency_.record(t - stamp);
+            received_.fetch_add(1, std::memory_order_relaxed);
+        });
+        std::vector<ChannelConfig> cfg;
+        for (uint8_t ch = 0; ch < c.channels; ++ch) {
+            ChannelConfig cc;
+            cc.channel = ch;
+            cc.bitrate = c.bitrate;
+            cc.data_bitrate = c.data_bitrate;
+            cc.open = true;
+            cfg.push_back(cc);
+        }
+        bus_.configure(cfg);
+        if (c.direction == "tx") {
+            pacer_.reset(new Pacer([this](uint64_t seq) {
+                uint8_t ch = (uint8_t)(seq % c_.channels);
+                CanFrame f = make_frame(c_.frame, 0x100 + ch);
+                put_stamp(f.data.data(), now_ns());
+                return bus_.try_send(ch, f);
+            }));
+        }
+    }
+
+    void set_rate(double fps) override {
+        if (pacer_) {
+            pacer_->set_rate(fps);
+        } else {
+            set_emulator_rate(emu_, c_, fps);
+        }
+    }
+
+    Sample sample() override {
+        Sample s;
+        emu::EmulatorStats e = emu_.stats();
+        uint64_t generated, tx;
+        emulator_counts(e, generated, tx);
+        if (pacer_) {
+            s.sent = pacer_->sent();
+            s.rejected = pacer_->rejected();
+            s.received = tx;
+            s.latency = e.tx_latency_ns;
+        } else {
+            s.sent = generated;
+            s.received = received_.load(std::memory_order_relaxed);
+            s.latency = latency_.snapshot();
+        }
+        uint64_t cpu = now_ns(CLOCK_PROCESS_CPUTIME_ID);
+        s.cpu_ns = cpu > e.cpu_ns ? cpu - e.cpu_ns : 0;
+        return s;
+    }
+
+    std::string cpu_scope() const override { return "process minus emulator thread"; }
+
+private:
+    Config c_;
+    emu::Emulator emu_;
+    Slcanx bus_;
+    Histogram latency_;
+    std::atomic<uint64_t> received_{0};
+    std::unique_ptr<Pacer> pacer_;
+};
+
+static std::string replace_tty(std::string cmd, const std::string& tty) {
+    for (size_t pos; (pos = cmd.find("{tty}")) != std::string::npos;) cmd.replace(pos, 5, tty);
+    return cmd;
+}
+
+// slcandx + slcanx.ko on the emulator's pty; CPU is the whole system minus
+// the emulator thread (driver, softirq, slcandx and this tool's socket I/O).
+class KernelPath : public Path {
+public:
+    explicit KernelPath(const Config& c) : c_(c), emu_(emulator_options(c)) {
+        if (c.can.size() < c.channels) throw std::runtime_error("--can needs one interface per channel");
+        if (!c.attach.empty()) {
+            std::string cmd = replace_tty(c.attach, emu_.tty());
+            std::fprintf(stderr, "attach: %s\n", cmd.c_str());
+            if (std::system(cmd.c_str()) != 0) throw std::runtime_error("Attach command failed");
+        } else {
+            std::fprintf(stderr, "Attach slcandx to %s now\n", emu_.tty().c_str());
+        }
+        for (uint8_t ch = 0; ch < c.channels; ++ch) sockets_.push_back(open_can(c.can[ch], 30));
+        if (c.direction == "tx") {
+            pacer_.reset(new Pacer([this](uint64_t seq) {
+                uint8_t ch = (uint8_t)(seq % c_.channels);
+                CanFrame f = make_frame(c_.frame, 0x100 + ch);
+                put_stamp(f.data.data(), now_ns());
+                return can_write(sockets_[ch], f);
+            }));
+        } else {
+            sink_.reset(new CanSink(sockets_));
+        }
+    }
+
+    ~KernelPath() override {
+        pacer_.reset();
+        sink_.reset();
+        for (int s : sockets_) close(s);
+        if (!c_.detach.empty() && std::system(replace_tty(c_.detach, emu_.tty()).c_str()) != 0) {
+            std::fprintf(stderr, "Detach command failed\n");
+        }
+    }
+
+    void set_rate(double fps) override {
+        if (pacer_) {
+            pacer_->set_rate(fps);
+        } else {
+            set_emulator_rate(emu_, c_, fps);
+        }
+    }
+
+    Sample sample() override {
+        Sample s;
+        emu::EmulatorStats e = emu_.stats();
+        uint64_t generated, tx;
+        emulator_counts(e, generated, tx);
+        if (pacer_) {
+            s.sent = pacer_->sent();
+            s.rejected = pacer_->rejected();
+            s.received = tx;
+            s.latency = e.tx_latency_ns;
+        } else {
+            s.sent = generated;
+            s.received = sink_->received();
+            s.latency = sink_->latency();
+        }
+        uint64_t busy = system_busy_ns();
+        s.cpu_ns = busy > e.cpu_ns ? busy - e.cpu_ns : 0;
+        return s;
+    }
+
+    std::string cpu_scope() const override { return "system minus emulator thread"; }
+
+private:
+    Config c_;
+    emu::Emulator emu_;
+    std::vector<int> sockets_;
+    std::unique_ptr<Pacer> pacer_;
+    std::unique_ptr<CanSink> sink_;
+};
+
+// A gateway between vcan interfaces: stamped frames go into --in round robin
+// and are taken off --out. CPU is the gateway process when known, else the
+// whole system.
+class GatewayPath : public Path {
+public:
+    explicit GatewayPath(const Config& c) : c_(c), pid_(c.pid) {
+        if (c.in.empty() || c.out.empty()) throw std::runtime_error("--in and --out are required");
+        if (!c.spawn.empty()) {
+            pid_ = fork();
+            if (pid_ == 0) {
+                execl("/bin/sh", "sh", "-c", ("exec " + c.spawn).c_str(), (char*)nullptr);
+                _exit(127);
+            }
+            if (pid_ < 0) throw std::runtime_error("fork failed");
+            spawned_ = true;
+            sleep_s(1.0); // Let it open its sockets
+        }
+        for (const std::string& name : c.out) out_.push_back(open_can(name, 5));
+        for (const std::string& name : c.in) in_.push_back(open_can(name, 5));
+        sink_.reset(new CanSink(out_));
+        pacer_.reset(new Pacer([this](uint64_t seq) {
+            size_t i = (size_t)(seq % in_.size());
+            CanFrame f = make_frame(c_.frame, 0x100 + (uint32_t)i);
+            put_stamp(f.data.data(), now_ns());
+            return can_write(in_[i], f);
+        }));
+    }
+
+    ~GatewayPath() override {
+        pacer_.reset();
+        sink_.reset();
+        for (int s : in_) close(s);
+        for (int s : out_) close(s);
+        if (spawned_) {
+            kill(pid_, SIGINT);
+            waitpid(pid_, nullptr, 0);
+        }
+    }
+
+    void set_rate(double fps) override { pacer_->set_rate(fps); }
+
+    Sample sample() override {
+        Sample s;
+        s.sent = pacer_->sent();
+        s.rejected = pacer_->rejected();
+        s.received = sink_->received();
+        s.latency = sink_->latency();
+        s.cpu_ns = pid_ > 0 ? process_cpu_ns(pid_) : system_busy_ns();
+        return s;
+    }
+
+    std::string cpu_scope() const override { return pid_ > 0 ? "gateway process" : "system"; }
+
+private:
+    Config c_;
+    pid_t pid_ = 0;
+    bool spawned_ = false;
+    std::vector<int> in_, out_;
+    std::unique_ptr<CanSink> sink_;
+    std::unique_ptr<Pacer> pacer_;
+};
+
+// ================= Steps =================
+
+struct StepResult {
+    double offered_fps = 0;
+    double entered_fps = 0;  // Frames that actually entered the path, per second
+    double achieved_fps = 0;
+    uint64_t offered = 0;    // Whole step, including warmup and drain
+    uint64_t received = 0;
+    double drop_rate = 0;
+    double cpu_ns_per_frame = 0;
+    double cpu_cores = 0;
+    HistogramSnapshot latency;
+};
+
+// b - a for cumulative histograms; max becomes the top non-empty bucket.
+static HistogramSnapshot diff(const HistogramSnapshot& b, const HistogramSnapshot& a) {
+    HistogramSnapshot d;
+    d.counts.resize(b.counts.size());
+    for (size_t i = 0; i < b.counts.size(); ++i) {
+        d.counts[i] = b.counts[i] - (i < a.counts.size() ? a.counts[i] : 0);
+        d.count += d.counts[i];
+        if (d.counts[i]) d.max = std::min(b.max, i + 1 < Histogram::BUCKETS ? Histogram::bucket_low(i + 1) - 1 : b.max);
+    }
+    d.sum = b.sum - a.sum;
+    return d;
+}
+
+static StepResult run_step(Path& path, double fps, double warmup, double duration, double drain) {
+    StepResult r;
+    r.offered_fps = fps;
+    Sample start = path.sample();
+    path.set_rate(fps);
+    sleep_s(warmup);
+    Sample a = path.sample();
+    uint64_t t0 = now_ns();
+    sleep_s(duration);
+    Sample b = path.sample();
+    double secs = (double)(now_ns() - t0) / 1e9;
+    path.set_rate(0);
+    sleep_s(drain);
+    Sample end = path.sample();
+
+    r.entered_fps = (double)(b.sent - a.sent) / secs;
+    r.achieved_fps = (double)(b.received - a.received) / secs;
+    r.offered = (end.sent + end.rejected) - (start.sent + start.rejected);
+    r.received = end.received - start.received;
+    r.drop_rate = r.offered ? (double)(r.offered - std::min(r.offered, r.received)) / (double)r.offered : 0.0;
+    uint64_t frames = b.received - a.received;
+    r.cpu_ns_per_frame = frames ? (double)(b.cpu_ns - a.cpu_ns) / (double)frames : 0.0;
+    r.cpu_cores = (double)(b.cpu_ns - a.cpu_ns) / 1e9 / secs;
+    r.latency = diff(b.latency, a.latency);
+    return r;
+}
+
+// ================= Output =================
+
+static std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c < 0x20) continue;
+        out += c;
+    }
+    return out + "\"";
+}
+
+static std::string to_json(const Config& c, const std::string& label, const std::string& cpu_scope, double claim,
+                           double max_drop, const std::vector<StepResult>& steps) {
+    utsname u = {};
+    uname(&u);
+    double sustained = 0;
+    for (const StepResult& s : steps) {
+        if (s.drop_rate <= max_drop) sustained = std::max(sustained, s.offered_fps);
+    }
+
+    std::ostringstream o;
+    o << "{\n  \"tool\": \"slcanx_load\",\n  \"label\": " << json_string(label) << ",\n  \"unix_time\": "
+      << (long long)time(nullptr) << ",\n  \"host\": {\"kernel\": " << json_string(std::string(u.release) + " " + u.machine)
+      << ", \"cpus\": " << std::thread::hardware_concurrency() << "},\n  \"path\": " << json_string(c.path)
+      << ",\n  \"direction\": " << json_string(c.path == "gateway" ? "forward" : c.direction)
+      << ",\n  \"channels\": " << (int)c.channels << ",\n  \"frame\": {\"kind\": " << json_string(std::string(1, c.frame.kind))
+      << ", \"len\": " << (int)std::max<uint8_t>(8, c.frame.len) << "},\n  \"bitrate\": " << c.bitrate
+      << ",\n  \"data_bitrate\": " << c.data_bitrate << ",\n  \"bus_timing\": " << (c.bus_timing ? "true" : "false")
+      << ",\n  \"cpu_scope\": " << json_string(cpu_scope) << ",\n  \"claim_fps\": " << claim
+      << ",\n  \"max_drop_rate\": " << max_drop << ",\n  \"steps\": [";
+    for (size_t i = 0; i < steps.size(); ++i) {
+        const StepResult& s = steps[i];
+        o << (i ? "," : "") << "\n    {\"offered_fps\": " << s.offered_fps << ", \"entered_fps\": " << (uint64_t)s.entered_fps
+          << ", \"achieved_fps\": " << (uint64_t)s.achieved_fps << ", \"offered\": " << s.offered
+          << ", \"received\": " << s.received << ", \"drop_rate\": " << s.drop_rate
+          << ", \"cpu_ns_per_frame\": " << (uint64_t)s.cpu_ns_per_frame << ", \"cpu_cores\": " << s.cpu_cores
+          << ", \"latency_ns\": {\"count\": " << s.latency.count << ", \"mean\": " << (uint64_t)s.latency.mean()
+          << ", \"p50\": " << s.latency.quantile(0.5) << ", \"p99\": " << s.latency.quantile(0.99)
+          << ", \"p999\": " << s.latency.quantile(0.999) << ", \"max\": " << s.latency.max << "}}";
+    }
+    o << "\n  ],\n  \"max_sustained_fps\": " << sustained << ",\n  \"meets_claim\": "
+      << (sustained >= claim ? "true" : "false") << "\n}\n";
+    return o.str();
+}
+
+static void usage(const char* prg) {
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  --path sdk|kernel|gateway    Path under test (default sdk)\n"
+                 "  --direction rx|tx            sdk/kernel: device to host or host to device (default rx)\n"
+                 "  --steps F1,F2,...            Offered frames/s, all channels (default 30000,60000,90000,120000,150000)\n"
+                 "  --duration S --warmup S --drain S   Per step (default 3, 0.5, 0.5)\n"
+                 "  --channels N                 Channels loaded (default 4)\n"
+                 "  --kind K --len N             Frame kind tTdDbB and length >= 8 (default b 8)\n"
+                 "  --bitrate B --data-bitrate B Emulated bus (default 1000000 8000000)\n"
+                 "  --bus-timing                 Limit the emulated bus to wire speed (default off)\n"
+                 "  --fw-fps N                   Emulated firmware RX budget\n"
+                 "  --can IF0,IF1,...            kernel: interface per channel\n"
+                 "  --attach CMD --detach CMD    kernel: run around the test, {tty} = pty path\n"
+                 "  --in IF,... --out IF,...     gateway: interfaces to feed and to drain\n"
+                 "  --spawn CMD | --pid PID      gateway: process to run or measure\n"
+                 "  --claim FPS                  Target for meets_claim (default 120000)\n"
+                 "  --max-drop R                 Drop rate a step may have to count as sustained (default 0)\n"
+                 "  --label S                    Free text kept in the JSON, e.g. a release\n"
+                 "  --json FILE                  Write results as JSON (- for stdout)\n",
+                 prg);
+}
+
+int main(int argc, char** argv) {
+    Config c;
+    std::vector<double> steps = {30000, 60000, 90000, 120000, 150000};
+    double duration = 3, warmup = 0.5, drain = 0.5, claim = 120000, max_drop = 0;
+    std::string label, json;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::runtime_error(a + " needs a value");
+                return argv[++i];
+            };
+            if (a == "--path") {
+                c.path = value();
+            } else if (a == "--direction") {
+                c.direction = value();
+            } else if (a == "--steps") {
+                steps.clear();
+                for (const std::string& s : split(value(), ',')) steps.push_back(std::atof(s.c_str()));
+            } else if (a == "--duration") {
+                duration = std::atof(value().c_str());
+            } else if (a == "--warmup") {
+                warmup = std::atof(value().c_str());
+            } else if (a == "--drain") {
+                drain = std::atof(value().c_str());
+            } else if (a == "--channels") {
+                c.channels = (uint8_t)std::max(1, std::min<int>(NUM_CHANNELS, std::atoi(value().c_str())));
+            } else if (a == "--kind") {
+                c.frame.kind = value()[0];
+            } else if (a == "--len") {
+                c.frame.len = (uint8_t)std::atoi(value().c_str());
+            } else if (a == "--bitrate") {
+                c.bitrate = (uint32_t)std::atol(value().c_str());
+            } else if (a == "--data-bitrate") {
+                c.data_bitrate = (uint32_t)std::atol(value().c_str());
+            } else if (a == "--bus-timing") {
+                c.bus_timing = true;
+            } else if (a == "--fw-fps") {
+                c.fw_fps = std::atof(value().c_str());
+            } else if (a == "--can") {
+                c.can = split(value(), ',');
+            } else if (a == "--attach") {
+                c.attach = value();
+            } else if (a == "--detach") {
+                c.detach = value();
+            } else if (a == "--in") {
+                c.in = split(value(), ',');
+            } else if (a == "--out") {
+                c.out = split(value(), ',');
+            } else if (a == "--spawn") {
+                c.spawn = value();
+            } else if (a == "--pid") {
+                c.pid = (pid_t)std::atoi(value().c_str());
+            } else if (a == "--claim") {
+                claim = std::atof(value().c_str());
+            } else if (a == "--max-drop") {
+                max_drop = std::atof(value().c_str());
+            } else if (a == "--label") {
+                label = value();
+            } else if (a == "--json") {
+                json = value();
+            } else {
+                usage(argv[0]);
+                return a == "-h" || a == "--help" ? 0 : 1;
+            }
+        }
+        if (std::string("tTdDbB").find(c.frame.kind) == std::string::npos) {
+            throw std::runtime_error("--kind must be one of t T d D b B (the payload carries a stamp)");
+        }
+        if (c.direction != "rx" && c.direction != "tx") throw std::runtime_error("--direction must be rx or tx");
+
+        std::unique_ptr<Path> path;
+        if (c.path == "sdk") {
+            path.reset(new SdkPath(c));
+        } else if (c.path == "kernel") {
+            path.reset(new KernelPath(c));
+        } else if (c.path == "gateway") {
+            path.reset(new GatewayPath(c));
+        } else {
+            throw std::runtime_error("Unknown path: " + c.path);
+        }
+
+        std::vector<StepResult> results;
+        std::fprintf(stderr, "%10s %10s %10s %9s %10s %7s %9s %9s %9s\n", "offered", "entered", "achieved", "drop",
+                     "cpu/frame", "cores", "p50 us", "p99 us", "p99.9 us");
+        for (double fps : steps) {
+            StepResult r = run_step(*path, fps, warmup, duration, drain);
+            std::fprintf(stderr, "%10.0f %10.0f %10.0f %8.4f%% %8.0fns %7.2f %9.1f %9.1f %9.1f\n", r.offered_fps,
+                         r.entered_fps, r.achieved_fps, r.drop_rate * 100, r.cpu_ns_per_frame, r.cpu_cores,
+                         r.latency.quantile(0.5) / 1e3, r.latency.quantile(0.99) / 1e3,
+                         r.latency.quantile(0.999) / 1e3);
+            results.push_back(r);
+        }
+
+        std::string out = to_json(c, label, path->cpu_scope(), claim, max_drop, results);
+        path.reset();
+        if (json == "-") {
+            std::fputs(out.c_str(), stdout);
+        } else if (!json.empty()) {
+            std::ofstream f(json);
+            f << out;
+            if (!f) throw std::runtime_error("Failed to write " + json);
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+// slcanx_replay: replay a capture, BLF, ASC or candump log through an SLCANX adapter.
+//
+//   ./slcanx_replay --port /dev/ttyACM0 --speed 1 run42.log
+//   ./slcanx_replay --port /tmp/ttySLX --max-speed --loop 0 /data/run42
+//
+// Bitrates are left as they are; set them first (or use --bitrate). Prints
+// the timing error histograms when done or on Ctrl-C.
+
+#include "slcanx_replay.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace slcanx;
+
+static volatile std::sig_atomic_t g_stop = 0;
+
+static void on_signal(int) { g_stop = 1; }
+
+static void usage(const char* prg) {
+    std::fprintf(stderr,
+                 "Usage: %s --port PORT [options] FILE|DIR\n"
+                 "  --port PORT                 Adapter (or slcanx_emu pty)\n"
+                 "  --speed X                   Time scale 0.1 .. 10 (default 1)\n"
+                 "  --max-speed                 Ignore timestamps\n"
+                 "  --loop N                    Passes, 0 = until Ctrl-C (default 1)\n"
+                 "  --map SRC:DST               Capture channel to bus channel, repeatable;\n"
+                 "                              DST -1 drops SRC\n"
+                 "  --iface NAME:CH             candump interface to capture channel\n"
+                 "  --spin-us N                 Busy-wait before each deadline (default 100)\n"
+                 "  --no-flush                  Leave batching to the TX coalescing window\n"
+                 "  --bitrate CH:BPS            Set and open a channel first, repeatable\n",
+                 prg);
+}
+
+static void print_histogram(const char* name, const HistogramSnapshot& h) {
+    std::printf("%-16s n=%llu mean=%.1fus p50=%.1fus p99=%.1fus p99.9=%.1fus max=%.1fus\n", name,
+                (unsigned long long)h.count, h.mean() / 1000.0, (double)h.quantile(0.5) / 1000.0,
+                (double)h.quantile(0.99) / 1000.0, (double)h.quantile(0.999) / 1000.0, (double)h.max / 1000.0);
+}
+
+int main(int argc, char** argv) {
+    ReplayOptions opt;
+    std::string port, path;
+    std::vector<ChannelConfig> bring_up;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::runtime_error(a + " needs a value");
+                return argv[++i];
+            };
+            auto pair = [&](const std::string& v) {
+                size_t colon = v.find(':');
+                if (colon == std::string::npos) throw std::runtime_error(a + " needs A:B");
+                return std::make_pair(v.substr(0, colon), v.substr(colon + 1));
+            };
+            if (a == "--port") {
+                port = value();
+            } else if (a == "--speed") {
+                opt.speed = std::atof(value().c_str());
+            } else if (a == "--max-speed") {
+                opt.max_speed = true;
+            } else if (a == "--loop") {
+                opt.loops = (uint32_t)std::atoi(value().c_str());
+            } else if (a == "--map") {
+                auto p = pair(value());
+                size_t src = (size_t)std::atoi(p.first.c_str());
+                if (src > 255) throw std::runtime_error("--map source out of range");
+                if (opt.channel_map.empty()) opt.channel_map = {0, 1, 2, 3};
+                if (opt.channel_map.size() <= src) opt.channel_map.resize(src + 1, -1);
+                opt.channel_map[src] = std::atoi(p.second.c_str());
+            } else if (a == "--iface") {
+                auto p = pair(value());
+                opt.interfaces[p.first] = std::atoi(p.second.c_str());
+            } else if (a == "--spin-us") {
+                opt.spin = std::chrono::microseconds(std::atoi(value().c_str()));
+            } else if (a == "--no-flush") {
+                opt.flush = false;
+            } else if (a == "--bitrate") {
+                auto p = pair(value());
+                ChannelConfig c;
+                c.channel = (uint8_t)std::atoi(p.first.c_str());
+                c.bitrate = (uint32_t)std::atol(p.second.c_str());
+                bring_up.push_back(c);
+            } else if (a[0] != '-' && path.empty()) {
+                path = a;
+            } else {
+                usage(argv[0]);
+                return a == "-h" || a == "--help" ? 0 : 1;
+            }
+        }
+        if (port.empty() || path.empty()) {
+            usage(argv[0]);
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    try {
+        Slcanx bus(port);
+        if (!bring_up.empty()) bus.configure(bring_up);
+
+        ReplayEngine replay(bus, path, opt);
+        while (!replay.wait_for(std::chrono::milliseconds(100))) {
+            if (g_stop) replay.stop();
+        }
+        bus.flush();
+
+        ReplayStats st = replay.stats();
+        std::printf("frames=%llu batches=%llu skipped=%llu loops=%llu\n", (unsigned long long)st.frames,
+                    (unsigned long long)st.batches, (unsigned long long)st.skipped, (unsigned long long)st.loops);
+        for (uint8_t ch = 0; ch < NUM_CHANNELS; ++ch) {
+            std::printf("  ch%u: %llu\n", ch, (unsigned long long)st.channel_frames[ch]);
+        }
+        if (!opt.max_speed) {
+            print_histogram("lateness", st.lateness_ns);
+            print_histogram("interval error", st.interval_error_ns);
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}